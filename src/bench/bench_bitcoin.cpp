@@ -4,6 +4,8 @@
 
 #include <bench/bench.h>
 
+#include <crypto/lyra2.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <random.h>
@@ -65,6 +67,8 @@ int main(int argc, char** argv)
     const fs::path bench_datadir{SetDataDir()};
 
     SHA256AutoDetect();
+    ScryptAutoDetect();
+    Lyra2AutoDetect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
@@ -11,6 +11,7 @@
 #include <uint256.h>
 #include <utiltime.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
@@ -60,6 +61,25 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void SCRYPT_1024_1_1_256_64(benchmark::State& state)
+{
+    std::vector<char> in(80 * 64, 0);
+    std::vector<char> out(32 * 64);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 64; i++)
+            scrypt_1024_1_1_256(&in[80 * i], &out[32 * i]);
+    }
+}
+
+static void SCRYPT_1024_1_1_256_MULTI_64(benchmark::State& state)
+{
+    std::vector<char> in(80 * 64, 0);
+    std::vector<char> out(32 * 64);
+    while (state.KeepRunning()) {
+        scrypt_1024_1_1_256_multi(in.data(), out.data(), 64);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -103,5 +123,7 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SCRYPT_1024_1_1_256_64, 20);
+BENCHMARK(SCRYPT_1024_1_1_256_MULTI_64, 20);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
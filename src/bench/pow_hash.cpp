@@ -0,0 +1,199 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <crypto/lyra2.h>
+#include <crypto/lyra2z.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <util.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <boost/thread/thread.hpp>
+
+/* Number of headers hashed per iteration; hashes/s = BATCH_SIZE / time per iteration */
+static const size_t BATCH_SIZE = 64;
+/* Number of headers validated per iteration of the mixed-algo cases */
+static const size_t MIXED_HEADERS = 10000;
+
+/* Mainnet algo mix: NIST5 is handbraked to about 1% of blocks, the rest share evenly */
+static int32_t GetMixedAlgo(FastRandomContext& insecure_rand)
+{
+    static const int32_t commonAlgos[] = {ALGO_SHA256D, ALGO_SCRYPT, ALGO_LYRA2Z, ALGO_X11, ALGO_X16R};
+    return insecure_rand.randrange(100) == 0 ? ALGO_NIST5 : commonAlgos[insecure_rand.randrange(5)];
+}
+
+static std::vector<CBlockHeader> MakeHeaders(int32_t nAlgo, size_t nCount = BATCH_SIZE)
+{
+    FastRandomContext insecure_rand(true);
+    std::vector<CBlockHeader> headers(nCount);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = VERSIONBITS_TOP_BITS | (nAlgo == ALGO_NULL ? GetMixedAlgo(insecure_rand) : nAlgo);
+        headers[i].hashPrevBlock = insecure_rand.rand256();
+        headers[i].hashMerkleRoot = insecure_rand.rand256();
+        headers[i].nTime = 1538000000;
+        headers[i].nBits = 0x1e0ffff0;
+        headers[i].nNonce = i;
+    }
+    return headers;
+}
+
+static void PoWHashSingle(benchmark::State& state, int32_t nAlgo)
+{
+    CBlockHeader header = MakeHeaders(nAlgo, 1)[0];
+    while (state.KeepRunning()) {
+        header.GetPoWHash();
+        header.nNonce++;
+    }
+}
+
+static void PoWHashSerial(benchmark::State& state, int32_t nAlgo)
+{
+    std::vector<CBlockHeader> headers = MakeHeaders(nAlgo);
+    while (state.KeepRunning()) {
+        for (const CBlockHeader& header : headers)
+            header.GetPoWHash();
+    }
+}
+
+/* Runs ThreadPoWHashCheck workers on every core for as long as it is in scope */
+class PoWHashCheckThreads
+{
+private:
+    int nScriptCheckThreadsPrev;
+    boost::thread_group tg;
+
+public:
+    PoWHashCheckThreads() : nScriptCheckThreadsPrev(nScriptCheckThreads)
+    {
+        nScriptCheckThreads = std::max(2, GetNumCores());
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            tg.create_thread(&ThreadPoWHashCheck);
+    }
+
+    ~PoWHashCheckThreads()
+    {
+        tg.interrupt_all();
+        tg.join_all();
+        nScriptCheckThreads = nScriptCheckThreadsPrev;
+    }
+};
+
+static void PoWHashBatch(benchmark::State& state, int32_t nAlgo)
+{
+    std::vector<CBlockHeader> headers = MakeHeaders(nAlgo);
+    std::vector<uint256> hashes;
+
+    PoWHashCheckThreads threads;
+    while (state.KeepRunning())
+        GetPoWHashes(headers, hashes);
+}
+
+/* Headers at the easiest mainnet target, so the check does the full comparison */
+static std::vector<CBlockHeader> MakeMixedHeaders(const Consensus::Params& consensusParams)
+{
+    std::vector<CBlockHeader> headers = MakeHeaders(ALGO_NULL, MIXED_HEADERS);
+    unsigned int nBits = UintToArith256(consensusParams.powLimit).GetCompact();
+    for (CBlockHeader& header : headers)
+        header.nBits = nBits;
+    return headers;
+}
+
+static void PoWValidateMixedSerial(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& consensusParams = chainParams->GetConsensus();
+    std::vector<CBlockHeader> headers = MakeMixedHeaders(consensusParams);
+
+    while (state.KeepRunning()) {
+        for (const CBlockHeader& header : headers)
+            CheckProofOfWork(header.GetPoWHash(), header.nBits, consensusParams);
+    }
+}
+
+static void PoWValidateMixedBatch(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& consensusParams = chainParams->GetConsensus();
+    std::vector<CBlockHeader> headers = MakeMixedHeaders(consensusParams);
+    std::vector<uint256> hashes;
+
+    PoWHashCheckThreads threads;
+    while (state.KeepRunning()) {
+        GetPoWHashes(headers, hashes);
+        for (size_t i = 0; i < headers.size(); i++)
+            CheckProofOfWork(hashes[i], headers[i].nBits, consensusParams);
+    }
+}
+
+/* The Lyra2 step of Lyra2Z, allocating its matrix per hash as LYRA2 does */
+static void PoWLyra2ZMatrixHeap(benchmark::State& state)
+{
+    uint256 hash = uint256S("0x3b1ff2f1f5e4d3c2b1a09f8e7d6c5b4a39281706f5e4d3c2b1a09f8e7d6c5b4a");
+    while (state.KeepRunning()) {
+        LYRA2(hash.begin(), 32, hash.begin(), 32, hash.begin(), 32, 8, 8, 8);
+    }
+}
+
+/* The same with one scratchpad reused across hashes, as lyra2z_hash does */
+static void PoWLyra2ZMatrixScratchpad(benchmark::State& state)
+{
+    uint256 hash = uint256S("0x3b1ff2f1f5e4d3c2b1a09f8e7d6c5b4a39281706f5e4d3c2b1a09f8e7d6c5b4a");
+    alignas(32) uint64_t scratchpad[LYRA2Z_SCRATCHPAD_SIZE / 8];
+    while (state.KeepRunning()) {
+        LYRA2_sp(hash.begin(), 32, hash.begin(), 32, hash.begin(), 32, 8, 8, 8, scratchpad);
+    }
+}
+
+static void PoWHashSingleSHA256D(benchmark::State& state) { PoWHashSingle(state, ALGO_SHA256D); }
+static void PoWHashSingleScrypt(benchmark::State& state) { PoWHashSingle(state, ALGO_SCRYPT); }
+static void PoWHashSingleNIST5(benchmark::State& state) { PoWHashSingle(state, ALGO_NIST5); }
+static void PoWHashSingleLyra2Z(benchmark::State& state) { PoWHashSingle(state, ALGO_LYRA2Z); }
+static void PoWHashSingleX11(benchmark::State& state) { PoWHashSingle(state, ALGO_X11); }
+static void PoWHashSingleX16R(benchmark::State& state) { PoWHashSingle(state, ALGO_X16R); }
+
+static void PoWHashSerialSHA256D(benchmark::State& state) { PoWHashSerial(state, ALGO_SHA256D); }
+static void PoWHashSerialScrypt(benchmark::State& state) { PoWHashSerial(state, ALGO_SCRYPT); }
+static void PoWHashSerialNIST5(benchmark::State& state) { PoWHashSerial(state, ALGO_NIST5); }
+static void PoWHashSerialLyra2Z(benchmark::State& state) { PoWHashSerial(state, ALGO_LYRA2Z); }
+static void PoWHashSerialX11(benchmark::State& state) { PoWHashSerial(state, ALGO_X11); }
+static void PoWHashSerialX16R(benchmark::State& state) { PoWHashSerial(state, ALGO_X16R); }
+
+static void PoWHashBatchSHA256D(benchmark::State& state) { PoWHashBatch(state, ALGO_SHA256D); }
+static void PoWHashBatchScrypt(benchmark::State& state) { PoWHashBatch(state, ALGO_SCRYPT); }
+static void PoWHashBatchNIST5(benchmark::State& state) { PoWHashBatch(state, ALGO_NIST5); }
+static void PoWHashBatchLyra2Z(benchmark::State& state) { PoWHashBatch(state, ALGO_LYRA2Z); }
+static void PoWHashBatchX11(benchmark::State& state) { PoWHashBatch(state, ALGO_X11); }
+static void PoWHashBatchX16R(benchmark::State& state) { PoWHashBatch(state, ALGO_X16R); }
+
+BENCHMARK(PoWLyra2ZMatrixHeap, 300);
+BENCHMARK(PoWLyra2ZMatrixScratchpad, 300);
+
+BENCHMARK(PoWHashSingleSHA256D, 100000);
+BENCHMARK(PoWHashSingleScrypt, 1000);
+BENCHMARK(PoWHashSingleNIST5, 10000);
+BENCHMARK(PoWHashSingleLyra2Z, 300);
+BENCHMARK(PoWHashSingleX11, 5000);
+BENCHMARK(PoWHashSingleX16R, 5000);
+
+BENCHMARK(PoWHashSerialSHA256D, 2000);
+BENCHMARK(PoWHashSerialScrypt, 20);
+BENCHMARK(PoWHashSerialNIST5, 200);
+BENCHMARK(PoWHashSerialLyra2Z, 5);
+BENCHMARK(PoWHashSerialX11, 100);
+BENCHMARK(PoWHashSerialX16R, 100);
+
+BENCHMARK(PoWHashBatchSHA256D, 2000);
+BENCHMARK(PoWHashBatchScrypt, 20);
+BENCHMARK(PoWHashBatchNIST5, 200);
+BENCHMARK(PoWHashBatchLyra2Z, 5);
+BENCHMARK(PoWHashBatchX11, 100);
+BENCHMARK(PoWHashBatchX16R, 100);
+
+BENCHMARK(PoWValidateMixedSerial, 1);
+BENCHMARK(PoWValidateMixedBatch, 1);
@@ -119,6 +119,45 @@ void CBlockIndex::BuildSkip()
         pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
 }
 
+// VELES BEGIN
+void CBlockIndex::BuildAlgoChain()
+{
+    for (int nSlot = 0; nSlot < LAST_ALGO_SLOTS; nSlot++)
+        apLastAlgo[nSlot] = pprev ? const_cast<CBlockIndex*>(pprev->GetLastAlgoAncestor(nSlot << 8)) : nullptr;
+
+    pprevAlgo = pprev ? const_cast<CBlockIndex*>(pprev->GetLastAlgoAncestor(GetAlgo())) : nullptr;
+    nAlgoHeight = pprevAlgo ? pprevAlgo->nAlgoHeight + 1 : 1;
+
+    int nSlot = GetAlgo() >> 8;
+    if (nSlot < LAST_ALGO_SLOTS)
+        apLastAlgo[nSlot] = this;
+}
+
+const CBlockIndex* CBlockIndex::GetPrevAlgo() const
+{
+    if (nAlgoHeight > 0)
+        return pprevAlgo;
+
+    // entries built by hand (unit tests) may lack the algo chain
+    return pprev ? pprev->GetLastAlgoAncestor(GetAlgo()) : nullptr;
+}
+
+const CBlockIndex* CBlockIndex::GetLastAlgoAncestor(int32_t nAlgo, int nMinHeight) const
+{
+    // the algo chain keeps the last block of every known algo
+    if (nAlgoHeight > 0 && (nAlgo & ~ALGO_VERSION_MASK) == 0 && (nAlgo >> 8) < LAST_ALGO_SLOTS) {
+        const CBlockIndex* pindexAlgo = apLastAlgo[nAlgo >> 8];
+        return pindexAlgo && pindexAlgo->nHeight >= nMinHeight ? pindexAlgo : nullptr;
+    }
+
+    // otherwise walk back
+    const CBlockIndex* pindexWalk = this;
+    while (pindexWalk && pindexWalk->nHeight >= nMinHeight && pindexWalk->GetAlgo() != nAlgo)
+        pindexWalk = pindexWalk->pprev;
+    return pindexWalk && pindexWalk->nHeight >= nMinHeight ? pindexWalk : nullptr;
+}
+// VELES END
+
 arith_uint256 GetBlockProof(const CBlockIndex& block)
 {
     arith_uint256 bnTarget;
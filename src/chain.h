@@ -6,12 +6,15 @@
 #ifndef FXTC_CHAIN_H
 #define FXTC_CHAIN_H
 
+#include <amount.h>
 #include <arith_uint256.h>
 #include <consensus/params.h>
 #include <primitives/block.h>
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <algorithm>
+#include <iterator>
 #include <vector>
 
 /**
@@ -160,6 +163,11 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    // VELES BEGIN
+    BLOCK_POW_VERIFIED      =   256, //!< header proof of work was checked when the header was accepted
+    BLOCK_OLD_SUBSIDY       =   512, //!< set by older versions that stored nChainSubsidy, ignored
+    // VELES END
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -179,6 +187,22 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
+    // VELES BEGIN
+    //! pointer to the index of the closest predecessor mined by the same algo
+    CBlockIndex* pprevAlgo;
+
+    //! Number of blocks mined by the same algo in the chain up to and including this block,
+    //! 0 if pprevAlgo has not been built
+    int nAlgoHeight;
+
+    //! Algos whose last blocks are kept in apLastAlgo, by their id (nAlgo >> 8)
+    static const int LAST_ALGO_SLOTS = (ALGO_X16R >> 8) + 1;
+
+    //! pointers to the last block mined by each algo in the chain up to and including this block,
+    //! only meaningful if nAlgoHeight is set
+    CBlockIndex* apLastAlgo[LAST_ALGO_SLOTS];
+    // VELES END
+
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -213,6 +237,12 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
+    // VELES BEGIN
+    //! Total block subsidy of the chain up to and including this block, excluding the genesis block.
+    //! -1 if not computed yet. Kept in memory only, as the subsidy depends on sporks.
+    CAmount nChainSubsidy;
+    // VELES END
+
     //! Verification status of this block. See enum BlockStatus
     uint32_t nStatus;
 
@@ -234,6 +264,11 @@ public:
         phashBlock = nullptr;
         pprev = nullptr;
         pskip = nullptr;
+        // VELES BEGIN
+        pprevAlgo = nullptr;
+        nAlgoHeight = 0;
+        std::fill(std::begin(apLastAlgo), std::end(apLastAlgo), nullptr);
+        // VELES END
         nHeight = 0;
         nFile = 0;
         nDataPos = 0;
@@ -249,6 +284,9 @@ public:
         // FXTC END
         nTx = 0;
         nChainTx = 0;
+        // VELES BEGIN
+        nChainSubsidy = -1;
+        // VELES END
         nStatus = 0;
         nSequenceId = 0;
         nTimeMax = 0;
@@ -380,6 +418,22 @@ public:
     //! Efficiently find an ancestor of this block.
     CBlockIndex* GetAncestor(int height);
     const CBlockIndex* GetAncestor(int height) const;
+
+    // VELES BEGIN
+    int32_t GetAlgo() const
+    {
+        return nVersion & ALGO_VERSION_MASK;
+    }
+
+    //! Build the same-algo predecessor pointer and height for this entry.
+    void BuildAlgoChain();
+
+    //! Find the closest predecessor mined by the same algo.
+    const CBlockIndex* GetPrevAlgo() const;
+
+    //! Find the last block mined by nAlgo, this block included, not looking below nMinHeight.
+    const CBlockIndex* GetLastAlgoAncestor(int32_t nAlgo, int nMinHeight = 0) const;
+    // VELES END
 };
 
 arith_uint256 GetBlockProof(const CBlockIndex& block);
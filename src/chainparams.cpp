@@ -477,6 +477,10 @@ public:
 
         nPoolMaxTransactions = 3;
         nFulfilledRequestExpireTime = 5*60; // fulfilled requests expire in 5 minutes
+        // VELES BEGIN
+        // Signing key for the tests: 8SFpqTiknk8VJ6wC5DC73izzbgUh1fB1nNz5Zrf6YMjgFmZiE7J
+        strSporkPubKey = "04a8daedf3a834e51585022faf6bc9eb5e29d66c266e3ff88aee3a8330d771e5bdb2d32ef21d8d09498cdcf2628945e4c32edc5fa23dd48cc024d11b2db28ee2c8";
+        // VELES END
 
         founderAddress = "";
 
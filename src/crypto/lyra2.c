@@ -21,9 +21,50 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
 #include <crypto/lyra2.h>
 #include <crypto/sponge.h>
 
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#define LYRA2_DETECT_AVX2
+#endif
+
+/* Row operations of the sponge, switched to a vectorized set by Lyra2AutoDetect */
+static struct {
+	void (*reducedSqueezeRow0)(uint64_t *state, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+	void (*reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+} lyra2_sponge = {reducedSqueezeRow0, reducedDuplexRow1, reducedDuplexRowSetup, reducedDuplexRow};
+
+const char *Lyra2AutoDetect(void) {
+#if defined(LYRA2_DETECT_AVX2)
+	unsigned int eax, ebx, ecx, edx;
+	int enabled_avx = 0;
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+		// OSXSAVE and AVX: check that the OS preserves the YMM registers
+		uint32_t a, d;
+		__asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+		enabled_avx = (a & 6) == 6;
+	}
+	if (enabled_avx && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && ((ebx >> 5) & 1)) {
+		lyra2_sponge.reducedSqueezeRow0 = reducedSqueezeRow0_avx2;
+		lyra2_sponge.reducedDuplexRow1 = reducedDuplexRow1_avx2;
+		lyra2_sponge.reducedDuplexRowSetup = reducedDuplexRowSetup_avx2;
+		lyra2_sponge.reducedDuplexRow = reducedDuplexRow_avx2;
+		return "avx2";
+	}
+#endif
+	lyra2_sponge.reducedSqueezeRow0 = reducedSqueezeRow0;
+	lyra2_sponge.reducedDuplexRow1 = reducedDuplexRow1;
+	lyra2_sponge.reducedDuplexRowSetup = reducedDuplexRowSetup;
+	lyra2_sponge.reducedDuplexRow = reducedDuplexRow;
+	return "standard";
+}
+
 /**
 * Executes Lyra2 based on the G function from Blake2b. This version supports salts and passwords
 * whose combined length is smaller than the size of the memory matrix, (i.e., (nRows x nCols x b) bits,
@@ -44,7 +85,24 @@
 * @return 0 if the key is generated correctly; -1 if there is an error (usually due to lack of memory for allocation)
 */
 int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols) {
+	uint64_t *wholeMatrix = malloc(nRows * nCols * BLOCK_LEN_BYTES);
+	if (wholeMatrix == NULL) {
+		return -1;
+	}
+	int ret = LYRA2_sp(K, kLen, pwd, pwdlen, salt, saltlen, timeCost, nRows, nCols, wholeMatrix);
+	free(wholeMatrix);
+	return ret;
+}
 
+/**
+* Same as LYRA2, but works in a memory matrix owned by the caller instead of allocating one,
+* so that threads hashing repeatedly can keep reusing their own. Nothing is allocated on the heap.
+*
+* @param wholeMatrix Scratch space of nRows x nCols x BLOCK_LEN_BYTES bytes, preferably 32-byte aligned
+*
+* @return 0 if the key is generated correctly
+*/
+int LYRA2_sp(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols, uint64_t *wholeMatrix) {
 	//============================= Basic variables ============================//
 	int64_t row = 2; //index of row to be processed
 	int64_t prev = 1; //index of prev (last row ever computed/modified)
@@ -64,23 +122,11 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 	const int64_t ROW_LEN_BYTES = ROW_LEN_INT64 * 8;
 
 	i = (int64_t)((int64_t)nRows * (int64_t)ROW_LEN_BYTES);
-	uint64_t *wholeMatrix = malloc(i);
-	if (wholeMatrix == NULL) {
-		return -1;
-	}
 	memset(wholeMatrix, 0, i);
 
-	//Allocates pointers to each row of the matrix
-	uint64_t **memMatrix = malloc(nRows * sizeof(uint64_t*));
-	if (memMatrix == NULL) {
-		return -1;
-	}
-	//Places the pointers in the correct positions
-	uint64_t *ptrWord = wholeMatrix;
-	for (i = 0; i < nRows; i++) {
-		memMatrix[i] = ptrWord;
-		ptrWord += ROW_LEN_INT64;
-	}
+	//Rows are laid out back to back, so M[row] is wholeMatrix + row * ROW_LEN_INT64
+#define memMatrix(row) (wholeMatrix + (row) * ROW_LEN_INT64)
+	uint64_t *ptrWord;
 	//==========================================================================/
 
 	//============= Getting the password + salt + basil padded with 10*1 ===============//
@@ -123,10 +169,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
 					  //======================= Initializing the Sponge State ====================//
 					  //Sponge state: 16 uint64_t, BLOCK_LEN_INT64 words of them for the bitrate (b) and the remainder for the capacity (c)
-	uint64_t *state = malloc(16 * sizeof(uint64_t));
-	if (state == NULL) {
-		return -1;
-	}
+	ALIGN uint64_t state[16];
 	initState(state);
 	//==========================================================================/
 
@@ -139,12 +182,12 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 	}
 
 	//Initializes M[0] and M[1]
-	reducedSqueezeRow0(state, memMatrix[0], nCols); //The locally copied password is most likely overwritten here
-	reducedDuplexRow1(state, memMatrix[0], memMatrix[1], nCols);
+	lyra2_sponge.reducedSqueezeRow0(state, memMatrix(0), nCols); //The locally copied password is most likely overwritten here
+	lyra2_sponge.reducedDuplexRow1(state, memMatrix(0), memMatrix(1), nCols);
 
 	do {
 		//M[row] = rand; //M[row*] = M[row*] XOR rotW(rand)
-		reducedDuplexRowSetup(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+		lyra2_sponge.reducedDuplexRowSetup(state, memMatrix(prev), memMatrix(rowa), memMatrix(row), nCols);
 
 
 		//updates the value of row* (deterministically picked during Setup))
@@ -177,7 +220,7 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 												   //------------------------------------------------------------------------------------------
 
 												   //Performs a reduced-round duplexing operation over M[row*] XOR M[prev], updating both M[row*] and M[row]
-			reducedDuplexRow(state, memMatrix[prev], memMatrix[rowa], memMatrix[row], nCols);
+			lyra2_sponge.reducedDuplexRow(state, memMatrix(prev), memMatrix(rowa), memMatrix(row), nCols);
 
 			//update prev: it now points to the last row ever computed
 			prev = row;
@@ -194,19 +237,15 @@ int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *
 
 	//============================ Wrap-up Phase ===============================//
 	//Absorbs the last block of the memory matrix
-	absorbBlock(state, memMatrix[rowa]);
+	absorbBlock(state, memMatrix(rowa));
 
 	//Squeezes the key
 	squeeze(state, K, kLen);
 	//==========================================================================/
 
-	//========================= Freeing the memory =============================//
-	free(memMatrix);
-	free(wholeMatrix);
-
-	//Wiping out the sponge's internal state before freeing it
+	//========================= Wiping the state ===============================//
+#undef memMatrix
 	memset(state, 0, 16 * sizeof(uint64_t));
-	free(state);
 	//==========================================================================/
 
 	return 0;
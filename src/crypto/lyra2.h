@@ -42,6 +42,12 @@ extern "C" {
 #endif
 
 	int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
+	int LYRA2_sp(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols, uint64_t *wholeMatrix);
+
+	/** Autodetect the best available sponge row implementation.
+	 *  Returns the name of the implementation.
+	 */
+	const char *Lyra2AutoDetect(void);
 
 #ifdef __cplusplus
 }
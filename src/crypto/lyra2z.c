@@ -34,8 +34,16 @@
 #include <stdio.h>
 #include <crypto/sph_blake.h>
 #include <crypto/lyra2.h>
+#include <crypto/sponge.h>
 
 void lyra2z_hash(const char* input, char* output)
+{
+	ALIGN uint64_t scratchpad[LYRA2Z_SCRATCHPAD_SIZE / 8];
+	lyra2z_hash_sp(input, output, scratchpad);
+}
+
+/* scratchpad must hold LYRA2Z_SCRATCHPAD_SIZE bytes and is best 32-byte aligned */
+void lyra2z_hash_sp(const char* input, char* output, uint64_t* scratchpad)
 {
 	sph_blake256_context     ctx_blake;
 
@@ -45,7 +53,7 @@ void lyra2z_hash(const char* input, char* output)
 	sph_blake256(&ctx_blake, input, 80);
 	sph_blake256_close(&ctx_blake, hashA);
 
-	LYRA2(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8);
+	LYRA2_sp(hashB, 32, hashA, 32, hashA, 32, 8, 8, 8, scratchpad);
 
 	memcpy(output, hashB, 32);
 }
@@ -1,11 +1,17 @@
 #ifndef FXTC_CRYPTO_LYRA2Z_H
 #define FXTC_CRYPTO_LYRA2Z_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	/* Scratch space lyra2z_hash_sp works in: an 8 x 8 matrix of 96-byte blocks */
+	#define LYRA2Z_SCRATCHPAD_SIZE (8 * 8 * 96)
+
 	void lyra2z_hash(const char* input, char* output);
+	void lyra2z_hash_sp(const char* input, char* output, uint64_t* scratchpad);
 
 #ifdef __cplusplus
 }
@@ -28,11 +28,23 @@
  */
 
 #include <crypto/scrypt.h>
+#include <crypto/common.h>
 //#include <util.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <openssl/sha.h>
+#include <vector>
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+namespace scrypt_avx2
+{
+void ROMix_8way(uint32_t* X, uint32_t* V);
+}
+#endif
 
 #if defined(USE_SSE2) && !defined(USE_SSE2_ALWAYS)
 #ifdef _MSC_VER
@@ -330,3 +342,63 @@ void scrypt_1024_1_1_256(const char *input, char *output)
 	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
     scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
+
+/* Number of hashes the widest detected ROMix core computes at once, 1 = none */
+static size_t scrypt_multi_lanes = 1;
+
+std::string ScryptAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    unsigned int eax, ebx, ecx, edx;
+    bool have_avx2 = false;
+    bool enabled_avx = false;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 27) & 1) && ((ecx >> 28) & 1)) {
+        // OSXSAVE and AVX: check that the OS preserves the YMM registers
+        uint32_t a, d;
+        __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        enabled_avx = (a & 6) == 6;
+    }
+    if (enabled_avx && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        have_avx2 = (ebx >> 5) & 1;
+    }
+    if (have_avx2) {
+        scrypt_multi_lanes = 8;
+        ret = "avx2(8way)";
+    }
+#endif
+    return ret;
+}
+
+void scrypt_1024_1_1_256_multi(const char *input, char *output, size_t blocks)
+{
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (scrypt_multi_lanes == 8 && blocks >= 3) {
+        uint8_t B[128];
+        uint32_t X[8 * 32];
+        std::vector<uint32_t> V(8 * 1024 * 32);
+        while (blocks >= 3) {
+            // A partial group costs as much as a full one, which still beats
+            // hashing three or more inputs one by one.
+            size_t lanes = blocks < 8 ? blocks : 8;
+            for (size_t l = 0; l < 8; l++) {
+                const uint8_t *in = (const uint8_t *)input + 80 * (l < lanes ? l : 0);
+                PBKDF2_SHA256(in, 80, in, 80, 1, B, 128);
+                for (int k = 0; k < 32; k++)
+                    X[l * 32 + k] = le32dec(&B[4 * k]);
+            }
+            scrypt_avx2::ROMix_8way(X, V.data());
+            for (size_t l = 0; l < lanes; l++) {
+                for (int k = 0; k < 32; k++)
+                    le32enc(&B[4 * k], X[l * 32 + k]);
+                PBKDF2_SHA256((const uint8_t *)input + 80 * l, 80, B, 128, 1, (uint8_t *)output + 32 * l, 32);
+            }
+            input += 80 * lanes;
+            output += 32 * lanes;
+            blocks -= lanes;
+        }
+    }
+#endif
+    for (size_t i = 0; i < blocks; i++)
+        scrypt_1024_1_1_256(input + 80 * i, output + 32 * i);
+}
@@ -3,10 +3,23 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string>
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
+
+/** Autodetect the best available multi-lane scrypt implementation.
+ *  Returns the name of the implementation.
+ */
+std::string ScryptAutoDetect();
+
+/** Compute multiple scrypt_1024_1_1_256 hashes of 80-byte inputs.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*80 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void scrypt_1024_1_1_256_multi(const char *input, char *output, size_t blocks);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
 #if defined(USE_SSE2)
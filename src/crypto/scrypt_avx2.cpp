@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a lane-interleaved version of the scrypt ROMix core in
+// crypto/scrypt.cpp: eight independent hashes are computed at once, one
+// per 32-bit lane of each AVX2 register.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/scrypt.h>
+
+namespace scrypt_avx2 {
+namespace {
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline RotL(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+/** Salsa20/8 of B ^ Bx into B, for eight lanes. */
+void inline __attribute__((always_inline)) XorSalsa8(__m256i B[16], const __m256i Bx[16])
+{
+    __m256i x[16];
+    for (int i = 0; i < 16; i++)
+        x[i] = B[i] = Xor(B[i], Bx[i]);
+
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x[ 4] = Xor(x[ 4], RotL(Add(x[ 0], x[12]),  7));  x[ 9] = Xor(x[ 9], RotL(Add(x[ 5], x[ 1]),  7));
+        x[14] = Xor(x[14], RotL(Add(x[10], x[ 6]),  7));  x[ 3] = Xor(x[ 3], RotL(Add(x[15], x[11]),  7));
+
+        x[ 8] = Xor(x[ 8], RotL(Add(x[ 4], x[ 0]),  9));  x[13] = Xor(x[13], RotL(Add(x[ 9], x[ 5]),  9));
+        x[ 2] = Xor(x[ 2], RotL(Add(x[14], x[10]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 3], x[15]),  9));
+
+        x[12] = Xor(x[12], RotL(Add(x[ 8], x[ 4]), 13));  x[ 1] = Xor(x[ 1], RotL(Add(x[13], x[ 9]), 13));
+        x[ 6] = Xor(x[ 6], RotL(Add(x[ 2], x[14]), 13));  x[11] = Xor(x[11], RotL(Add(x[ 7], x[ 3]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[12], x[ 8]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 1], x[13]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 6], x[ 2]), 18));  x[15] = Xor(x[15], RotL(Add(x[11], x[ 7]), 18));
+
+        /* Operate on rows. */
+        x[ 1] = Xor(x[ 1], RotL(Add(x[ 0], x[ 3]),  7));  x[ 6] = Xor(x[ 6], RotL(Add(x[ 5], x[ 4]),  7));
+        x[11] = Xor(x[11], RotL(Add(x[10], x[ 9]),  7));  x[12] = Xor(x[12], RotL(Add(x[15], x[14]),  7));
+
+        x[ 2] = Xor(x[ 2], RotL(Add(x[ 1], x[ 0]),  9));  x[ 7] = Xor(x[ 7], RotL(Add(x[ 6], x[ 5]),  9));
+        x[ 8] = Xor(x[ 8], RotL(Add(x[11], x[10]),  9));  x[13] = Xor(x[13], RotL(Add(x[12], x[15]),  9));
+
+        x[ 3] = Xor(x[ 3], RotL(Add(x[ 2], x[ 1]), 13));  x[ 4] = Xor(x[ 4], RotL(Add(x[ 7], x[ 6]), 13));
+        x[ 9] = Xor(x[ 9], RotL(Add(x[ 8], x[11]), 13));  x[14] = Xor(x[14], RotL(Add(x[13], x[12]), 13));
+
+        x[ 0] = Xor(x[ 0], RotL(Add(x[ 3], x[ 2]), 18));  x[ 5] = Xor(x[ 5], RotL(Add(x[ 4], x[ 7]), 18));
+        x[10] = Xor(x[10], RotL(Add(x[ 9], x[ 8]), 18));  x[15] = Xor(x[15], RotL(Add(x[14], x[13]), 18));
+    }
+
+    for (int i = 0; i < 16; i++)
+        B[i] = Add(B[i], x[i]);
+}
+
+} // namespace
+
+void ROMix_8way(uint32_t* X, uint32_t* V)
+{
+    // Word k of all eight lanes lives in one register; the scratchpad uses
+    // the same interleaving, so V holds 1024 * 32 * 8 words.
+    __m256i x[32];
+    for (int k = 0; k < 32; k++)
+        x[k] = _mm256_set_epi32(X[7 * 32 + k], X[6 * 32 + k], X[5 * 32 + k], X[4 * 32 + k],
+                                X[3 * 32 + k], X[2 * 32 + k], X[1 * 32 + k], X[0 * 32 + k]);
+
+    __m256i* v = (__m256i*)V;
+    for (int i = 0; i < 1024; i++) {
+        for (int k = 0; k < 32; k++)
+            _mm256_storeu_si256(&v[i * 32 + k], x[k]);
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i mask = _mm256_set1_epi32(1023);
+    for (int i = 0; i < 1024; i++) {
+        // Every lane reads its own row of the scratchpad, so gather word k of
+        // row j from offset (j * 32 + k) * 8 + lane.
+        __m256i offset = Add(_mm256_slli_epi32(_mm256_and_si256(x[16], mask), 8), lanes);
+        for (int k = 0; k < 32; k++)
+            x[k] = Xor(x[k], _mm256_i32gather_epi32((const int*)V, Add(offset, _mm256_set1_epi32(k * 8)), 4));
+        XorSalsa8(&x[0], &x[16]);
+        XorSalsa8(&x[16], &x[0]);
+    }
+
+    uint32_t out[8];
+    for (int k = 0; k < 32; k++) {
+        _mm256_storeu_si256((__m256i*)out, x[k]);
+        for (int l = 0; l < 8; l++)
+            X[l * 32 + k] = out[l];
+    }
+}
+
+} // namespace scrypt_avx2
+
+#endif
@@ -89,6 +89,20 @@ void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint6
 void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
 void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
 
+//---- AVX2 versions of the row operations (crypto/sponge_avx2.cpp)
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+#ifdef __cplusplus
+extern "C" {
+#endif
+void reducedSqueezeRow0_avx2(uint64_t* state, uint64_t* rowOut, uint64_t nCols);
+void reducedDuplexRow1_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRowSetup_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+void reducedDuplexRow_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+#ifdef __cplusplus
+}
+#endif
+#endif
+
 //---- Misc
 void printArray(unsigned char *array, unsigned int size, char *name);
 
@@ -0,0 +1,165 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This is a vectorized version of the reduced-round sponge row operations in
+// crypto/sponge.c. The 16-word Blake2b state lives in four AVX2 registers of
+// four words each, so a column step works on a whole row of the state at once
+// and the diagonal step only needs the rows rotated into place. A block of
+// the memory matrix (12 words) is the first three of those registers.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/lyra2.h>
+#include <crypto/sponge.h>
+
+namespace sponge_avx2 {
+namespace {
+
+__m256i inline Load(const uint64_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+void inline Store(uint64_t* p, __m256i x) { _mm256_storeu_si256((__m256i*)p, x); }
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+
+__m256i inline RotR32(__m256i x) { return _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)); }
+__m256i inline RotR24(__m256i x)
+{
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,
+                                                   3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10));
+}
+__m256i inline RotR16(__m256i x)
+{
+    return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,
+                                                   2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9));
+}
+__m256i inline RotR63(__m256i x) { return _mm256_or_si256(_mm256_srli_epi64(x, 63), Add(x, x)); }
+
+/** Blake2b's G function on the four columns (or diagonals) held in a, b, c and d. */
+void inline __attribute__((always_inline)) G4(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    a = Add(a, b); d = RotR32(Xor(d, a));
+    c = Add(c, d); b = RotR24(Xor(b, c));
+    a = Add(a, b); d = RotR16(Xor(d, a));
+    c = Add(c, d); b = RotR63(Xor(b, c));
+}
+
+/** One round of Blake2b's compression function, i.e. ROUND_LYRA. */
+void inline __attribute__((always_inline)) ReducedBlake2bLyra(__m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    G4(a, b, c, d);
+    // Rotate rows 1-3 left by 1-3 words so the diagonals line up as columns
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));
+    G4(a, b, c, d);
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));
+}
+
+/** rotW(rand) of the 12-word block held in a, b and c: every word moves up by one. */
+void inline __attribute__((always_inline)) RotW(__m256i a, __m256i b, __m256i c, __m256i& r0, __m256i& r1, __m256i& r2)
+{
+    const __m256i ta = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i tb = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));
+    const __m256i tc = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(2, 1, 0, 3));
+    r0 = _mm256_blend_epi32(ta, tc, 0x03);
+    r1 = _mm256_blend_epi32(tb, ta, 0x03);
+    r2 = _mm256_blend_epi32(tc, tb, 0x03);
+}
+
+} // namespace
+} // namespace sponge_avx2
+
+using namespace sponge_avx2;
+
+extern "C" void reducedSqueezeRow0_avx2(uint64_t* state, uint64_t* rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    uint64_t* ptrWord = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        Store(ptrWord, a);
+        Store(ptrWord + 4, b);
+        Store(ptrWord + 8, c);
+        ptrWord -= BLOCK_LEN_INT64;
+        ReducedBlake2bLyra(a, b, c, d);
+    }
+    Store(state, a); Store(state + 4, b); Store(state + 8, c); Store(state + 12, d);
+}
+
+extern "C" void reducedDuplexRow1_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        const __m256i in0 = Load(ptrWordIn), in1 = Load(ptrWordIn + 4), in2 = Load(ptrWordIn + 8);
+        a = Xor(a, in0); b = Xor(b, in1); c = Xor(c, in2);
+        ReducedBlake2bLyra(a, b, c, d);
+        Store(ptrWordOut, Xor(in0, a));
+        Store(ptrWordOut + 4, Xor(in1, b));
+        Store(ptrWordOut + 8, Xor(in2, c));
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    Store(state, a); Store(state + 4, b); Store(state + 8, c); Store(state + 12, d);
+}
+
+extern "C" void reducedDuplexRowSetup_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols - 1) * BLOCK_LEN_INT64;
+    for (uint64_t i = 0; i < nCols; i++) {
+        const __m256i in0 = Load(ptrWordIn), in1 = Load(ptrWordIn + 4), in2 = Load(ptrWordIn + 8);
+        const __m256i io0 = Load(ptrWordInOut), io1 = Load(ptrWordInOut + 4), io2 = Load(ptrWordInOut + 8);
+        a = Xor(a, Add(in0, io0)); b = Xor(b, Add(in1, io1)); c = Xor(c, Add(in2, io2));
+        ReducedBlake2bLyra(a, b, c, d);
+        // rowOut may be the same row as rowInOut, so it is written first as in the scalar code
+        Store(ptrWordOut, Xor(in0, a));
+        Store(ptrWordOut + 4, Xor(in1, b));
+        Store(ptrWordOut + 8, Xor(in2, c));
+        __m256i r0, r1, r2;
+        RotW(a, b, c, r0, r1, r2);
+        Store(ptrWordInOut, Xor(Load(ptrWordInOut), r0));
+        Store(ptrWordInOut + 4, Xor(Load(ptrWordInOut + 4), r1));
+        Store(ptrWordInOut + 8, Xor(Load(ptrWordInOut + 8), r2));
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    Store(state, a); Store(state + 4, b); Store(state + 8, c); Store(state + 12, d);
+}
+
+extern "C" void reducedDuplexRow_avx2(uint64_t* state, uint64_t* rowIn, uint64_t* rowInOut, uint64_t* rowOut, uint64_t nCols)
+{
+    __m256i a = Load(state), b = Load(state + 4), c = Load(state + 8), d = Load(state + 12);
+    const uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut;
+    for (uint64_t i = 0; i < nCols; i++) {
+        a = Xor(a, Add(Load(ptrWordIn), Load(ptrWordInOut)));
+        b = Xor(b, Add(Load(ptrWordIn + 4), Load(ptrWordInOut + 4)));
+        c = Xor(c, Add(Load(ptrWordIn + 8), Load(ptrWordInOut + 8)));
+        ReducedBlake2bLyra(a, b, c, d);
+        // rowOut, rowIn and rowInOut may alias, so every update reloads its row as the scalar code does
+        Store(ptrWordOut, Xor(Load(ptrWordOut), a));
+        Store(ptrWordOut + 4, Xor(Load(ptrWordOut + 4), b));
+        Store(ptrWordOut + 8, Xor(Load(ptrWordOut + 8), c));
+        __m256i r0, r1, r2;
+        RotW(a, b, c, r0, r1, r2);
+        Store(ptrWordInOut, Xor(Load(ptrWordInOut), r0));
+        Store(ptrWordInOut + 4, Xor(Load(ptrWordInOut + 4), r1));
+        Store(ptrWordInOut + 8, Xor(Load(ptrWordInOut + 8), r2));
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordOut += BLOCK_LEN_INT64;
+    }
+    Store(state, a); Store(state + 4, b); Store(state + 8, c); Store(state + 12, d);
+}
+
+#endif
@@ -37,6 +37,7 @@ CGovernanceObject::CGovernanceObject()
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  mapCurrentVoteCounts(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -65,6 +66,7 @@ CGovernanceObject::CGovernanceObject(uint256 nHashParentIn, int nRevisionIn, int
   fExpired(false),
   fUnparsable(false),
   mapCurrentMNVotes(),
+  mapCurrentVoteCounts(),
   mapOrphanVotes(),
   fileVotes()
 {
@@ -93,6 +95,7 @@ CGovernanceObject::CGovernanceObject(const CGovernanceObject& other)
   fExpired(other.fExpired),
   fUnparsable(other.fUnparsable),
   mapCurrentMNVotes(other.mapCurrentMNVotes),
+  mapCurrentVoteCounts(other.mapCurrentVoteCounts),
   mapOrphanVotes(other.mapOrphanVotes),
   fileVotes(other.fileVotes)
 {}
@@ -141,6 +144,9 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     vote_instance_m_it it2 = recVote.mapInstances.find(int(eSignal));
     if(it2 == recVote.mapInstances.end()) {
         it2 = recVote.mapInstances.insert(vote_instance_m_t::value_type(int(eSignal), vote_instance_t())).first;
+        // VELES BEGIN
+        ++mapCurrentVoteCounts[std::make_pair(int(eSignal), int(VOTE_OUTCOME_NONE))];
+        // VELES END
     }
     vote_instance_t& voteInstance = it2->second;
 
@@ -190,6 +196,10 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
         exception = CGovernanceException(ostr.str(), GOVERNANCE_EXCEPTION_PERMANENT_ERROR);
         return false;
     }
+    // VELES BEGIN
+    --mapCurrentVoteCounts[std::make_pair(int(eSignal), int(voteInstance.eOutcome))];
+    ++mapCurrentVoteCounts[std::make_pair(int(eSignal), int(vote.GetOutcome()))];
+    // VELES END
     voteInstance = vote_instance_t(vote.GetOutcome(), nVoteTimeUpdate, vote.GetTimestamp());
     if(!fileVotes.HasVote(vote.GetHash())) {
         fileVotes.AddVote(vote);
@@ -204,6 +214,11 @@ void CGovernanceObject::ClearMasternodeVotes()
     while(it != mapCurrentMNVotes.end()) {
         if(!mnodeman.Has(it->first)) {
             fileVotes.RemoveVotesFromMasternode(it->first);
+            // VELES BEGIN
+            for(vote_instance_m_cit it2 = it->second.mapInstances.begin(); it2 != it->second.mapInstances.end(); ++it2) {
+                --mapCurrentVoteCounts[std::make_pair(it2->first, int(it2->second.eOutcome))];
+            }
+            // VELES END
             mapCurrentMNVotes.erase(it++);
         }
         else {
@@ -597,20 +612,27 @@ bool CGovernanceObject::IsCollateralValid(std::string& strError, bool& fMissingC
 
 int CGovernanceObject::CountMatchingVotes(vote_signal_enum_t eVoteSignalIn, vote_outcome_enum_t eVoteOutcomeIn) const
 {
-    int nCount = 0;
+    // VELES BEGIN
+    vote_count_m_cit it = mapCurrentVoteCounts.find(std::make_pair(int(eVoteSignalIn), int(eVoteOutcomeIn)));
+    if(it == mapCurrentVoteCounts.end()) {
+        return 0;
+    }
+    return it->second;
+    // VELES END
+}
+
+// VELES BEGIN
+void CGovernanceObject::RebuildVoteCounts()
+{
+    mapCurrentVoteCounts.clear();
     for(vote_m_cit it = mapCurrentMNVotes.begin(); it != mapCurrentMNVotes.end(); ++it) {
         const vote_rec_t& recVote = it->second;
-        vote_instance_m_cit it2 = recVote.mapInstances.find(eVoteSignalIn);
-        if(it2 == recVote.mapInstances.end()) {
-            continue;
-        }
-        const vote_instance_t& voteInstance = it2->second;
-        if(voteInstance.eOutcome == eVoteOutcomeIn) {
-            ++nCount;
+        for(vote_instance_m_cit it2 = recVote.mapInstances.begin(); it2 != recVote.mapInstances.end(); ++it2) {
+            ++mapCurrentVoteCounts[std::make_pair(it2->first, int(it2->second.eOutcome))];
         }
     }
-    return nCount;
 }
+// VELES END
 
 /**
 *   Get specific vote counts for each outcome (funding, validity, etc)
@@ -125,6 +125,12 @@ public: // Types
 
     typedef CacheMultiMap<COutPoint, vote_time_pair_t> vote_mcache_t;
 
+    // VELES BEGIN
+    typedef std::map<std::pair<int, int>, int> vote_count_m_t;
+
+    typedef vote_count_m_t::const_iterator vote_count_m_cit;
+    // VELES END
+
 private:
     /// critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -185,6 +191,11 @@ private:
 
     vote_m_t mapCurrentMNVotes;
 
+    // VELES BEGIN
+    /// Number of current vote instances per (signal, outcome), kept in step with mapCurrentMNVotes
+    vote_count_m_t mapCurrentVoteCounts;
+    // VELES END
+
     /// Limited map of votes orphaned by MN
     vote_mcache_t mapOrphanVotes;
 
@@ -324,6 +335,11 @@ public:
             READWRITE(nDeletionTime);
             READWRITE(fExpired);
             READWRITE(mapCurrentMNVotes);
+            // VELES BEGIN
+            if(ser_action.ForRead()) {
+                RebuildVoteCounts();
+            }
+            // VELES END
             READWRITE(fileVotes);
             LogPrint(BCLog::GOBJECT, "CGovernanceObject::SerializationOp hash = %s, vote count = %d\n", GetHash().ToString(), fileVotes.GetVoteCount());
         }
@@ -347,6 +363,10 @@ private:
                      CGovernanceException& exception,
                      CConnman& connman);
 
+    // VELES BEGIN
+    void RebuildVoteCounts();
+    // VELES END
+
     /// Called when MN's which have voted on this object have been removed
     void ClearMasternodeVotes();
 
@@ -245,8 +245,9 @@ bool CGovernanceVote::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
     CKey keyCollateralAddress;
 
     std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
-        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
 
     if(!CMessageSigner::SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrintf("CGovernanceVote::Sign -- SignMessage() failed\n");
@@ -291,8 +292,9 @@ bool CGovernanceVote::IsValid(bool fSignatureCheck) const
     if(!fSignatureCheck) return true;
 
     std::string strError;
-    std::string strMessage = vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
-        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
 
     if(!CMessageSigner::VerifyMessage(infoMn.pubKeyMasternode, vchSig, strMessage, strError)) {
         LogPrintf("CGovernanceVote::IsValid -- VerifyMessage() failed, error: %s\n", strError);
@@ -302,6 +304,23 @@ bool CGovernanceVote::IsValid(bool fSignatureCheck) const
     return true;
 }
 
+// VELES BEGIN
+std::string CGovernanceVote::GetSignatureMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() + "|" + nParentHash.ToString() + "|" +
+        boost::lexical_cast<std::string>(nVoteSignal) + "|" + boost::lexical_cast<std::string>(nVoteOutcome) + "|" + boost::lexical_cast<std::string>(nTime);
+}
+
+bool CGovernanceVote::GetSignatureCheck(CHashSignatureCheck& checkRet) const
+{
+    masternode_info_t infoMn;
+    if(!mnodeman.GetMasternodeInfo(vinMasternode.prevout, infoMn)) return false;
+
+    checkRet = CHashSignatureCheck(CMessageSigner::GetMessageHash(GetSignatureMessage()), infoMn.pubKeyMasternode, vchSig);
+    return true;
+}
+// VELES END
+
 bool operator==(const CGovernanceVote& vote1, const CGovernanceVote& vote2)
 {
     bool fResult = ((vote1.vinMasternode == vote2.vinMasternode) &&
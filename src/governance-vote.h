@@ -16,6 +16,9 @@ using namespace std;
 
 class CGovernanceVote;
 class CConnman;
+// VELES BEGIN
+class CHashSignatureCheck;
+// VELES END
 
 // INTENTION OF MASTERNODES REGARDING ITEM
 enum vote_outcome_enum_t  {
@@ -125,6 +128,10 @@ public:
 
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     bool IsValid(bool fSignatureCheck) const;
+    // VELES BEGIN
+    std::string GetSignatureMessage() const;
+    bool GetSignatureCheck(CHashSignatureCheck& checkRet) const;
+    // VELES END
     void Relay(CConnman& connman) const;
 
     std::string GetVoteString() const {
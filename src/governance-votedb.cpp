@@ -8,13 +8,15 @@
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile()
     : nMemoryVotes(0),
       listVotes(),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapMasternodeIndex()
 {}
 
 CGovernanceObjectVoteFile::CGovernanceObjectVoteFile(const CGovernanceObjectVoteFile& other)
     : nMemoryVotes(other.nMemoryVotes),
       listVotes(other.listVotes),
-      mapVoteIndex()
+      mapVoteIndex(),
+      mapMasternodeIndex()
 {
     RebuildIndex();
 }
@@ -23,6 +25,7 @@ void CGovernanceObjectVoteFile::AddVote(const CGovernanceVote& vote)
 {
     listVotes.push_front(vote);
     mapVoteIndex[vote.GetHash()] = listVotes.begin();
+    mapMasternodeIndex.emplace(vote.GetMasternodeOutpoint(), listVotes.begin());
     ++nMemoryVotes;
 }
 
@@ -56,17 +59,15 @@ std::vector<CGovernanceVote> CGovernanceObjectVoteFile::GetVotes() const
 
 void CGovernanceObjectVoteFile::RemoveVotesFromMasternode(const COutPoint& outpointMasternode)
 {
-    vote_l_it it = listVotes.begin();
-    while(it != listVotes.end()) {
-        if(it->GetMasternodeOutpoint() == outpointMasternode) {
-            --nMemoryVotes;
-            mapVoteIndex.erase(it->GetHash());
-            listVotes.erase(it++);
-        }
-        else {
-            ++it;
-        }
+    // VELES BEGIN
+    std::pair<vote_mn_m_it, vote_mn_m_it> range = mapMasternodeIndex.equal_range(outpointMasternode);
+    for(vote_mn_m_it it = range.first; it != range.second; ++it) {
+        --nMemoryVotes;
+        mapVoteIndex.erase(it->second->GetHash());
+        listVotes.erase(it->second);
     }
+    mapMasternodeIndex.erase(range.first, range.second);
+    // VELES END
 }
 
 CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanceObjectVoteFile& other)
@@ -80,6 +81,7 @@ CGovernanceObjectVoteFile& CGovernanceObjectVoteFile::operator=(const CGovernanc
 void CGovernanceObjectVoteFile::RebuildIndex()
 {
     mapVoteIndex.clear();
+    mapMasternodeIndex.clear();
     nMemoryVotes = 0;
     vote_l_it it = listVotes.begin();
     while(it != listVotes.end()) {
@@ -87,6 +89,7 @@ void CGovernanceObjectVoteFile::RebuildIndex()
         uint256 nHash = vote.GetHash();
         if(mapVoteIndex.find(nHash) == mapVoteIndex.end()) {
             mapVoteIndex[nHash] = it;
+            mapMasternodeIndex.emplace(vote.GetMasternodeOutpoint(), it);
             ++nMemoryVotes;
             ++it;
         }
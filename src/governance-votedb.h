@@ -36,6 +36,12 @@ public: // Types
 
     typedef vote_m_t::const_iterator vote_m_cit;
 
+    // VELES BEGIN
+    typedef std::multimap<COutPoint,vote_l_it> vote_mn_m_t;
+
+    typedef vote_mn_m_t::iterator vote_mn_m_it;
+    // VELES END
+
 private:
     static const int MAX_MEMORY_VOTES = -1;
 
@@ -45,6 +51,11 @@ private:
 
     vote_m_t mapVoteIndex;
 
+    // VELES BEGIN
+    /// Votes by masternode collateral, so a masternode's votes can be dropped without a scan
+    vote_mn_m_t mapMasternodeIndex;
+    // VELES END
+
 public:
     CGovernanceObjectVoteFile();
 
@@ -71,6 +82,15 @@ public:
 
     std::vector<CGovernanceVote> GetVotes() const;
 
+    // VELES BEGIN
+    /**
+     * Votes keyed by their hash, for walking them without copying or rehashing
+     */
+    const vote_m_t& GetVoteIndex() const {
+        return mapVoteIndex;
+    }
+    // VELES END
+
     CGovernanceObjectVoteFile& operator=(const CGovernanceObjectVoteFile& other);
 
     void RemoveVotesFromMasternode(const COutPoint& outpointMasternode);
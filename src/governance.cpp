@@ -48,18 +48,24 @@ bool CGovernanceManager::HaveObjectForHash(uint256 nHash) {
     return (mapObjects.count(nHash) == 1 || mapPostponedObjects.count(nHash) == 1);
 }
 
-bool CGovernanceManager::SerializeObjectForHash(uint256 nHash, CDataStream& ss)
+// VELES BEGIN
+CSharedNetMsgRef CGovernanceManager::GetObjectMessage(const uint256& nHash)
 {
     LOCK(cs);
     object_m_it it = mapObjects.find(nHash);
     if (it == mapObjects.end()) {
         it = mapPostponedObjects.find(nHash);
         if (it == mapPostponedObjects.end())
-            return false;
+            return nullptr;
     }
-    ss << it->second;
-    return true;
+
+    // network serialization only covers the signed fields, which never change
+    CSharedNetMsgRef& message = mapObjectMessages[nHash];
+    if (!message)
+        message = MakeSharedNetMsg(NetMsgType::MNGOVERNANCEOBJECT, it->second);
+    return message;
 }
+// VELES END
 
 bool CGovernanceManager::HaveVoteForHash(uint256 nHash)
 {
@@ -82,23 +88,29 @@ int CGovernanceManager::GetVoteCount() const
     return (int)mapVoteToObject.GetSize();
 }
 
-bool CGovernanceManager::SerializeVoteForHash(uint256 nHash, CDataStream& ss)
+// VELES BEGIN
+CSharedNetMsgRef CGovernanceManager::GetVoteMessage(const uint256& nHash)
 {
     LOCK(cs);
 
     CGovernanceObject* pGovobj = NULL;
     if(!mapVoteToObject.Get(nHash,pGovobj)) {
-        return false;
+        return nullptr;
     }
 
-    CGovernanceVote vote;
-    if(!pGovobj->GetVoteFile().GetVote(nHash, vote)) {
-        return false;
+    if(!pGovobj->GetVoteFile().HasVote(nHash)) {
+        return nullptr;
     }
 
-    ss << vote;
-    return true;
+    CSharedNetMsgRef& message = mapVoteMessages[nHash];
+    if (!message) {
+        CGovernanceVote vote;
+        pGovobj->GetVoteFile().GetVote(nHash, vote);
+        message = MakeSharedNetMsg(NetMsgType::MNGOVERNANCEOBJECTVOTE, vote);
+    }
+    return message;
 }
+// VELES END
 
 void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
@@ -156,7 +168,12 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         uint256 nHash = govobj.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        // VELES BEGIN
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
+        // VELES END
 
         if(!masternodeSync.IsMasternodeListSynced()) {
             LogPrint(BCLog::GOBJECT, "MNGOVERNANCEOBJECT -- masternode list not synced\n");
@@ -240,7 +257,12 @@ void CGovernanceManager::ProcessMessage(CNode* pfrom, const std::string& strComm
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        // VELES BEGIN
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
+        // VELES END
 
         // Ignore such messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) {
@@ -558,6 +580,24 @@ void CGovernanceManager::UpdateCachesAndClean()
             ++s_it;
     }
 
+    // VELES BEGIN
+    // forget the messages of objects and votes that are gone
+    auto itObjectMessage = mapObjectMessages.begin();
+    while (itObjectMessage != mapObjectMessages.end()) {
+        if (!mapObjects.count(itObjectMessage->first) && !mapPostponedObjects.count(itObjectMessage->first))
+            mapObjectMessages.erase(itObjectMessage++);
+        else
+            ++itObjectMessage;
+    }
+    auto itVoteMessage = mapVoteMessages.begin();
+    while (itVoteMessage != mapVoteMessages.end()) {
+        if (!mapVoteToObject.HasKey(itVoteMessage->first))
+            mapVoteMessages.erase(itVoteMessage++);
+        else
+            ++itVoteMessage;
+    }
+    // VELES END
+
     LogPrintf("CGovernanceManager::UpdateCachesAndClean -- %s\n", ToString());
 }
 
@@ -595,32 +635,33 @@ std::vector<CGovernanceVote> CGovernanceManager::GetCurrentVotes(const uint256&
     if(it == mapObjects.end()) return vecResult;
     CGovernanceObject& govobj = it->second;
 
-    CMasternode mn;
-    std::map<COutPoint, CMasternode> mapMasternodes;
-    if(mnCollateralOutpointFilter == COutPoint()) {
-        mapMasternodes = mnodeman.GetFullMasternodeMap();
-    } else if (mnodeman.Get(mnCollateralOutpointFilter, mn)) {
-        mapMasternodes[mnCollateralOutpointFilter] = mn;
+    // VELES BEGIN
+    // Walk the votes the object holds instead of every known masternode,
+    // only keeping those of masternodes that are still in the list
+    CGovernanceObject::vote_m_cit itBegin = govobj.mapCurrentMNVotes.begin();
+    CGovernanceObject::vote_m_cit itEnd = govobj.mapCurrentMNVotes.end();
+    if(mnCollateralOutpointFilter != COutPoint()) {
+        itBegin = govobj.mapCurrentMNVotes.find(mnCollateralOutpointFilter);
+        if(itBegin != itEnd) itEnd = std::next(itBegin);
     }
 
-    // Loop thru each MN collateral outpoint and get the votes for the `nParentHash` governance object
-    for (auto& mnpair : mapMasternodes)
+    for (CGovernanceObject::vote_m_cit it2 = itBegin; it2 != itEnd; ++it2)
     {
-        // get a vote_rec_t from the govobj
-        vote_rec_t voteRecord;
-        if (!govobj.GetCurrentMNVotes(mnpair.first, voteRecord)) continue;
+        if (!mnodeman.Has(it2->first)) continue;
 
-        for (vote_instance_m_it it3 = voteRecord.mapInstances.begin(); it3 != voteRecord.mapInstances.end(); ++it3) {
+        const vote_rec_t& voteRecord = it2->second;
+        for (vote_instance_m_cit it3 = voteRecord.mapInstances.begin(); it3 != voteRecord.mapInstances.end(); ++it3) {
             int signal = (it3->first);
             int outcome = ((it3->second).eOutcome);
             int64_t nCreationTime = ((it3->second).nCreationTime);
 
-            CGovernanceVote vote = CGovernanceVote(mnpair.first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
+            CGovernanceVote vote = CGovernanceVote(it2->first, nParentHash, (vote_signal_enum_t)signal, (vote_outcome_enum_t)outcome);
             vote.SetTime(nCreationTime);
 
             vecResult.push_back(vote);
         }
     }
+    // VELES END
 
     return vecResult;
 }
@@ -798,17 +839,19 @@ void CGovernanceManager::Sync(CNode* pfrom, const uint256& nProp, const CBloomFi
             pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT, it->first));
             ++nObjCount;
 
-            std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                if(filter.contains(vecVotes[i].GetHash())) {
+            // VELES BEGIN
+            const CGovernanceObjectVoteFile::vote_m_t& mapVotes = govobj.GetVoteFile().GetVoteIndex();
+            for(CGovernanceObjectVoteFile::vote_m_cit it2 = mapVotes.begin(); it2 != mapVotes.end(); ++it2) {
+                if(filter.contains(it2->first)) {
                     continue;
                 }
-                if(!vecVotes[i].IsValid(true)) {
+                if(!it2->second->IsValid(true)) {
                     continue;
                 }
-                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, vecVotes[i].GetHash()));
+                pfrom->PushInventory(CInv(MSG_GOVERNANCE_OBJECT_VOTE, it2->first));
                 ++nVoteCount;
             }
+            // VELES END
         }
     }
 
@@ -1125,11 +1168,13 @@ void CGovernanceManager::RequestGovernanceObject(CNode* pfrom, const uint256& nH
 
         if(pObj) {
             filter = CBloomFilter(Params().GetConsensus().nGovernanceFilterElements, GOVERNANCE_FILTER_FP_RATE, GetRandInt(999999), BLOOM_UPDATE_ALL);
-            std::vector<CGovernanceVote> vecVotes = pObj->GetVoteFile().GetVotes();
-            nVoteCount = vecVotes.size();
-            for(size_t i = 0; i < vecVotes.size(); ++i) {
-                filter.insert(vecVotes[i].GetHash());
+            // VELES BEGIN
+            const CGovernanceObjectVoteFile::vote_m_t& mapVotes = pObj->GetVoteFile().GetVoteIndex();
+            nVoteCount = mapVotes.size();
+            for(CGovernanceObjectVoteFile::vote_m_cit it = mapVotes.begin(); it != mapVotes.end(); ++it) {
+                filter.insert(it->first);
             }
+            // VELES END
         }
     }
 
@@ -1276,10 +1321,12 @@ void CGovernanceManager::RebuildIndexes()
     mapVoteToObject.Clear();
     for(object_m_it it = mapObjects.begin(); it != mapObjects.end(); ++it) {
         CGovernanceObject& govobj = it->second;
-        std::vector<CGovernanceVote> vecVotes = govobj.GetVoteFile().GetVotes();
-        for(size_t i = 0; i < vecVotes.size(); ++i) {
-            mapVoteToObject.Insert(vecVotes[i].GetHash(), &govobj);
+        // VELES BEGIN
+        const CGovernanceObjectVoteFile::vote_m_t& mapVotes = govobj.GetVoteFile().GetVoteIndex();
+        for(CGovernanceObjectVoteFile::vote_m_cit it2 = mapVotes.begin(); it2 != mapVotes.end(); ++it2) {
+            mapVoteToObject.Insert(it2->first, &govobj);
         }
+        // VELES END
     }
 }
 
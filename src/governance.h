@@ -266,6 +266,12 @@ private:
 
     bool fRateChecksEnabled;
 
+    // VELES BEGIN
+    // serialized once for all the peers asking for them
+    std::map<uint256, CSharedNetMsgRef> mapObjectMessages;
+    std::map<uint256, CSharedNetMsgRef> mapVoteMessages;
+    // VELES END
+
     class ScopedLockBool
     {
         bool& ref;
@@ -335,6 +341,10 @@ public:
         mapInvalidVotes.Clear();
         mapOrphanVotes.Clear();
         mapLastMasternodeObject.clear();
+        // VELES BEGIN
+        mapObjectMessages.clear();
+        mapVoteMessages.clear();
+        // VELES END
     }
 
     std::string ToString() const;
@@ -367,6 +377,34 @@ public:
         }
     }
 
+    // VELES BEGIN
+    /** CJournalDB support: the state that is not stored object by object */
+    template <typename Stream, typename Operation>
+    inline void JournalBaseOp(Stream& s, Operation ser_action) {
+        LOCK(cs);
+        std::string strVersion = SERIALIZATION_VERSION_STRING;
+        READWRITE(strVersion);
+        if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
+            throw std::ios_base::failure("CGovernanceManager: unknown version " + strVersion);
+        }
+
+        READWRITE(mapErasedGovernanceObjects);
+        READWRITE(mapInvalidVotes);
+        READWRITE(mapOrphanVotes);
+        READWRITE(mapWatchdogObjects);
+        READWRITE(nHashWatchdogCurrent);
+        READWRITE(nTimeWatchdogCurrent);
+        READWRITE(mapLastMasternodeObject);
+    }
+
+    /** CJournalDB support: governance objects carry their votes, store them one by one */
+    template <typename Journal>
+    void JournalMapsOp(Journal& journal) {
+        LOCK(cs);
+        journal.Map(1, mapObjects);
+    }
+    // VELES END
+
     void UpdatedBlockTip(const CBlockIndex *pindex, CConnman& connman);
     int64_t GetLastDiffTime() { return nTimeLastDiff; }
     void UpdateLastDiffTime(int64_t nTimeIn) { nTimeLastDiff = nTimeIn; }
@@ -380,9 +418,13 @@ public:
 
     int GetVoteCount() const;
 
-    bool SerializeObjectForHash(uint256 nHash, CDataStream& ss);
+    // VELES BEGIN
+    /// Message for an object, serialized once and shared by all requests, NULL if there is none
+    CSharedNetMsgRef GetObjectMessage(const uint256& nHash);
 
-    bool SerializeVoteForHash(uint256 nHash, CDataStream& ss);
+    /// Message for a vote, serialized once and shared by all requests, NULL if there is none
+    CSharedNetMsgRef GetVoteMessage(const uint256& nHash);
+    // VELES END
 
     void AddPostponedObject(const CGovernanceObject& govobj)
     {
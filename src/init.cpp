@@ -56,7 +56,7 @@
 // Dasg
 #include <activemasternode.h>
 #include <dsnotificationinterface.h>
-#include <flat-database.h>
+#include <journal-database.h>
 #include <governance.h>
 #include <instantx.h>
 #ifdef ENABLE_WALLET
@@ -79,6 +79,10 @@
 //
 // FXTC END
 // VELES BEGIN
+#include <crypto/lyra2.h>
+#include <crypto/scrypt.h>
+#include <pow.h>
+#include <stratum.h>
 #include <veleslogo.h>
 // VELES END
 
@@ -203,6 +207,14 @@ static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 static boost::thread_group threadGroup;
 static CScheduler scheduler;
 
+// VELES BEGIN
+// Kept from load to dump, so that shutdown only appends what changed
+static CJournalDB<CMasternodeMan> journaldbMasternodeMan("mncache.dat", "magicMasternodeCache");
+static CJournalDB<CMasternodePayments> journaldbMasternodePayments("mnpayments.dat", "magicMasternodePaymentsCache");
+static CJournalDB<CGovernanceManager> journaldbGovernance("governance.dat", "magicGovernanceCache");
+static CJournalDB<CNetFulfilledRequestManager> journaldbNetFulfilled("netfulfilled.dat", "magicFulfilledCache");
+// VELES END
+
 void Interrupt()
 {
     InterruptHTTPServer();
@@ -210,6 +222,9 @@ void Interrupt()
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    // VELES BEGIN
+    InterruptStratumServer();
+    // VELES END
     InterruptMapPort();
     if (g_connman)
         g_connman->Interrupt();
@@ -237,6 +252,9 @@ void Shutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    // VELES BEGIN
+    StopStratumServer();
+    // VELES END
     g_wallet_init_interface.Flush();
     StopMapPort();
 
@@ -265,14 +283,12 @@ void Shutdown()
 
     // Dash
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
-    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-    flatdb1.Dump(mnodeman);
-    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-    flatdb2.Dump(mnpayments);
-    CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
-    flatdb3.Dump(governance);
-    CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
-    flatdb4.Dump(netfulfilledman);
+    // VELES BEGIN
+    journaldbMasternodeMan.Dump(mnodeman);
+    journaldbMasternodePayments.Dump(mnpayments);
+    journaldbGovernance.Dump(governance);
+    journaldbNetFulfilled.Dump(netfulfilledman);
+    // VELES END
     //
 
     if (fFeeEstimatesInitialized)
@@ -473,6 +489,9 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), false, OptionsCategory::CONNECTION);
+    // VELES BEGIN
+    gArgs.AddArg("-mnmsgthreads=<n>", strprintf("Set the number of threads processing masternode, governance, InstantSend and PrivateSend messages, 0 = use the message handler thread (0 to %d, default: %d)", MAX_MNMSG_THREADS, DEFAULT_MNMSG_THREADS), false, OptionsCategory::CONNECTION);
+    // VELES END
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
@@ -516,6 +535,9 @@ void SetupServerArgs()
     gArgs.AddArg("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. (default: %u)", defaultChainParams->DefaultConsistencyChecks()), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED), true, OptionsCategory::DEBUG_TEST);
+    // VELES BEGIN
+    gArgs.AddArg("-checkpowonload=<n>", strprintf("Percentage of block headers with already verified proof of work to hash again when loading the block index (0-100, default: %u)", DEFAULT_CHECKPOWONLOAD), true, OptionsCategory::DEBUG_TEST);
+    // VELES END
     gArgs.AddArg("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages", true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", DEFAULT_STOPAFTERBLOCKIMPORT), true, OptionsCategory::DEBUG_TEST);
@@ -534,6 +556,9 @@ void SetupServerArgs()
     gArgs.AddArg("-logtimestamps", strprintf("Prepend debug output with timestamp (default: %u)", DEFAULT_LOGTIMESTAMPS), false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-logtimemicros", strprintf("Add microsecond precision to debug timestamps (default: %u)", DEFAULT_LOGTIMEMICROS), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-mocktime=<n>", "Replace actual time with <n> seconds since epoch (default: 0)", true, OptionsCategory::DEBUG_TEST);
+    // VELES BEGIN
+    gArgs.AddArg("-maxpowcachesize=<n>", strprintf("Limit the cache of headers that passed their proof of work check to <n> MiB (default: %u)", DEFAULT_MAX_POW_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
+    // VELES END
     gArgs.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), true, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtxfee=<amt>", strprintf("Maximum total fees (in %s) to use in a single wallet transaction or raw transaction; setting this too low may abort large transactions (default: %s)",
@@ -565,6 +590,9 @@ void SetupServerArgs()
     // VELES BEGIN
     //gArgs.AddArg("-algo=<algo>", strprintf("Mining algorithm: sha256d, scrypt, lyra2z, x11, x16r (default: sha256)"), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-algo=<algo>", strprintf("Mining algorithm: sha256d, scrypt, lyra2z, x11, x16r (default: scrypt)"), false, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratum=<port>", "Serve stratum v1 mining jobs on <port>. Miners log in with their payout address as username and may pass algo=<algo>,d=<difficulty> as password (default: disabled)", false, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumbind=<addr>", strprintf("Bind the stratum server to the given address (default: %s)", DEFAULT_STRATUM_BIND), false, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stratumdifficulty=<n>", strprintf("Share difficulty of stratum miners that don't ask for one (default: %g)", DEFAULT_STRATUM_DIFFICULTY), false, OptionsCategory::BLOCK_CREATION);
     // VELES END
     // FXTC END
 
@@ -1294,6 +1322,11 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    // VELES BEGIN
+    std::string scrypt_algo = ScryptAutoDetect();
+    LogPrintf("Using the '%s' multi-lane scrypt implementation\n", scrypt_algo);
+    LogPrintf("Using the '%s' Lyra2 sponge implementation\n", Lyra2AutoDetect());
+    // VELES END
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1357,11 +1390,19 @@ bool AppInitMain()
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    // VELES BEGIN
+    InitPoWCache();
+    // VELES END
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            // VELES BEGIN
+            threadGroup.create_thread(&ThreadPoWHashCheck);
+            threadGroup.create_thread(&ThreadHashSignatureCheck);
+            // VELES END
+        }
     }
 
     // Dash
@@ -1521,6 +1562,10 @@ bool AppInitMain()
 
     // ********************************************************* Step 7: load block chain
 
+    // VELES BEGIN
+    sporkManager.NotifySporkChanged.connect(&RewardSporkChanged);
+    // VELES END
+
     fReindex = gArgs.GetBoolArg("-reindex", false);
     bool fReindexChainState = gArgs.GetBoolArg("-reindex-chainstate", false);
 
@@ -1885,23 +1930,20 @@ bool AppInitMain()
 
     strDBName = "mncache.dat";
     uiInterface.InitMessage(_("Loading masternode cache..."));
-    CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
-    if(!flatdb1.Load(mnodeman)) {
+    if(!journaldbMasternodeMan.Load(mnodeman)) {
         return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
     }
 
     if(mnodeman.size()) {
         strDBName = "mnpayments.dat";
         uiInterface.InitMessage(_("Loading masternode payment cache..."));
-        CFlatDB<CMasternodePayments> flatdb2(strDBName, "magicMasternodePaymentsCache");
-        if(!flatdb2.Load(mnpayments)) {
+        if(!journaldbMasternodePayments.Load(mnpayments)) {
             return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
         }
 
         strDBName = "governance.dat";
         uiInterface.InitMessage(_("Loading governance cache..."));
-        CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
-        if(!flatdb3.Load(governance)) {
+        if(!journaldbGovernance.Load(governance)) {
             return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
         }
         governance.InitOnLoad();
@@ -1911,8 +1953,7 @@ bool AppInitMain()
 
     strDBName = "netfulfilled.dat";
     uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
-    CFlatDB<CNetFulfilledRequestManager> flatdb4(strDBName, "magicFulfilledCache");
-    if(!flatdb4.Load(netfulfilledman)) {
+    if(!journaldbNetFulfilled.Load(netfulfilledman)) {
         return InitError(_("Failed to load fulfilled requests cache from") + "\n" + (pathDB / strDBName).string());
     }
 
@@ -1968,6 +2009,9 @@ bool AppInitMain()
     connOptions.nSendBufferMaxSize = 1000*gArgs.GetArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000*gArgs.GetArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
     connOptions.m_added_nodes = gArgs.GetArgs("-addnode");
+    // VELES BEGIN
+    connOptions.nMasternodeMessageThreads = std::max(0, std::min<int>(MAX_MNMSG_THREADS, gArgs.GetArg("-mnmsgthreads", DEFAULT_MNMSG_THREADS)));
+    // VELES END
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
@@ -2012,6 +2056,11 @@ bool AppInitMain()
         return false;
     }
 
+    // VELES BEGIN
+    if (!StartStratumServer())
+        return false;
+    // VELES END
+
     // ********************************************************* Step 13: finished
 
     SetRPCWarmupFinished();
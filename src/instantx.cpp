@@ -62,7 +62,12 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
 
         uint256 nVoteHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nVoteHash);
+        // VELES BEGIN
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nVoteHash);
+        }
+        // VELES END
 
         // Ignore any InstantSend messages until masternode list is synced
         if(!masternodeSync.IsMasternodeListSynced()) return;
@@ -546,21 +551,64 @@ void CInstantSend::LockTransactionInputs(const CTxLockCandidate& txLockCandidate
 
     std::map<COutPoint, COutPointLock>::const_iterator it = txLockCandidate.mapOutPointLocks.begin();
 
+    // VELES BEGIN
+    std::set<COutPoint> setOutpoints;
+    bool fLocked = it != txLockCandidate.mapOutPointLocks.end();
+    // VELES END
     while(it != txLockCandidate.mapOutPointLocks.end()) {
-        mapLockedOutpoints.insert(std::make_pair(it->first, txHash));
+        // VELES BEGIN
+        std::pair<std::map<COutPoint, uint256>::iterator, bool> ret = mapLockedOutpoints.insert(std::make_pair(it->first, txHash));
+        if(ret.second) setOutpoints.insert(it->first);
+        // a transaction is locked when all of its outpoints are locked for it
+        if(ret.first->second != txHash) fLocked = false;
+        // VELES END
         ++it;
     }
+    // VELES BEGIN
+    std::set<uint256> setTxids;
+    if(fLocked && setLockedTxids.insert(txHash).second) setTxids.insert(txHash);
+    PublishLockChanges(setOutpoints, setTxids);
+    // VELES END
     LogPrint(BCLog::INSTANTSEND, "CInstantSend::LockTransactionInputs -- done, txid=%s\n", txHash.ToString());
 }
 
 bool CInstantSend::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet)
 {
-    LOCK(cs_instantsend);
-    std::map<COutPoint, uint256>::iterator it = mapLockedOutpoints.find(outpoint);
-    if(it == mapLockedOutpoints.end()) return false;
-    hashRet = it->second;
-    return true;
+    // VELES BEGIN
+    std::shared_ptr<const CInstantSendLocksView> pView = std::atomic_load(&pLocksView);
+    return pView && pView->GetLockedOutPointTxHash(outpoint, hashRet);
+    // VELES END
+}
+
+// VELES BEGIN
+void CInstantSend::PublishLockChanges(const std::set<COutPoint>& setOutpoints, const std::set<uint256>& setTxids)
+{
+    AssertLockHeld(cs_instantsend);
+
+    if(setOutpoints.empty() && setTxids.empty()) return;
+
+    std::shared_ptr<CInstantSendLocksView> pNewView;
+    if(pLocksView) {
+        // share the base with the current view, copy only its changes
+        pNewView = std::make_shared<CInstantSendLocksView>(*pLocksView);
+        for (const auto& outpoint : setOutpoints) {
+            std::map<COutPoint, uint256>::const_iterator it = mapLockedOutpoints.find(outpoint);
+            pNewView->mapChangedOutpoints[outpoint] = it == mapLockedOutpoints.end() ? uint256() : it->second;
+        }
+        for (const auto& txHash : setTxids)
+            pNewView->mapChangedTxids[txHash] = setLockedTxids.count(txHash) > 0;
+    }
+
+    if(!pNewView || 4 * (pNewView->mapChangedOutpoints.size() + pNewView->mapChangedTxids.size()) >
+                    pNewView->pBaseOutpoints->size() + pNewView->pBaseTxids->size()) {
+        pNewView = std::make_shared<CInstantSendLocksView>();
+        pNewView->pBaseOutpoints = std::make_shared<const std::map<COutPoint, uint256> >(mapLockedOutpoints);
+        pNewView->pBaseTxids = std::make_shared<const std::set<uint256> >(setLockedTxids);
+    }
+
+    std::atomic_store(&pLocksView, std::shared_ptr<const CInstantSendLocksView>(pNewView));
 }
+// VELES END
 
 bool CInstantSend::ResolveConflicts(const CTxLockCandidate& txLockCandidate)
 {
@@ -665,6 +713,10 @@ void CInstantSend::CheckAndRemove()
     LOCK(cs_instantsend);
 
     std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.begin();
+    // VELES BEGIN
+    std::set<COutPoint> setOutpoints;
+    std::set<uint256> setTxids;
+    // VELES END
 
     // remove expired candidates
     while(itLockCandidate != mapTxLockCandidates.end()) {
@@ -674,7 +726,15 @@ void CInstantSend::CheckAndRemove()
             LogPrintf("CInstantSend::CheckAndRemove -- Removing expired Transaction Lock Candidate: txid=%s\n", txHash.ToString());
             std::map<COutPoint, COutPointLock>::iterator itOutpointLock = txLockCandidate.mapOutPointLocks.begin();
             while(itOutpointLock != txLockCandidate.mapOutPointLocks.end()) {
-                mapLockedOutpoints.erase(itOutpointLock->first);
+                // VELES BEGIN
+                // the outpoint may be locked for a conflicting transaction, which loses its lock too
+                std::map<COutPoint, uint256>::iterator itLocked = mapLockedOutpoints.find(itOutpointLock->first);
+                if(itLocked != mapLockedOutpoints.end()) {
+                    setOutpoints.insert(itLocked->first);
+                    if(setLockedTxids.erase(itLocked->second)) setTxids.insert(itLocked->second);
+                    mapLockedOutpoints.erase(itLocked);
+                }
+                // VELES END
                 mapVotedOutpoints.erase(itOutpointLock->first);
                 ++itOutpointLock;
             }
@@ -685,6 +745,9 @@ void CInstantSend::CheckAndRemove()
             ++itLockCandidate;
         }
     }
+    // VELES BEGIN
+    PublishLockChanges(setOutpoints, setTxids);
+    // VELES END
 
     // remove expired votes
     std::map<uint256, CTxLockVote>::iterator itVote = mapTxLockVotes.begin();
@@ -802,24 +865,11 @@ bool CInstantSend::IsLockedInstantSendTransaction(const uint256& txHash)
     if(!fEnableInstantSend || fLargeWorkForkFound || fLargeWorkInvalidChainFound ||
         !sporkManager.IsSporkActive(SPORK_3_INSTANTSEND_BLOCK_FILTERING)) return false;
 
-    LOCK(cs_instantsend);
-
-    // there must be a lock candidate
-    std::map<uint256, CTxLockCandidate>::iterator itLockCandidate = mapTxLockCandidates.find(txHash);
-    if(itLockCandidate == mapTxLockCandidates.end()) return false;
-
-    // which should have outpoints
-    if(itLockCandidate->second.mapOutPointLocks.empty()) return false;
-
-    // and all of these outputs must be included in mapLockedOutpoints with correct hash
-    std::map<COutPoint, COutPointLock>::iterator itOutpointLock = itLockCandidate->second.mapOutPointLocks.begin();
-    while(itOutpointLock != itLockCandidate->second.mapOutPointLocks.end()) {
-        uint256 hashLocked;
-        if(!GetLockedOutPointTxHash(itOutpointLock->first, hashLocked) || hashLocked != txHash) return false;
-        ++itOutpointLock;
-    }
-
-    return true;
+    // VELES BEGIN
+    // Read the published view instead of walking the lock candidate under cs_instantsend
+    std::shared_ptr<const CInstantSendLocksView> pView = std::atomic_load(&pLocksView);
+    return pView && pView->IsLockedTransaction(txHash);
+    // VELES END
 }
 
 int CInstantSend::GetTransactionLockSignatures(const uint256& txHash)
@@ -945,6 +995,34 @@ std::string CInstantSend::ToString()
     return strprintf("Lock Candidates: %llu, Votes %llu", mapTxLockCandidates.size(), mapTxLockVotes.size());
 }
 
+// VELES BEGIN
+//
+// CInstantSendLocksView
+//
+
+bool CInstantSendLocksView::GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet) const
+{
+    std::map<COutPoint, uint256>::const_iterator itChanged = mapChangedOutpoints.find(outpoint);
+    if(itChanged != mapChangedOutpoints.end()) {
+        if(itChanged->second.IsNull()) return false;
+        hashRet = itChanged->second;
+        return true;
+    }
+
+    std::map<COutPoint, uint256>::const_iterator it = pBaseOutpoints->find(outpoint);
+    if(it == pBaseOutpoints->end()) return false;
+    hashRet = it->second;
+    return true;
+}
+
+bool CInstantSendLocksView::IsLockedTransaction(const uint256& txHash) const
+{
+    std::map<uint256, bool>::const_iterator itChanged = mapChangedTxids.find(txHash);
+    if(itChanged != mapChangedTxids.end()) return itChanged->second;
+    return pBaseTxids->count(txHash) > 0;
+}
+// VELES END
+
 //
 // CTxLockRequest
 //
@@ -1068,7 +1146,9 @@ uint256 CTxLockVote::GetHash() const
 bool CTxLockVote::CheckSignature() const
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
 
     masternode_info_t infoMn;
 
@@ -1085,10 +1165,28 @@ bool CTxLockVote::CheckSignature() const
     return true;
 }
 
+// VELES BEGIN
+std::string CTxLockVote::GetSignatureMessage() const
+{
+    return txHash.ToString() + outpoint.ToStringShort();
+}
+
+bool CTxLockVote::GetSignatureCheck(CHashSignatureCheck& checkRet) const
+{
+    masternode_info_t infoMn;
+    if(!mnodeman.GetMasternodeInfo(outpointMasternode, infoMn)) return false;
+
+    checkRet = CHashSignatureCheck(CMessageSigner::GetMessageHash(GetSignatureMessage()), infoMn.pubKeyMasternode, vchMasternodeSignature);
+    return true;
+}
+// VELES END
+
 bool CTxLockVote::Sign()
 {
     std::string strError;
-    std::string strMessage = txHash.ToString() + outpoint.ToStringShort();
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
 
     if(!CMessageSigner::SignMessage(strMessage, vchMasternodeSignature, activeMasternode.keyMasternode)) {
         LogPrintf("CTxLockVote::Sign -- SignMessage() failed\n");
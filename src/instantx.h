@@ -15,6 +15,9 @@ class COutPointLock;
 class CTxLockRequest;
 class CTxLockCandidate;
 class CInstantSend;
+// VELES BEGIN
+class CHashSignatureCheck;
+// VELES END
 
 extern CInstantSend instantsend;
 
@@ -43,6 +46,26 @@ extern bool fEnableInstantSend;
 extern int nInstantSendDepth;
 extern int nCompleteTXLocks;
 
+// VELES BEGIN
+/**
+ * Immutable view of the completed InstantSend locks. Views share their base
+ * copy of the locks and only carry the changes made since it was taken; the
+ * changes are folded into a new base once they outgrow a quarter of it.
+ */
+class CInstantSendLocksView
+{
+public:
+    std::shared_ptr<const std::map<COutPoint, uint256> > pBaseOutpoints; // utxo - tx hash
+    std::shared_ptr<const std::set<uint256> > pBaseTxids; // tx hash
+    // changes since the base, a null tx hash or false for a removed lock
+    std::map<COutPoint, uint256> mapChangedOutpoints; // utxo - tx hash
+    std::map<uint256, bool> mapChangedTxids; // tx hash - locked
+
+    bool GetLockedOutPointTxHash(const COutPoint& outpoint, uint256& hashRet) const;
+    bool IsLockedTransaction(const uint256& txHash) const;
+};
+// VELES END
+
 class CInstantSend
 {
 private:
@@ -60,6 +83,13 @@ private:
     std::map<COutPoint, std::set<uint256> > mapVotedOutpoints; // utxo - tx hash set
     std::map<COutPoint, uint256> mapLockedOutpoints; // utxo - tx hash
 
+    // VELES BEGIN
+    std::set<uint256> setLockedTxids; // tx hash
+    // Published under cs_instantsend whenever the completed locks change,
+    // so that wallet queries can read them without taking the lock
+    std::shared_ptr<const CInstantSendLocksView> pLocksView;
+    // VELES END
+
     //track masternodes who voted with no txreq (for DOS protection)
     std::map<COutPoint, int64_t> mapMasternodeOrphanVotes; // mn outpoint - time
 
@@ -79,6 +109,9 @@ private:
     //update UI and notify external script if any
     void UpdateLockedTransaction(const CTxLockCandidate& txLockCandidate);
     bool ResolveConflicts(const CTxLockCandidate& txLockCandidate);
+    // VELES BEGIN
+    void PublishLockChanges(const std::set<COutPoint>& setOutpoints, const std::set<uint256>& setTxids);
+    // VELES END
 
     bool IsInstantSendReadyToLock(const uint256 &txHash);
 
@@ -196,6 +229,10 @@ public:
 
     bool Sign();
     bool CheckSignature() const;
+    // VELES BEGIN
+    std::string GetSignatureMessage() const;
+    bool GetSignatureCheck(CHashSignatureCheck& checkRet) const;
+    // VELES END
 
     void Relay(CConnman& connman) const;
 };
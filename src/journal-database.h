@@ -0,0 +1,558 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VELES_JOURNAL_DATABASE_H
+#define VELES_JOURNAL_DATABASE_H
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <crypto/common.h>
+#include <flat-database.h>
+#include <hash.h>
+#include <streams.h>
+#include <util.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+/**
+*   Journaled Dumping and Loading
+*   -----------------------------
+*
+*   A journal file starts with a header and continues with records:
+*
+*     header: JOURNAL_FILE_MAGIC, magic message, network magic number
+*     record: payload size, payload, first four bytes of Hash(payload)
+*
+*   The big maps of T are stored entry by entry, so a dump only appends
+*   the entries that changed or disappeared since the previous one. The rest
+*   of the state is small and stored whole by every dump. A dump ends with a
+*   commit record; a torn or corrupted tail after the last commit is dropped
+*   on load. Records are limited to MAX_SIZE bytes: the base state is split
+*   over as many base records as it takes, a map entry too big for a record
+*   fails the dump. The file is rewritten from scratch (compacted) once it holds
+*   more stale records than live ones.
+*
+*   T provides the two operations below. JournalBaseOp serializes everything
+*   that is not stored entry by entry, it throws on an unknown version.
+*   JournalMapsOp calls journal.Map(nId, map) for every std::map stored entry
+*   by entry; journal.ForRead() tells a load from a dump, like ser_action does,
+*   for state derived from the maps.
+*
+*     template <typename Stream, typename Operation>
+*     void JournalBaseOp(Stream& s, Operation ser_action);
+*     template <typename Journal>
+*     void JournalMapsOp(Journal& journal);
+*
+*   Files in the CFlatDB format are still loaded, the next dump converts them.
+*/
+
+static const unsigned char JOURNAL_FILE_MAGIC[8] = {'V', 'E', 'L', 'E', 'S', 'J', 'D', 'B'};
+//! Base state bytes per base record, leaving room for the record type and the blob size
+static const size_t JOURNAL_MAX_BASE_CHUNK_SIZE = MAX_SIZE - 16;
+
+template<typename T>
+class CJournalDB
+{
+private:
+
+    enum RecordType : uint8_t {
+        RECORD_BASE = 1,
+        RECORD_PUT = 2,
+        RECORD_ERASE = 3,
+        RECORD_COMMIT = 4
+    };
+
+    enum ReadResult {
+        Ok,
+        FileError,
+        IncorrectMagicMessage,
+        IncorrectMagicNumber,
+        IncorrectFormat,
+        LegacyFormat
+    };
+
+    typedef std::vector<unsigned char> blob_t;
+    typedef std::pair<uint8_t, blob_t> entry_key_t;
+
+    /** What the file currently holds for one map entry */
+    struct EntryInfo
+    {
+        uint64_t nChecksum;
+        uint32_t nRecordSize;
+        //! Last dump that found the entry in T, the others erase it
+        uint64_t nDump;
+    };
+
+    /** A map entry record read from the file, not committed yet */
+    struct PendingEntry
+    {
+        bool fErase;
+        blob_t vchValue;
+        uint32_t nRecordSize;
+    };
+
+    /** Adapts T::JournalBaseOp to the serialization framework */
+    struct BaseWrapper
+    {
+        T& obj;
+        explicit BaseWrapper(T& objIn) : obj(objIn) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            obj.JournalBaseOp(s, ser_action);
+        }
+    };
+
+    /**
+     * Compares the map entries of T with what the file holds, entry by entry,
+     * and keeps only the changed ones. Every entry is still serialized, as T
+     * does not track its changes, but no copy of the unchanged ones is made.
+     */
+    struct MapWriter
+    {
+        std::map<entry_key_t, EntryInfo>& mapFileEntries;
+        const uint64_t nDump;
+        //! Entries to write, with no value for the erased ones
+        std::vector<std::pair<entry_key_t, std::unique_ptr<blob_t>>> vChanges;
+
+        MapWriter(std::map<entry_key_t, EntryInfo>& mapFileEntriesIn, uint64_t nDumpIn) : mapFileEntries(mapFileEntriesIn), nDump(nDumpIn) {}
+
+        constexpr bool ForRead() const { return false; }
+
+        template <typename K, typename V, typename Pred, typename A>
+        void Map(uint8_t nId, const std::map<K, V, Pred, A>& m)
+        {
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            for (const auto& item : m) {
+                ssKey.clear();
+                ssKey << item.first;
+                ssValue.clear();
+                ssValue << item.second;
+                entry_key_t key(nId, blob_t(ssKey.begin(), ssKey.end()));
+                auto it = mapFileEntries.find(key);
+                if (it != mapFileEntries.end()) {
+                    it->second.nDump = nDump;
+                    if (it->second.nChecksum == EntryChecksum(ssValue.begin(), ssValue.end()))
+                        continue;
+                }
+                vChanges.emplace_back(std::move(key), std::unique_ptr<blob_t>(new blob_t(ssValue.begin(), ssValue.end())));
+            }
+        }
+
+        /** Adds the erasures of the entries the file holds and T does not */
+        void EraseMissing()
+        {
+            for (const auto& item : mapFileEntries) {
+                if (item.second.nDump != nDump)
+                    vChanges.emplace_back(item.first, nullptr);
+            }
+        }
+    };
+
+    /** Fills the maps of T from the entries read from the file */
+    struct MapReader
+    {
+        const std::map<entry_key_t, blob_t>& mapEntries;
+        explicit MapReader(const std::map<entry_key_t, blob_t>& mapEntriesIn) : mapEntries(mapEntriesIn) {}
+
+        constexpr bool ForRead() const { return true; }
+
+        template <typename K, typename V, typename Pred, typename A>
+        void Map(uint8_t nId, std::map<K, V, Pred, A>& m)
+        {
+            m.clear();
+            for (auto it = mapEntries.lower_bound(entry_key_t(nId, blob_t())); it != mapEntries.end() && it->first.first == nId; ++it) {
+                CDataStream ssKey(it->first.second, SER_DISK, CLIENT_VERSION);
+                K key;
+                ssKey >> key;
+                CDataStream ssValue(it->second, SER_DISK, CLIENT_VERSION);
+                ssValue >> m[key];
+            }
+        }
+    };
+
+    std::string strFilename;
+    std::string strMagicMessage;
+
+    //! Entries held by the file, valid once the file was loaded or written by this instance
+    std::map<entry_key_t, EntryInfo> mapFileEntries;
+    bool fFileEntriesValid;
+    //! Bytes in the file, and the part of them taken by records that are still current
+    uint64_t nFileBytes;
+    uint64_t nLiveBytes;
+    //! Dumps written by this instance, to tell the entries found by the current one
+    uint64_t nDumps;
+
+    fs::path GetPath() const { return GetDataDir() / strFilename; }
+
+    template <typename It>
+    static uint64_t EntryChecksum(const It itBegin, const It itEnd)
+    {
+        return Hash(itBegin, itEnd).GetUint64(0);
+    }
+
+    /** Appends one record, returns its size in the file */
+    static uint32_t WriteRecord(CAutoFile& fileout, const CDataStream& ssPayload)
+    {
+        uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+        fileout << (uint32_t)ssPayload.size();
+        fileout.write(ssPayload.data(), ssPayload.size());
+        fileout << (uint32_t)ReadLE32(hash.begin());
+        return ssPayload.size() + 2 * sizeof(uint32_t);
+    }
+
+    static size_t EntryPayloadSize(const entry_key_t& key, const blob_t* pvchValue)
+    {
+        size_t nSize = 2 * sizeof(uint8_t) + GetSerializeSize(key.second, SER_DISK, CLIENT_VERSION);
+        if (pvchValue != nullptr)
+            nSize += GetSerializeSize(*pvchValue, SER_DISK, CLIENT_VERSION);
+        return nSize;
+    }
+
+    static uint32_t WriteEntry(CAutoFile& fileout, const entry_key_t& key, const blob_t* pvchValue)
+    {
+        CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+        ssPayload << (uint8_t)(pvchValue != nullptr ? RECORD_PUT : RECORD_ERASE) << key.first << key.second;
+        if (pvchValue != nullptr)
+            ssPayload << *pvchValue;
+        return WriteRecord(fileout, ssPayload);
+    }
+
+    static uint32_t WriteMarker(CAutoFile& fileout, RecordType nType, const blob_t& vchData)
+    {
+        CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+        ssPayload << (uint8_t)nType << vchData;
+        return WriteRecord(fileout, ssPayload);
+    }
+
+    /** Reads and checks the file header, returns Ok when the file is a journal of ours */
+    ReadResult ReadHeader(CAutoFile& filein)
+    {
+        unsigned char pchFileMagic[sizeof(JOURNAL_FILE_MAGIC)];
+        std::string strMagicMessageTmp;
+        unsigned char pchMsgTmp[4];
+        try {
+            filein >> pchFileMagic;
+            if (memcmp(pchFileMagic, JOURNAL_FILE_MAGIC, sizeof(pchFileMagic)))
+                return LegacyFormat;
+            filein >> strMagicMessageTmp >> pchMsgTmp;
+        }
+        catch (std::exception &e) {
+            // too short to be a journal
+            return LegacyFormat;
+        }
+
+        if (strMagicMessage != strMagicMessageTmp)
+        {
+            error("%s: Invalid magic message", __func__);
+            return IncorrectMagicMessage;
+        }
+
+        if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+        {
+            error("%s: Invalid network magic number", __func__);
+            return IncorrectMagicNumber;
+        }
+
+        return Ok;
+    }
+
+    uint32_t HeaderSize() const
+    {
+        return sizeof(JOURNAL_FILE_MAGIC) + GetSerializeSize(strMagicMessage, SER_DISK, CLIENT_VERSION) + 4;
+    }
+
+    ReadResult Read(T& objToLoad)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        // open input file, and associate with CAutoFile
+        FILE *file = fsbridge::fopen(GetPath(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, GetPath().string());
+            return FileError;
+        }
+
+        ReadResult headerResult = ReadHeader(filein);
+        if (headerResult != Ok)
+            return headerResult;
+
+        // Replay the records, applying those of a dump once its commit record is seen
+        std::map<entry_key_t, blob_t> mapEntries;
+        std::map<entry_key_t, uint32_t> mapRecordSizes;
+        blob_t vchBase, vchPendingBase;
+        uint32_t nBaseSize = 0, nPendingBaseSize = 0;
+        std::map<entry_key_t, PendingEntry> mapPending;
+        uint64_t nPos = HeaderSize();
+        uint64_t nCommittedPos = nPos;
+        uint64_t nRecords = 0;
+        while (true) {
+            CDataStream ssPayload(SER_DISK, CLIENT_VERSION);
+            try {
+                uint32_t nSize, nChecksum;
+                filein >> nSize;
+                if (nSize > MAX_SIZE) {
+                    LogPrintf("%s: Oversize record in %s, dropping the rest of the file\n", __func__, strFilename);
+                    break;
+                }
+                ssPayload.resize(nSize);
+                filein.read(ssPayload.data(), nSize);
+                filein >> nChecksum;
+                uint256 hash = Hash(ssPayload.begin(), ssPayload.end());
+                if (nChecksum != ReadLE32(hash.begin())) {
+                    LogPrintf("%s: Checksum mismatch in %s, dropping the rest of the file\n", __func__, strFilename);
+                    break;
+                }
+            }
+            catch (std::exception &e) {
+                // end of file, or a torn record
+                break;
+            }
+            uint32_t nRecordSize = ssPayload.size() + 2 * sizeof(uint32_t);
+            nPos += nRecordSize;
+
+            try {
+                uint8_t nType;
+                ssPayload >> nType;
+                if (nType == RECORD_PUT || nType == RECORD_ERASE) {
+                    entry_key_t key;
+                    ssPayload >> key.first >> key.second;
+                    PendingEntry& entry = mapPending[key];
+                    entry.fErase = nType == RECORD_ERASE;
+                    entry.vchValue.clear();
+                    if (!entry.fErase)
+                        ssPayload >> entry.vchValue;
+                    entry.nRecordSize = nRecordSize;
+                } else if (nType == RECORD_BASE) {
+                    // a big base state takes several records in a row
+                    blob_t vchChunk;
+                    ssPayload >> vchChunk;
+                    vchPendingBase.insert(vchPendingBase.end(), vchChunk.begin(), vchChunk.end());
+                    nPendingBaseSize += nRecordSize;
+                } else if (nType == RECORD_COMMIT) {
+                    for (auto& item : mapPending) {
+                        if (item.second.fErase) {
+                            mapEntries.erase(item.first);
+                            mapRecordSizes.erase(item.first);
+                        } else {
+                            mapEntries[item.first].swap(item.second.vchValue);
+                            mapRecordSizes[item.first] = item.second.nRecordSize;
+                        }
+                    }
+                    mapPending.clear();
+                    if (nPendingBaseSize != 0) {
+                        vchBase.swap(vchPendingBase);
+                        vchPendingBase.clear();
+                        nBaseSize = nPendingBaseSize;
+                        nPendingBaseSize = 0;
+                    }
+                    nCommittedPos = nPos;
+                } else {
+                    break;
+                }
+            }
+            catch (std::exception &e) {
+                break;
+            }
+            nRecords++;
+        }
+        filein.fclose();
+
+        try {
+            CDataStream ssBase(vchBase, SER_DISK, CLIENT_VERSION);
+            BaseWrapper base(objToLoad);
+            ssBase >> base;
+            MapReader reader(mapEntries);
+            objToLoad.JournalMapsOp(reader);
+        }
+        catch (std::exception &e) {
+            objToLoad.Clear();
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+
+        // Remember what the file holds, so that the next dump only appends the changes.
+        // Anything after the last commit would hide those changes, so rewrite the file then.
+        mapFileEntries.clear();
+        nLiveBytes = nBaseSize;
+        for (const auto& item : mapEntries) {
+            EntryInfo info;
+            info.nChecksum = EntryChecksum(item.second.begin(), item.second.end());
+            info.nRecordSize = mapRecordSizes[item.first];
+            info.nDump = nDumps;
+            mapFileEntries.emplace(item.first, info);
+            nLiveBytes += info.nRecordSize;
+        }
+        nFileBytes = nCommittedPos;
+        fFileEntriesValid = nCommittedPos == fs::file_size(GetPath());
+
+        LogPrintf("Loaded info from %s (%u records, %u entries)  %dms\n", strFilename, nRecords, mapEntries.size(), GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToLoad.ToString());
+        LogPrintf("%s: Cleaning....\n", __func__);
+        objToLoad.CheckAndRemove();
+        LogPrintf("     %s\n", objToLoad.ToString());
+
+        return Ok;
+    }
+
+    bool Write(T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        // Append the changes, unless stale records outweigh live ones by now
+        bool fCompact = !fFileEntriesValid || nFileBytes > HeaderSize() + 2 * nLiveBytes;
+        if (fCompact) {
+            mapFileEntries.clear();
+            fFileEntriesValid = false;
+        }
+        MapWriter writer(mapFileEntries, ++nDumps);
+        objToSave.JournalMapsOp(writer);
+        writer.EraseMissing();
+        const auto& vChanges = writer.vChanges;
+        CDataStream ssBase(SER_DISK, CLIENT_VERSION);
+        BaseWrapper base(objToSave);
+        ssBase << base;
+        blob_t vchBase(ssBase.begin(), ssBase.end());
+
+        for (const auto& change : vChanges) {
+            if (EntryPayloadSize(change.first, change.second.get()) > MAX_SIZE)
+                return error("%s: Entry of map %d too big for %s", __func__, change.first.first, strFilename);
+        }
+
+        fs::path pathWrite = fCompact ? GetPath().string() + ".new" : GetPath();
+        FILE *file = fsbridge::fopen(pathWrite, fCompact ? "wb" : "ab");
+        CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull())
+            return error("%s: Failed to open file %s", __func__, pathWrite.string());
+
+        // Until the file is committed, the next dump must not rely on what it holds
+        fFileEntriesValid = false;
+        try {
+            if (fCompact) {
+                fileout << JOURNAL_FILE_MAGIC << strMagicMessage << Params().MessageStart();
+                nFileBytes = HeaderSize();
+                nLiveBytes = 0;
+            }
+            for (const auto& change : vChanges) {
+                uint32_t nRecordSize = WriteEntry(fileout, change.first, change.second.get());
+                nFileBytes += nRecordSize;
+                auto it = mapFileEntries.find(change.first);
+                if (it != mapFileEntries.end()) {
+                    nLiveBytes -= it->second.nRecordSize;
+                    mapFileEntries.erase(it);
+                }
+                if (change.second) {
+                    EntryInfo info;
+                    info.nChecksum = EntryChecksum(change.second->begin(), change.second->end());
+                    info.nRecordSize = nRecordSize;
+                    info.nDump = nDumps;
+                    mapFileEntries.emplace(change.first, info);
+                    nLiveBytes += nRecordSize;
+                }
+            }
+            uint32_t nBaseSize = 0;
+            size_t nBasePos = 0;
+            do {
+                size_t nChunkSize = std::min(vchBase.size() - nBasePos, JOURNAL_MAX_BASE_CHUNK_SIZE);
+                nBaseSize += WriteMarker(fileout, RECORD_BASE, blob_t(vchBase.begin() + nBasePos, vchBase.begin() + nBasePos + nChunkSize));
+                nBasePos += nChunkSize;
+            } while (nBasePos < vchBase.size());
+            nFileBytes += nBaseSize + WriteMarker(fileout, RECORD_COMMIT, blob_t());
+            nLiveBytes += nBaseSize;
+        }
+        catch (std::exception &e) {
+            return error("%s: Serialize or I/O error - %s", __func__, e.what());
+        }
+        if (!FileCommit(fileout.Get()))
+            return error("%s: Failed to commit file %s", __func__, pathWrite.string());
+        fileout.fclose();
+        if (fCompact && !RenameOver(pathWrite, GetPath()))
+            return error("%s: Rename-into-place failed", __func__);
+        fFileEntriesValid = true;
+
+        LogPrintf("Written info to %s (%s, %u records)  %dms\n", strFilename, fCompact ? "compacted" : "appended", vChanges.size() + 2, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToSave.ToString());
+
+        return true;
+    }
+
+    /** Refuses to replace a file that is neither a journal of ours nor in the flat format */
+    bool CheckExistingFile()
+    {
+        FILE *file = fsbridge::fopen(GetPath(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return true;
+        ReadResult readResult = ReadHeader(filein);
+        return readResult == Ok || readResult == LegacyFormat;
+    }
+
+public:
+    CJournalDB(std::string strFilenameIn, std::string strMagicMessageIn) :
+        strFilename(strFilenameIn),
+        strMagicMessage(strMagicMessageIn),
+        fFileEntriesValid(false),
+        nFileBytes(0),
+        nLiveBytes(0),
+        nDumps(0)
+    {}
+
+    bool Load(T& objToLoad)
+    {
+        LogPrintf("Reading info from %s...\n", strFilename);
+        ReadResult readResult = Read(objToLoad);
+        if (readResult == LegacyFormat) {
+            LogPrintf("%s is not a journal, reading it as a flat file\n", strFilename);
+            fFileEntriesValid = false;
+            return CFlatDB<T>(strFilename, strMagicMessage).Load(objToLoad);
+        }
+        if (readResult == FileError)
+            LogPrintf("Missing file %s, will try to recreate\n", strFilename);
+        else if (readResult != Ok)
+        {
+            LogPrintf("Error reading %s: ", strFilename);
+            if(readResult == IncorrectFormat)
+            {
+                LogPrintf("%s: Magic is ok but data has invalid format, will try to recreate\n", __func__);
+            }
+            else {
+                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+                // program should exit with an error
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Dump(T& objToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+
+        if (!fFileEntriesValid) {
+            LogPrintf("Verifying %s format...\n", strFilename);
+            if (!CheckExistingFile()) {
+                LogPrintf("%s: File format is unknown or invalid, please fix it manually\n", __func__);
+                return false;
+            }
+        }
+
+        LogPrintf("Writing info to %s...\n", strFilename);
+        if (!Write(objToSave))
+            return false;
+        LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
+
+        return true;
+    }
+
+};
+
+
+#endif // VELES_JOURNAL_DATABASE_H
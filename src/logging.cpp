@@ -119,6 +119,9 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::COINDB, "coindb"},
     {BCLog::QT, "qt"},
     {BCLog::LEVELDB, "leveldb"},
+    // VELES BEGIN
+    {BCLog::STRATUM, "stratum"},
+    // VELES END
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 
@@ -53,6 +53,9 @@ namespace BCLog {
         COINDB      = (1 << 18),
         QT          = (1 << 19),
         LEVELDB     = (1 << 20),
+        // VELES BEGIN
+        STRATUM     = (1 << 21),
+        // VELES END
         ALL         = ~(uint32_t)0,
 
         // Dash
@@ -22,6 +22,9 @@ CMasternodePayments mnpayments;
 CCriticalSection cs_vecPayees;
 CCriticalSection cs_mapMasternodeBlocks;
 CCriticalSection cs_mapMasternodePaymentVotes;
+// VELES BEGIN
+CCriticalSection cs_mapPaidBlocks;
+// VELES END
 
 /**
 * IsBlockValueValid
@@ -247,6 +250,12 @@ void CMasternodePayments::Clear()
     LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
     mapMasternodeBlocks.clear();
     mapMasternodePaymentVotes.clear();
+    // VELES BEGIN
+    mapPaymentVoteMessages.clear();
+    LOCK(cs_mapPaidBlocks);
+    mapPaidBlocks.clear();
+    mapPayeeHeights.clear();
+    // VELES END
 }
 
 bool CMasternodePayments::CanVote(COutPoint outMasternode, int nBlockHeight)
@@ -345,7 +354,12 @@ void CMasternodePayments::ProcessMessage(CNode* pfrom, const std::string& strCom
 
         uint256 nHash = vote.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        // VELES BEGIN
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
+        // VELES END
 
         // TODO: clear setAskFor for MSG_MASTERNODE_PAYMENT_BLOCK too
 
@@ -503,6 +517,44 @@ bool CMasternodePayments::HasVerifiedPaymentVote(uint256 hashIn)
     return it != mapMasternodePaymentVotes.end() && it->second.IsVerified();
 }
 
+// VELES BEGIN
+CSharedNetMsgRef CMasternodePayments::GetPaymentVoteMessageLocked(const uint256& hash)
+{
+    AssertLockHeld(cs_mapMasternodePaymentVotes);
+    std::map<uint256, CMasternodePaymentVote>::iterator it = mapMasternodePaymentVotes.find(hash);
+    if (it == mapMasternodePaymentVotes.end() || !it->second.IsVerified())
+        return nullptr;
+
+    CSharedNetMsgRef& message = mapPaymentVoteMessages[hash];
+    if (!message)
+        message = MakeSharedNetMsg(NetMsgType::MASTERNODEPAYMENTVOTE, it->second);
+    return message;
+}
+
+CSharedNetMsgRef CMasternodePayments::GetPaymentVoteMessage(const uint256& hash)
+{
+    LOCK(cs_mapMasternodePaymentVotes);
+    return GetPaymentVoteMessageLocked(hash);
+}
+
+bool CMasternodePayments::GetPaymentBlockMessages(int nBlockHeight, std::vector<CSharedNetMsgRef>& vMessagesRet)
+{
+    LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+    std::map<int, CMasternodeBlockPayees>::iterator it = mapMasternodeBlocks.find(nBlockHeight);
+    if (it == mapMasternodeBlocks.end())
+        return false;
+
+    for (CMasternodePayee& payee : it->second.vecPayees) {
+        for (const uint256& hash : payee.GetVoteHashes()) {
+            CSharedNetMsgRef message = GetPaymentVoteMessageLocked(hash);
+            if (message)
+                vMessagesRet.push_back(std::move(message));
+        }
+    }
+    return true;
+}
+// VELES END
+
 void CMasternodeBlockPayees::AddPayee(const CMasternodePaymentVote& vote)
 {
     LOCK(cs_vecPayees);
@@ -654,6 +706,9 @@ void CMasternodePayments::CheckAndRemove()
 
         if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
             LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::CheckAndRemove -- Removing old Masternode payment: nBlockHeight=%d\n", vote.nBlockHeight);
+            // VELES BEGIN
+            mapPaymentVoteMessages.erase(it->first);
+            // VELES END
             mapMasternodePaymentVotes.erase(it++);
             mapMasternodeBlocks.erase(vote.nBlockHeight);
         } else {
@@ -1035,3 +1090,93 @@ void CMasternodePayments::UpdatedBlockTip(const CBlockIndex *pindex, CConnman& c
     CheckPreviousBlockVotes(nFutureBlock - 1);
     ProcessBlock(nFutureBlock, connman);
 }
+
+// VELES BEGIN
+void CMasternodePayments::AddPaidBlock(int nBlockHeight, const uint256& hashBlock, const CTransaction& txCoinbase)
+{
+    CAmount nMasternodePayment = GetMasternodePayment(nBlockHeight, txCoinbase.GetValueOut());
+    int nLimit = GetStorageLimit();
+
+    LOCK(cs_mapPaidBlocks);
+
+    // Payments recorded for this height belong to a block that was disconnected
+    CMasternodePaidBlock& paidBlock = mapPaidBlocks[nBlockHeight];
+    for (const auto& payment : paidBlock.vecPayments) {
+        auto it = mapPayeeHeights.find(payment.first);
+        if (it != mapPayeeHeights.end() && it->second.erase(nBlockHeight) && it->second.empty())
+            mapPayeeHeights.erase(it);
+    }
+
+    paidBlock.hashBlock = hashBlock;
+    paidBlock.vecPayments.clear();
+    for (const CTxOut& txout : txCoinbase.vout) {
+        if (nMasternodePayment > 0 && txout.nValue == nMasternodePayment) {
+            CScriptID payeeID(txout.scriptPubKey);
+            paidBlock.vecPayments.emplace_back(payeeID, txout.nValue);
+            mapPayeeHeights[payeeID].insert(nBlockHeight);
+        }
+    }
+
+    // Keep as many blocks as payment votes
+    while (!mapPaidBlocks.empty() && nBlockHeight - mapPaidBlocks.begin()->first > nLimit) {
+        for (const auto& payment : mapPaidBlocks.begin()->second.vecPayments) {
+            auto it = mapPayeeHeights.find(payment.first);
+            if (it != mapPayeeHeights.end() && it->second.erase(mapPaidBlocks.begin()->first) && it->second.empty())
+                mapPayeeHeights.erase(it);
+        }
+        mapPaidBlocks.erase(mapPaidBlocks.begin());
+    }
+}
+
+void CMasternodePayments::IndexPaidBlocks(const CBlockIndex* pindex, int nBlocks)
+{
+    AssertLockHeld(cs_main);
+
+    for (int i = 0; pindex && i < nBlocks; i++, pindex = pindex->pprev) {
+        {
+            LOCK2(cs_mapMasternodeBlocks, cs_mapPaidBlocks);
+            // Nobody can have been paid without votes
+            if (!mapMasternodeBlocks.count(pindex->nHeight))
+                continue;
+            auto it = mapPaidBlocks.find(pindex->nHeight);
+            if (it != mapPaidBlocks.end() && it->second.hashBlock == pindex->GetBlockHash())
+                continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) // shouldn't really happen
+            continue;
+        AddPaidBlock(pindex->nHeight, pindex->GetBlockHash(), *block.vtx[0]);
+    }
+}
+
+const CBlockIndex* CMasternodePayments::GetLastPaidBlock(const CScript& payee, const CBlockIndex* pindex, int nBlocks, int nMinHeight)
+{
+    if (!pindex) return nullptr;
+
+    LOCK2(cs_mapMasternodeBlocks, cs_mapPaidBlocks);
+
+    auto itPayee = mapPayeeHeights.find(CScriptID(payee));
+    if (itPayee == mapPayeeHeights.end())
+        return nullptr;
+
+    const std::set<int>& setHeights = itPayee->second;
+    for (auto it = std::set<int>::const_reverse_iterator(setHeights.upper_bound(pindex->nHeight)); it != setHeights.rend(); ++it) {
+        int nHeight = *it;
+        if (nHeight <= nMinHeight || pindex->nHeight - nHeight >= nBlocks)
+            break;
+
+        // Skip payments of blocks that are not in this chain anymore
+        const CBlockIndex* pindexPaid = pindex->GetAncestor(nHeight);
+        auto itPaid = mapPaidBlocks.find(nHeight);
+        if (itPaid == mapPaidBlocks.end() || itPaid->second.hashBlock != pindexPaid->GetBlockHash())
+            continue;
+
+        auto itVotes = mapMasternodeBlocks.find(nHeight);
+        if (itVotes != mapMasternodeBlocks.end() && itVotes->second.HasPayeeWithVotes(payee, 2))
+            return pindexPaid;
+    }
+
+    return nullptr;
+}
+// VELES END
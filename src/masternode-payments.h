@@ -12,6 +12,11 @@
 #include <masternode.h>
 #include <net_processing.h>
 #include <utilstrencodings.h>
+// VELES BEGIN
+#include <script/standard.h>
+
+#include <set>
+// VELES END
 
 class CMasternodePayments;
 class CMasternodePaymentVote;
@@ -30,6 +35,10 @@ static const int MIN_MASTERNODE_PAYMENT_PROTO_VERSION_2 = 70208;
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapMasternodeBlocks;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
+// VELES BEGIN
+extern CCriticalSection cs_mapMasternodePaymentVotes;
+extern CCriticalSection cs_mapPaidBlocks;
+// VELES END
 
 extern CMasternodePayments mnpayments;
 
@@ -165,6 +174,30 @@ public:
 // Keeps track of who should get paid for which blocks
 //
 
+// VELES BEGIN
+/** Masternode payments found in the coinbase of a block */
+class CMasternodePaidBlock
+{
+public:
+    uint256 hashBlock;
+    //! Script hash of each output paying the masternode amount, and the amount
+    std::vector<std::pair<CScriptID, CAmount>> vecPayments;
+
+    CMasternodePaidBlock() :
+        hashBlock(),
+        vecPayments()
+        {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashBlock);
+        READWRITE(vecPayments);
+    }
+};
+// VELES END
+
 class CMasternodePayments
 {
 private:
@@ -176,11 +209,24 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    // VELES BEGIN
+    //! MASTERNODEPAYMENTVOTE messages for verified votes of mapMasternodePaymentVotes
+    std::map<uint256, CSharedNetMsgRef> mapPaymentVoteMessages;
+
+    CSharedNetMsgRef GetPaymentVoteMessageLocked(const uint256& hash);
+    // VELES END
+
 public:
     std::map<uint256, CMasternodePaymentVote> mapMasternodePaymentVotes;
     std::map<int, CMasternodeBlockPayees> mapMasternodeBlocks;
     std::map<COutPoint, int> mapMasternodesLastVote;
     std::map<COutPoint, int> mapMasternodesDidNotVote;
+    // VELES BEGIN
+    //! Masternode payments of the last blocks connected, by height
+    std::map<int, CMasternodePaidBlock> mapPaidBlocks;
+    //! Heights of mapPaidBlocks paying each payee, rebuilt from mapPaidBlocks when loaded
+    std::map<CScriptID, std::set<int>> mapPayeeHeights;
+    // VELES END
 
     CMasternodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(5000) {}
 
@@ -192,10 +238,38 @@ public:
         READWRITE(mapMasternodeBlocks);
     }
 
+    // VELES BEGIN
+    /** CJournalDB support: everything is stored vote by vote and block by block */
+    template <typename Stream, typename Operation>
+    inline void JournalBaseOp(Stream& s, Operation ser_action) {}
+
+    template <typename Journal>
+    void JournalMapsOp(Journal& journal) {
+        LOCK2(cs_mapMasternodeBlocks, cs_mapMasternodePaymentVotes);
+        LOCK(cs_mapPaidBlocks);
+        journal.Map(1, mapMasternodePaymentVotes);
+        journal.Map(2, mapMasternodeBlocks);
+        journal.Map(3, mapPaidBlocks);
+        if (journal.ForRead()) {
+            mapPayeeHeights.clear();
+            for (const auto& item : mapPaidBlocks) {
+                for (const auto& payment : item.second.vecPayments)
+                    mapPayeeHeights[payment.first].insert(item.first);
+            }
+        }
+    }
+    // VELES END
+
     void Clear();
 
     bool AddPaymentVote(const CMasternodePaymentVote& vote);
     bool HasVerifiedPaymentVote(uint256 hashIn);
+    // VELES BEGIN
+    /** Message for a verified vote, serialized once and shared by all requests, NULL if there is none */
+    CSharedNetMsgRef GetPaymentVoteMessage(const uint256& hash);
+    /** Messages for the verified votes for a block, false if the block has no payees */
+    bool GetPaymentBlockMessages(int nBlockHeight, std::vector<CSharedNetMsgRef>& vMessagesRet);
+    // VELES END
     bool ProcessBlock(int nBlockHeight, CConnman& connman);
     void CheckPreviousBlockVotes(int nPrevBlockHeight);
 
@@ -222,6 +296,18 @@ public:
     int GetStorageLimit();
 
     void UpdatedBlockTip(const CBlockIndex *pindex, CConnman& connman);
+
+    // VELES BEGIN
+    /** Record the masternode payments in the coinbase of a connected block */
+    void AddPaidBlock(int nBlockHeight, const uint256& hashBlock, const CTransaction& txCoinbase);
+    /** Record the blocks with payment votes among the last nBlocks up to pindex that were not recorded on connection */
+    void IndexPaidBlocks(const CBlockIndex* pindex, int nBlocks);
+    /**
+     * Latest block among the last nBlocks up to pindex and above nMinHeight
+     * paying payee with enough votes, or nullptr
+     */
+    const CBlockIndex* GetLastPaidBlock(const CScript& payee, const CBlockIndex* pindex, int nBlocks, int nMinHeight);
+    // VELES END
 };
 
 #endif // FXTC_MASTERNODE-PAYMENTS_H
@@ -348,35 +348,19 @@ void CMasternode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScan
 {
     if(!pindex) return;
 
-    const CBlockIndex *BlockReading = pindex;
-
     CScript mnpayee = GetScriptForDestination(pubKeyCollateralAddress.GetID());
     // LogPrint(BCLog::MASTERNODE, "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s\n", vin.prevout.ToStringShort());
 
-    LOCK(cs_mapMasternodeBlocks);
-
-    for (int i = 0; BlockReading && BlockReading->nHeight > nBlockLastPaid && i < nMaxBlocksToScanBack; i++) {
-        if(mnpayments.mapMasternodeBlocks.count(BlockReading->nHeight) &&
-            mnpayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2))
-        {
-            CBlock block;
-            if(!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus())) // shouldn't really happen
-                continue;
-
-            CAmount nMasternodePayment = GetMasternodePayment(BlockReading->nHeight, block.vtx[0]->GetValueOut());
-
-            for (auto txout : block.vtx[0]->vout)
-                if(mnpayee == txout.scriptPubKey && nMasternodePayment == txout.nValue) {
-                    nBlockLastPaid = BlockReading->nHeight;
-                    nTimeLastPaid = BlockReading->nTime;
-                    LogPrint(BCLog::MASTERNODE, "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s -- found new %d\n", vin.prevout.ToStringShort(), nBlockLastPaid);
-                    return;
-                }
-        }
-
-        if (BlockReading->pprev == NULL) { assert(BlockReading); break; }
-        BlockReading = BlockReading->pprev;
+    // VELES BEGIN
+    // The coinbase payments are indexed by mnpayments, no need to read the blocks
+    const CBlockIndex *pindexPaid = mnpayments.GetLastPaidBlock(mnpayee, pindex, nMaxBlocksToScanBack, nBlockLastPaid);
+    if (pindexPaid) {
+        nBlockLastPaid = pindexPaid->nHeight;
+        nTimeLastPaid = pindexPaid->nTime;
+        LogPrint(BCLog::MASTERNODE, "CMasternode::UpdateLastPaidBlock -- searching for block with payment to %s -- found new %d\n", vin.prevout.ToStringShort(), nBlockLastPaid);
+        return;
     }
+    // VELES END
 
     // Last payment for this masternode wasn't found in latest mnpayments blocks
     // or it was found in mnpayments blocks but wasn't found in the blockchain.
@@ -656,9 +640,9 @@ bool CMasternodeBroadcast::Sign(const CKey& keyCollateralAddress)
 
     sigTime = GetAdjustedTime();
 
-    strMessage = addr.ToString(false) + boost::lexical_cast<std::string>(sigTime) +
-                    pubKeyCollateralAddress.GetID().ToString() + pubKeyMasternode.GetID().ToString() +
-                    boost::lexical_cast<std::string>(nProtocolVersion);
+    // VELES BEGIN
+    strMessage = GetSignatureMessage();
+    // VELES END
 
     if(!CMessageSigner::SignMessage(strMessage, vchSig, keyCollateralAddress)) {
         LogPrintf("CMasternodeBroadcast::Sign -- SignMessage() failed\n");
@@ -679,9 +663,9 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos)
     std::string strError = "";
     nDos = 0;
 
-    strMessage = addr.ToString(false) + boost::lexical_cast<std::string>(sigTime) +
-                    pubKeyCollateralAddress.GetID().ToString() + pubKeyMasternode.GetID().ToString() +
-                    boost::lexical_cast<std::string>(nProtocolVersion);
+    // VELES BEGIN
+    strMessage = GetSignatureMessage();
+    // VELES END
 
     LogPrint(BCLog::MASTERNODE, "CMasternodeBroadcast::CheckSignature -- strMessage: %s  pubKeyCollateralAddress address: %s  sig: %s\n", strMessage, EncodeDestination(pubKeyCollateralAddress.GetID()), EncodeBase64(&vchSig[0], vchSig.size()));
 
@@ -694,6 +678,20 @@ bool CMasternodeBroadcast::CheckSignature(int& nDos)
     return true;
 }
 
+// VELES BEGIN
+std::string CMasternodeBroadcast::GetSignatureMessage() const
+{
+    return addr.ToString(false) + boost::lexical_cast<std::string>(sigTime) +
+                    pubKeyCollateralAddress.GetID().ToString() + pubKeyMasternode.GetID().ToString() +
+                    boost::lexical_cast<std::string>(nProtocolVersion);
+}
+
+CHashSignatureCheck CMasternodeBroadcast::GetSignatureCheck() const
+{
+    return CHashSignatureCheck(CMessageSigner::GetMessageHash(GetSignatureMessage()), pubKeyCollateralAddress, vchSig);
+}
+// VELES END
+
 void CMasternodeBroadcast::Relay(CConnman& connman)
 {
     // Do not relay until fully synced
@@ -723,7 +721,9 @@ bool CMasternodePing::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMaste
 
     // TODO: add sentinel data
     sigTime = GetAdjustedTime();
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
 
     if(!CMessageSigner::SignMessage(strMessage, vchSig, keyMasternode)) {
         LogPrintf("CMasternodePing::Sign -- SignMessage() failed\n");
@@ -740,8 +740,9 @@ bool CMasternodePing::Sign(const CKey& keyMasternode, const CPubKey& pubKeyMaste
 
 bool CMasternodePing::CheckSignature(CPubKey& pubKeyMasternode, int &nDos)
 {
-    // TODO: add sentinel data
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    // VELES BEGIN
+    std::string strMessage = GetSignatureMessage();
+    // VELES END
     std::string strError = "";
     nDos = 0;
 
@@ -753,6 +754,19 @@ bool CMasternodePing::CheckSignature(CPubKey& pubKeyMasternode, int &nDos)
     return true;
 }
 
+// VELES BEGIN
+std::string CMasternodePing::GetSignatureMessage() const
+{
+    // TODO: add sentinel data
+    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+}
+
+CHashSignatureCheck CMasternodePing::GetSignatureCheck(const CPubKey& pubKeyMasternode) const
+{
+    return CHashSignatureCheck(CMessageSigner::GetMessageHash(GetSignatureMessage()), pubKeyMasternode, vchSig);
+}
+// VELES END
+
 bool CMasternodePing::SimpleCheck(int& nDos)
 {
     // don't ban by default
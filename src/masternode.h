@@ -13,6 +13,9 @@
 class CMasternode;
 class CMasternodeBroadcast;
 class CConnman;
+// VELES BEGIN
+class CHashSignatureCheck;
+// VELES END
 
 static const int MASTERNODE_CHECK_SECONDS               =   5;
 static const int MASTERNODE_MIN_MNB_SECONDS             =   5 * 60;
@@ -75,6 +78,10 @@ public:
 
     bool Sign(const CKey& keyMasternode, const CPubKey& pubKeyMasternode);
     bool CheckSignature(CPubKey& pubKeyMasternode, int &nDos);
+    // VELES BEGIN
+    std::string GetSignatureMessage() const;
+    CHashSignatureCheck GetSignatureCheck(const CPubKey& pubKeyMasternode) const;
+    // VELES END
     bool SimpleCheck(int& nDos);
     bool CheckAndUpdate(CMasternode* pmn, bool fFromNewBroadcast, int& nDos, CConnman& connman);
     void Relay(CConnman& connman);
@@ -216,7 +223,7 @@ public:
 
     bool IsBroadcastedWithin(int nSeconds) { return GetAdjustedTime() - sigTime < nSeconds; }
 
-    bool IsPingedWithin(int nSeconds, int64_t nTimeToCheckAt = -1)
+    bool IsPingedWithin(int nSeconds, int64_t nTimeToCheckAt = -1) const
     {
         if(lastPing == CMasternodePing()) return false;
 
@@ -361,6 +368,10 @@ public:
 
     bool Sign(const CKey& keyCollateralAddress);
     bool CheckSignature(int& nDos);
+    // VELES BEGIN
+    std::string GetSignatureMessage() const;
+    CHashSignatureCheck GetSignatureCheck() const;
+    // VELES END
     void Relay(CConnman& connman);
 };
 
@@ -55,6 +55,71 @@ struct CompareByAddr
     }
 };
 
+// VELES BEGIN
+bool CMasternodeFilter::Matches(const CMasternode& mn) const
+{
+    if (nActiveState != -1 && mn.nActiveState != nActiveState) return false;
+    if (nProtocolVersion != -1 && mn.nProtocolVersion != nProtocolVersion) return false;
+    if (nMinProtocolVersion != -1 && mn.nProtocolVersion < nMinProtocolVersion) return false;
+    if (!payee.IsNull() && mn.pubKeyCollateralAddress.GetID() != payee) return false;
+    if (addr.IsValid() && mn.addr != addr) return false;
+    return true;
+}
+
+CMasternodeListSnapshot::CMasternodeListSnapshot(masternode_map_t&& mapMasternodesIn)
+: mapMasternodes(std::move(mapMasternodesIn))
+{
+    for (const auto& mnpair : mapMasternodes) {
+        const CMasternode* pmn = mnpair.second.get();
+        mapByState.emplace(pmn->nActiveState, pmn);
+        mapByProtocol.emplace(pmn->nProtocolVersion, pmn);
+        mapByPayee.emplace(pmn->pubKeyCollateralAddress.GetID(), pmn);
+        mapByAddr.emplace(pmn->addr, pmn);
+    }
+}
+
+template <typename TKey>
+static void AppendRange(std::vector<const CMasternode*>& vecRet, const std::multimap<TKey, const CMasternode*>& mapIndex, const TKey& key)
+{
+    auto range = mapIndex.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+        vecRet.push_back(it->second);
+}
+
+std::vector<const CMasternode*> CMasternodeListSnapshot::Query(const CMasternodeFilter& filter) const
+{
+    // Walk the most selective index given and check the other conditions on its entries only
+    std::vector<const CMasternode*> vecCandidates;
+    if (!filter.payee.IsNull()) {
+        AppendRange(vecCandidates, mapByPayee, filter.payee);
+    } else if (filter.addr.IsValid()) {
+        AppendRange(vecCandidates, mapByAddr, filter.addr);
+    } else if (filter.nActiveState != -1) {
+        AppendRange(vecCandidates, mapByState, filter.nActiveState);
+    } else if (filter.nProtocolVersion != -1) {
+        AppendRange(vecCandidates, mapByProtocol, filter.nProtocolVersion);
+    } else if (filter.nMinProtocolVersion != -1) {
+        for (auto it = mapByProtocol.lower_bound(filter.nMinProtocolVersion); it != mapByProtocol.end(); ++it)
+            vecCandidates.push_back(it->second);
+    } else {
+        vecCandidates.reserve(mapMasternodes.size());
+        for (const auto& mnpair : mapMasternodes)
+            vecCandidates.push_back(mnpair.second.get());
+        return vecCandidates;
+    }
+
+    std::vector<const CMasternode*> vecRet;
+    for (const CMasternode* pmn : vecCandidates) {
+        if (filter.Matches(*pmn))
+            vecRet.push_back(pmn);
+    }
+    std::sort(vecRet.begin(), vecRet.end(), [](const CMasternode* a, const CMasternode* b) {
+        return a->vin.prevout < b->vin.prevout;
+    });
+    return vecRet;
+}
+// VELES END
+
 CMasternodeMan::CMasternodeMan()
 : cs(),
   mapMasternodes(),
@@ -69,6 +134,8 @@ CMasternodeMan::CMasternodeMan()
   fMasternodesRemoved(false),
   vecDirtyGovernanceObjectHashes(),
   nLastWatchdogVoteTime(0),
+  mapRankingCache(MAX_RANKING_CACHE_SIZE),
+  listSnapshot(),
   mapSeenMasternodeBroadcast(),
   mapSeenMasternodePing(),
   nDsqCount(0)
@@ -83,6 +150,10 @@ bool CMasternodeMan::Add(CMasternode &mn)
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::Add -- Adding new Masternode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapMasternodes[mn.vin.prevout] = mn;
     fMasternodesAdded = true;
+    // VELES BEGIN
+    InvalidateRankingCache();
+    InvalidateListSnapshot(mn.vin.prevout);
+    // VELES END
     return true;
 }
 
@@ -163,7 +234,15 @@ void CMasternodeMan::Check()
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::Check -- nLastWatchdogVoteTime=%d, IsWatchdogActive()=%d\n", nLastWatchdogVoteTime, IsWatchdogActive());
 
     for (auto& mnpair : mapMasternodes) {
+        // VELES BEGIN
+        // Most checks change nothing the list shows, only nTimeLastChecked
+        int nActiveStatePrev = mnpair.second.nActiveState;
+        int nPoSeBanScorePrev = mnpair.second.nPoSeBanScore;
+        int nPoSeBanHeightPrev = mnpair.second.nPoSeBanHeight;
         mnpair.second.Check();
+        if (mnpair.second.nActiveState != nActiveStatePrev || mnpair.second.nPoSeBanScore != nPoSeBanScorePrev || mnpair.second.nPoSeBanHeight != nPoSeBanHeightPrev)
+            InvalidateListSnapshot(mnpair.first);
+        // VELES END
     }
 }
 
@@ -198,8 +277,14 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
 
                 // and finally remove it from the list
                 it->second.FlagGovernanceItemsAsDirty();
+                // VELES BEGIN
+                InvalidateListSnapshot(it->first);
+                // VELES END
                 mapMasternodes.erase(it++);
                 fMasternodesRemoved = true;
+                // VELES BEGIN
+                InvalidateRankingCache();
+                // VELES END
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
                             masternodeSync.IsSynced() &&
@@ -325,6 +410,9 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
         while(it4 != mapSeenMasternodePing.end()){
             if((*it4).second.IsExpired()) {
                 LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckAndRemove -- Removing expired Masternode ping: hash=%s\n", (*it4).second.GetHash().ToString());
+                // VELES BEGIN
+                mapMasternodePingMessages.erase(it4->first);
+                // VELES END
                 mapSeenMasternodePing.erase(it4++);
             } else {
                 ++it4;
@@ -342,6 +430,18 @@ void CMasternodeMan::CheckAndRemove(CConnman& connman)
             }
         }
 
+        // VELES BEGIN
+        // seen broadcasts are dropped in many places, forget their messages here
+        auto itMessage = mapMasternodeBroadcastMessages.begin();
+        while (itMessage != mapMasternodeBroadcastMessages.end()) {
+            if (!mapSeenMasternodeBroadcast.count(itMessage->first)) {
+                mapMasternodeBroadcastMessages.erase(itMessage++);
+            } else {
+                ++itMessage;
+            }
+        }
+        // VELES END
+
         LogPrintf("CMasternodeMan::CheckAndRemove -- %s\n", ToString());
     }
 
@@ -393,11 +493,19 @@ void CMasternodeMan::Clear()
 {
     LOCK(cs);
     mapMasternodes.clear();
+    // VELES BEGIN
+    InvalidateRankingCache();
+    InvalidateListSnapshot();
+    // VELES END
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
+    // VELES BEGIN
+    mapMasternodeBroadcastMessages.clear();
+    mapMasternodePingMessages.clear();
+    // VELES END
     nDsqCount = 0;
     nLastWatchdogVoteTime = 0;
 }
@@ -469,11 +577,80 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman& connman)
 }
 
 CMasternode* CMasternodeMan::Find(const COutPoint &outpoint)
+{
+    LOCK(cs);
+    auto it = mapMasternodes.find(outpoint);
+    // VELES BEGIN
+    if (it == mapMasternodes.end()) return NULL;
+    InvalidateListSnapshot(outpoint);
+    return &(it->second);
+    // VELES END
+}
+
+// VELES BEGIN
+const CMasternode* CMasternodeMan::FindReadOnly(const COutPoint& outpoint) const
 {
     LOCK(cs);
     auto it = mapMasternodes.find(outpoint);
     return it == mapMasternodes.end() ? NULL : &(it->second);
 }
+// VELES END
+
+// VELES BEGIN
+CMasternodeMan::list_snapshot_ptr_t CMasternodeMan::GetMasternodeListSnapshot()
+{
+    LOCK(cs);
+    if (listSnapshot && setListSnapshotChanged.empty())
+        return listSnapshot;
+
+    CMasternodeListSnapshot::masternode_map_t mapSnapshot;
+    if (listSnapshot) {
+        // Copy only the masternodes that changed, share the rest with the old snapshot
+        mapSnapshot = listSnapshot->mapMasternodes;
+        for (const COutPoint& outpoint : setListSnapshotChanged) {
+            auto it = mapMasternodes.find(outpoint);
+            if (it == mapMasternodes.end())
+                mapSnapshot.erase(outpoint);
+            else
+                mapSnapshot[outpoint] = std::make_shared<const CMasternode>(it->second);
+        }
+    } else {
+        for (const auto& mnpair : mapMasternodes)
+            mapSnapshot.emplace_hint(mapSnapshot.end(), mnpair.first, std::make_shared<const CMasternode>(mnpair.second));
+    }
+    setListSnapshotChanged.clear();
+    listSnapshot = std::make_shared<const CMasternodeListSnapshot>(std::move(mapSnapshot));
+    return listSnapshot;
+}
+
+CSharedNetMsgRef CMasternodeMan::GetMasternodeBroadcastMessage(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodeBroadcast.find(hash);
+    if (it == mapSeenMasternodeBroadcast.end())
+        return nullptr;
+
+    // The seen broadcast gets the newer pings, serialize it again when its lastPing changed
+    const CMasternodeBroadcast& mnb = it->second.second;
+    std::pair<int64_t, CSharedNetMsgRef>& message = mapMasternodeBroadcastMessages[hash];
+    if (!message.second || message.first != mnb.lastPing.sigTime)
+        message = std::make_pair(mnb.lastPing.sigTime, MakeSharedNetMsg(NetMsgType::MNANNOUNCE, mnb));
+    return message.second;
+}
+
+CSharedNetMsgRef CMasternodeMan::GetMasternodePingMessage(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapSeenMasternodePing.find(hash);
+    if (it == mapSeenMasternodePing.end())
+        return nullptr;
+
+    CSharedNetMsgRef& message = mapMasternodePingMessages[hash];
+    if (!message)
+        message = MakeSharedNetMsg(NetMsgType::MNPING, it->second);
+    return message;
+}
+// VELES END
 
 bool CMasternodeMan::Get(const COutPoint& outpoint, CMasternode& masternodeRet)
 {
@@ -680,6 +857,32 @@ bool CMasternodeMan::GetMasternodeScores(const uint256& nBlockHash, CMasternodeM
     return !vecMasternodeScoresRet.empty();
 }
 
+// VELES BEGIN
+CMasternodeMan::ranking_ptr_t CMasternodeMan::GetMasternodeRanking(const uint256& nBlockHash, int nMinProtocol)
+{
+    AssertLockHeld(cs);
+
+    const std::pair<uint256, int> key(nBlockHash, nMinProtocol);
+    ranking_ptr_t pranking;
+    if (mapRankingCache.Get(key, pranking))
+        return pranking;
+
+    score_pair_vec_t vecMasternodeScores;
+    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+        return nullptr;
+
+    std::shared_ptr<CMasternodeRanking> pnew = std::make_shared<CMasternodeRanking>();
+    pnew->vecOutpoints.reserve(vecMasternodeScores.size());
+    for (auto& scorePair : vecMasternodeScores) {
+        pnew->vecOutpoints.push_back(scorePair.second->vin.prevout);
+        pnew->mapRanks.emplace(scorePair.second->vin.prevout, (int)pnew->vecOutpoints.size());
+    }
+
+    mapRankingCache.Insert(key, pnew);
+    return pnew;
+}
+// VELES END
+
 bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
 {
     nRankRet = -1;
@@ -696,20 +899,18 @@ bool CMasternodeMan::GetMasternodeRank(const COutPoint& outpoint, int& nRankRet,
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    // VELES BEGIN
+    ranking_ptr_t pranking = GetMasternodeRanking(nBlockHash, nMinProtocol);
+    if (!pranking)
         return false;
 
-    int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
-        nRank++;
-        if(scorePair.second->vin.prevout == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    auto it = pranking->mapRanks.find(outpoint);
+    if (it == pranking->mapRanks.end())
+        return false;
 
-    return false;
+    nRankRet = it->second;
+    return true;
+    // VELES END
 }
 
 bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight, int nMinProtocol)
@@ -728,15 +929,20 @@ bool CMasternodeMan::GetMasternodeRanks(CMasternodeMan::rank_pair_vec_t& vecMast
 
     LOCK(cs);
 
-    score_pair_vec_t vecMasternodeScores;
-    if (!GetMasternodeScores(nBlockHash, vecMasternodeScores, nMinProtocol))
+    // VELES BEGIN
+    ranking_ptr_t pranking = GetMasternodeRanking(nBlockHash, nMinProtocol);
+    if (!pranking)
         return false;
 
+    vecMasternodeRanksRet.reserve(pranking->vecOutpoints.size());
     int nRank = 0;
-    for (auto& scorePair : vecMasternodeScores) {
+    for (const auto& outpoint : pranking->vecOutpoints) {
         nRank++;
-        vecMasternodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
+        auto it = mapMasternodes.find(outpoint);
+        if (it != mapMasternodes.end())
+            vecMasternodeRanksRet.push_back(std::make_pair(nRank, it->second));
     }
+    // VELES END
 
     return true;
 }
@@ -799,7 +1005,13 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        pfrom->setAskFor.erase(mnb.GetHash());
+        // VELES BEGIN
+        // This runs on a masternode message thread, the message handler thread changes setAskFor under cs_main
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(mnb.GetHash());
+        }
+        // VELES END
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
@@ -825,7 +1037,12 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         uint256 nHash = mnp.GetHash();
 
-        pfrom->setAskFor.erase(nHash);
+        // VELES BEGIN
+        {
+            LOCK(cs_main);
+            pfrom->setAskFor.erase(nHash);
+        }
+        // VELES END
 
         if(!masternodeSync.IsBlockchainSynced()) return;
 
@@ -897,14 +1114,26 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, const std::string& strCommand,
 
         int nInvCount = 0;
 
-        for (auto& mnpair : mapMasternodes) {
-            if (vin != CTxIn() && vin != mnpair.second.vin) continue; // asked for specific vin but we are not there yet
-            if (mnpair.second.addr.IsRFC1918() || mnpair.second.addr.IsLocal()) continue; // do not send local network masternode
-            if (mnpair.second.IsUpdateRequired()) continue; // do not send outdated masternodes
+        // VELES BEGIN
+        list_snapshot_ptr_t pSnapshot = GetMasternodeListSnapshot();
+        auto itBegin = pSnapshot->mapMasternodes.begin();
+        auto itEnd = pSnapshot->mapMasternodes.end();
+        if (vin != CTxIn()) {
+            // asked for specific vin, look it up instead of walking the list
+            itBegin = pSnapshot->mapMasternodes.find(vin.prevout);
+            if (itBegin != itEnd) itEnd = std::next(itBegin);
+        }
+
+        for (auto it = itBegin; it != itEnd; ++it) {
+            const auto& mnpair = *it;
+            const CMasternode& mn = *mnpair.second;
+            if (mn.addr.IsRFC1918() || mn.addr.IsLocal()) continue; // do not send local network masternode
+            if (mn.nActiveState == CMasternode::MASTERNODE_UPDATE_REQUIRED) continue; // do not send outdated masternodes
+        // VELES END
 
-            LogPrint(BCLog::MASTERNODE, "DSEG -- Sending Masternode entry: masternode=%s  addr=%s\n", mnpair.first.ToStringShort(), mnpair.second.addr.ToString());
-            CMasternodeBroadcast mnb = CMasternodeBroadcast(mnpair.second);
-            CMasternodePing mnp = mnpair.second.lastPing;
+            LogPrint(BCLog::MASTERNODE, "DSEG -- Sending Masternode entry: masternode=%s  addr=%s\n", mnpair.first.ToStringShort(), mn.addr.ToString());
+            CMasternodeBroadcast mnb = CMasternodeBroadcast(mn);
+            CMasternodePing mnp = mn.lastPing;
             uint256 hashMNB = mnb.GetHash();
             uint256 hashMNP = mnp.GetHash();
             pfrom->PushInventory(CInv(MSG_MASTERNODE_ANNOUNCE, hashMNB));
@@ -1086,6 +1315,10 @@ void CMasternodeMan::CheckSameAddr()
     for (auto* pmn : vBan) {
         LogPrintf("CMasternodeMan::CheckSameAddr -- increasing PoSe ban score for masternode %s\n", pmn->vin.prevout.ToStringShort());
         pmn->IncreasePoSeBanScore();
+        // VELES BEGIN
+        LOCK(cs);
+        InvalidateListSnapshot(pmn->vin.prevout);
+        // VELES END
     }
 }
 
@@ -1203,6 +1436,9 @@ void CMasternodeMan::ProcessVerifyReply(CNode* pnode, CMasternodeVerification& m
 
     {
         LOCK(cs);
+        // VELES BEGIN
+        InvalidateListSnapshot();
+        // VELES END
 
         CMasternode* prealMasternode = NULL;
         std::vector<CMasternode*> vpMasternodesToBan;
@@ -1354,6 +1590,9 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
 
         if(!pmn1->IsPoSeVerified()) {
             pmn1->DecreasePoSeBanScore();
+            // VELES BEGIN
+            InvalidateListSnapshot(mnv.vin1.prevout);
+            // VELES END
         }
         mnv.Relay();
 
@@ -1365,6 +1604,9 @@ void CMasternodeMan::ProcessVerifyBroadcast(CNode* pnode, const CMasternodeVerif
         for (auto& mnpair : mapMasternodes) {
             if(mnpair.second.addr != mnv.addr || mnpair.first == mnv.vin1.prevout) continue;
             mnpair.second.IncreasePoSeBanScore();
+            // VELES BEGIN
+            InvalidateListSnapshot(mnpair.first);
+            // VELES END
             nCount++;
             LogPrint(BCLog::MASTERNODE, "CMasternodeMan::ProcessVerifyBroadcast -- increased PoSe ban score for %s addr %s, new score %d\n",
                         mnpair.first.ToStringShort(), mnpair.second.addr.ToString(), mnpair.second.nPoSeBanScore);
@@ -1403,10 +1645,18 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman& co
         }
     } else {
         CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
+        // VELES BEGIN
+        int nProtocolVersionOld = pmn->nProtocolVersion;
+        // VELES END
         if(pmn->UpdateFromNewBroadcast(mnb, connman)) {
             masternodeSync.BumpAssetLastTime("CMasternodeMan::UpdateMasternodeList - seen");
             mapSeenMasternodeBroadcast.erase(mnbOld.GetHash());
         }
+        // VELES BEGIN
+        if(pmn->nProtocolVersion != nProtocolVersionOld) {
+            InvalidateRankingCache();
+        }
+        // VELES END
     }
 }
 
@@ -1465,7 +1715,14 @@ bool CMasternodeMan::CheckMnbAndUpdateMasternodeList(CNode* pfrom, CMasternodeBr
         CMasternode* pmn = Find(mnb.vin.prevout);
         if(pmn) {
             CMasternodeBroadcast mnbOld = mapSeenMasternodeBroadcast[CMasternodeBroadcast(*pmn).GetHash()].second;
-            if(!mnb.Update(pmn, nDos, connman)) {
+            // VELES BEGIN
+            int nProtocolVersionOld = pmn->nProtocolVersion;
+            bool fUpdated = mnb.Update(pmn, nDos, connman);
+            if(pmn->nProtocolVersion != nProtocolVersionOld) {
+                InvalidateRankingCache();
+            }
+            if(!fUpdated) {
+            // VELES END
                 LogPrint(BCLog::MASTERNODE, "CMasternodeMan::CheckMnbAndUpdateMasternodeList -- Update() failed, masternode=%s\n", mnb.vin.prevout.ToStringShort());
                 return false;
             }
@@ -1520,8 +1777,17 @@ void CMasternodeMan::UpdateLastPaid(const CBlockIndex* pindex)
     // LogPrint("mnpayments", "CMasternodeMan::UpdateLastPaid -- nHeight=%d, nMaxBlocksToScanBack=%d, IsFirstRun=%s\n",
     //                         nCachedBlockHeight, nMaxBlocksToScanBack, IsFirstRun ? "true" : "false");
 
+    // VELES BEGIN
+    mnpayments.IndexPaidBlocks(pindex, nMaxBlocksToScanBack);
+    // VELES END
+
     for (auto& mnpair: mapMasternodes) {
+        // VELES BEGIN
+        int nBlockLastPaidPrev = mnpair.second.nBlockLastPaid;
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        if (mnpair.second.nBlockLastPaid != nBlockLastPaidPrev)
+            InvalidateListSnapshot(mnpair.first);
+        // VELES END
     }
 
     IsFirstRun = false;
@@ -1560,6 +1826,10 @@ void CMasternodeMan::RemoveGovernanceObject(uint256 nGovernanceObjectHash)
 {
     LOCK(cs);
     for(auto& mnpair : mapMasternodes) {
+        // VELES BEGIN
+        if (mnpair.second.mapGovernanceObjectsVotedOn.count(nGovernanceObjectHash))
+            InvalidateListSnapshot(mnpair.first);
+        // VELES END
         mnpair.second.RemoveGovernanceObject(nGovernanceObjectHash);
     }
 }
@@ -1573,6 +1843,9 @@ void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForc
     for (auto& mnpair : mapMasternodes) {
         if (mnpair.second.pubKeyMasternode == pubKeyMasternode) {
             mnpair.second.Check(fForce);
+            // VELES BEGIN
+            InvalidateListSnapshot(mnpair.first);
+            // VELES END
             return;
         }
     }
@@ -1581,7 +1854,9 @@ void CMasternodeMan::CheckMasternode(const CPubKey& pubKeyMasternode, bool fForc
 bool CMasternodeMan::IsMasternodePingedWithin(const COutPoint& outpoint, int nSeconds, int64_t nTimeToCheckAt)
 {
     LOCK(cs);
-    CMasternode* pmn = Find(outpoint);
+    // VELES BEGIN
+    const CMasternode* pmn = FindReadOnly(outpoint);
+    // VELES END
     return pmn ? pmn->IsPingedWithin(nSeconds, nTimeToCheckAt) : false;
 }
 
@@ -8,6 +8,12 @@
 
 #include <masternode.h>
 #include <sync.h>
+// VELES BEGIN
+#include <cachemap.h>
+
+#include <memory>
+#include <set>
+// VELES END
 
 using namespace std;
 
@@ -16,6 +22,48 @@ class CConnman;
 
 extern CMasternodeMan mnodeman;
 
+// VELES BEGIN
+/** Exact match conditions of a masternode list query, the ones left unset match any masternode */
+struct CMasternodeFilter
+{
+    int nActiveState = -1;
+    int nProtocolVersion = -1;
+    int nMinProtocolVersion = -1;
+    CKeyID payee;
+    CService addr;
+
+    bool Matches(const CMasternode& mn) const;
+};
+
+/**
+ * Immutable copy of the masternode list with indexes for queries. It is
+ * shared by all readers until the list changes, then rebuilt on demand.
+ * The copies of masternodes that did not change are shared with the
+ * snapshot it was rebuilt from.
+ */
+class CMasternodeListSnapshot
+{
+public:
+    typedef std::map<COutPoint, std::shared_ptr<const CMasternode>> masternode_map_t;
+
+    const masternode_map_t mapMasternodes;
+
+private:
+    std::multimap<int, const CMasternode*> mapByState;
+    std::multimap<int, const CMasternode*> mapByProtocol;
+    std::multimap<CKeyID, const CMasternode*> mapByPayee;
+    std::multimap<CService, const CMasternode*> mapByAddr;
+
+public:
+    explicit CMasternodeListSnapshot(masternode_map_t&& mapMasternodesIn);
+
+    /// Masternodes matching filter, ordered by outpoint
+    std::vector<const CMasternode*> Query(const CMasternodeFilter& filter) const;
+
+    size_t size() const { return mapMasternodes.size(); }
+};
+// VELES END
+
 class CMasternodeMan
 {
 public:
@@ -23,6 +71,9 @@ public:
     typedef std::vector<score_pair_t> score_pair_vec_t;
     typedef std::pair<int, CMasternode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
+    // VELES BEGIN
+    typedef std::shared_ptr<const CMasternodeListSnapshot> list_snapshot_ptr_t;
+    // VELES END
 
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
@@ -42,6 +93,19 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    // VELES BEGIN
+    static const int MAX_RANKING_CACHE_SIZE         = 32;
+
+    /// Masternodes ordered by score for one (block hash, min protocol) pair
+    struct CMasternodeRanking
+    {
+        std::vector<COutPoint> vecOutpoints; // index is rank - 1
+        std::map<COutPoint, int> mapRanks;
+    };
+    typedef std::shared_ptr<const CMasternodeRanking> ranking_ptr_t;
+    typedef CacheMap<std::pair<uint256, int>, ranking_ptr_t> ranking_cache_t;
+    // VELES END
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -75,12 +139,40 @@ private:
 
     int64_t nLastWatchdogVoteTime;
 
+    // VELES BEGIN
+    /// Rankings by (block hash, min protocol), dropped whenever the ranked set of masternodes changes
+    ranking_cache_t mapRankingCache;
+    /// Copy of mapMasternodes handed out to readers, rebuilt once masternodes change
+    list_snapshot_ptr_t listSnapshot;
+    /// Masternodes added, changed or removed since listSnapshot was built
+    std::set<COutPoint> setListSnapshotChanged;
+    /// MNANNOUNCE messages for seen broadcasts, with the lastPing sigTime they were serialized with
+    std::map<uint256, std::pair<int64_t, CSharedNetMsgRef> > mapMasternodeBroadcastMessages;
+    /// MNPING messages for seen pings
+    std::map<uint256, CSharedNetMsgRef> mapMasternodePingMessages;
+    // VELES END
+
     friend class CMasternodeSync;
-    /// Find an entry
+    /// Find an entry, which may be changed: marks it changed for the list snapshot
     CMasternode* Find(const COutPoint& outpoint);
+    // VELES BEGIN
+    /// Find an entry only to read it
+    const CMasternode* FindReadOnly(const COutPoint& outpoint) const;
+    // VELES END
 
     bool GetMasternodeScores(const uint256& nBlockHash, score_pair_vec_t& vecMasternodeScoresRet, int nMinProtocol = 0);
 
+    // VELES BEGIN
+    /// Get the (cached) ranking of all masternodes for nBlockHash, NULL if there is none
+    ranking_ptr_t GetMasternodeRanking(const uint256& nBlockHash, int nMinProtocol);
+    /// Must be called whenever masternodes are added or removed or change their protocol version
+    void InvalidateRankingCache() { mapRankingCache.Clear(); }
+    /// Must be called whenever masternodes change, all of them may have
+    void InvalidateListSnapshot() { listSnapshot.reset(); setListSnapshotChanged.clear(); }
+    /// Must be called whenever a masternode is added, changed or removed
+    void InvalidateListSnapshot(const COutPoint& outpoint) { if (listSnapshot) setListSnapshotChanged.insert(outpoint); }
+    // VELES END
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CMasternodeBroadcast> > mapSeenMasternodeBroadcast;
@@ -120,8 +212,27 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        // VELES BEGIN
+        if(ser_action.ForRead()) {
+            InvalidateRankingCache();
+            InvalidateListSnapshot();
+            mapMasternodeBroadcastMessages.clear();
+            mapMasternodePingMessages.clear();
+        }
+        // VELES END
+    }
+
+    // VELES BEGIN
+    /** CJournalDB support: masternodes change with every ping, store the list whole */
+    template <typename Stream, typename Operation>
+    inline void JournalBaseOp(Stream& s, Operation ser_action) {
+        SerializationOp(s, ser_action);
     }
 
+    template <typename Journal>
+    void JournalMapsOp(Journal& journal) {}
+    // VELES END
+
     CMasternodeMan();
 
     /// Add an entry
@@ -174,7 +285,14 @@ public:
     /// Find a random entry
     masternode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CMasternode> GetFullMasternodeMap() { return mapMasternodes; }
+    // VELES BEGIN
+    /// Immutable copy of the list, shared with other readers until any masternode changes
+    list_snapshot_ptr_t GetMasternodeListSnapshot();
+    /// MNANNOUNCE message for a seen broadcast, serialized once and shared by all requests, NULL if not seen
+    CSharedNetMsgRef GetMasternodeBroadcastMessage(const uint256& hash);
+    /// MNPING message for a seen ping, serialized once and shared by all requests, NULL if not seen
+    CSharedNetMsgRef GetMasternodePingMessage(const uint256& hash);
+    // VELES END
 
     bool GetMasternodeRanks(rank_pair_vec_t& vecMasternodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
     bool GetMasternodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
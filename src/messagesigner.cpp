@@ -10,6 +10,63 @@
 #include <tinyformat.h>
 #include <utilstrencodings.h>
 
+// VELES BEGIN
+#include <checkqueue.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util.h>
+
+#include <boost/thread.hpp>
+
+namespace {
+/**
+ * Valid masternode message signatures, filled by PreVerifyHashSignatures
+ * ahead of the message handler thread getting to them, and by VerifyHash
+ * so that votes checked again on sync are not recovered twice
+ */
+class CHashSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || public key || signature):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_hashsigcache;
+
+public:
+    static const size_t MAX_CACHE_BYTES = 4 << 20;
+
+    CHashSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(MAX_CACHE_BYTES);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CPubKey& pubkey, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(pubkey.begin(), pubkey.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_hashsigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_hashsigcache);
+        setValid.insert(entry);
+    }
+};
+
+static CHashSignatureCache hashSignatureCache;
+
+static CCheckQueue<CHashSignatureCheck> hashsigcheckqueue(16);
+} // namespace
+// VELES END
+
 bool CMessageSigner::GetKeysFromSecret(const std::string strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     keyRet = DecodeSecret(strSecret);
@@ -30,13 +87,20 @@ bool CMessageSigner::SignMessage(const std::string strMessage, std::vector<unsig
 }
 
 bool CMessageSigner::VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet)
+{
+    return CHashSigner::VerifyHash(GetMessageHash(strMessage), pubkey, vchSig, strErrorRet);
+}
+
+// VELES BEGIN
+uint256 CMessageSigner::GetMessageHash(const std::string& strMessage)
 {
     CHashWriter ss(SER_GETHASH, 0);
     ss << strMessageMagic;
     ss << strMessage;
 
-    return CHashSigner::VerifyHash(ss.GetHash(), pubkey, vchSig, strErrorRet);
+    return ss.GetHash();
 }
+// VELES END
 
 bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsigned char>& vchSigRet)
 {
@@ -45,6 +109,12 @@ bool CHashSigner::SignHash(const uint256& hash, const CKey key, std::vector<unsi
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    // VELES BEGIN
+    uint256 entry;
+    hashSignatureCache.ComputeEntry(entry, hash, pubkey, vchSig);
+    if(hashSignatureCache.Get(entry)) return true;
+    // VELES END
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -58,5 +128,38 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey pubkey, const st
         return false;
     }
 
+    // VELES BEGIN
+    hashSignatureCache.Set(entry);
+    // VELES END
+
+    return true;
+}
+
+// VELES BEGIN
+bool CHashSignatureCheck::operator()()
+{
+    CPubKey pubkeyFromSig;
+    if(pubkeyFromSig.RecoverCompact(hash, vchSig) && pubkeyFromSig.GetID() == pubkey.GetID()) {
+        uint256 entry;
+        hashSignatureCache.ComputeEntry(entry, hash, pubkey, vchSig);
+        hashSignatureCache.Set(entry);
+    }
+    return true;
+}
+
+void ThreadHashSignatureCheck()
+{
+    RenameThread("veles-sigcheck");
+    hashsigcheckqueue.Thread();
+}
+
+bool PreVerifyHashSignatures(std::vector<CHashSignatureCheck>& vChecks)
+{
+    if(!nScriptCheckThreads) return false;
+
+    CCheckQueueControl<CHashSignatureCheck> control(&hashsigcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
     return true;
 }
+// VELES END
@@ -19,6 +19,10 @@ public:
     static bool SignMessage(const std::string strMessage, std::vector<unsigned char>& vchSigRet, const CKey key);
     /// Verify the message signature, returns true if succcessful
     static bool VerifyMessage(const CPubKey pubkey, const std::vector<unsigned char>& vchSig, const std::string strMessage, std::string& strErrorRet);
+    // VELES BEGIN
+    /// Get the hash that is signed for the message
+    static uint256 GetMessageHash(const std::string& strMessage);
+    // VELES END
 };
 
 /** Helper class for signing hashes and checking their signatures
@@ -32,4 +36,35 @@ public:
     static bool VerifyHash(const uint256& hash, const CPubKey pubkey, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
+// VELES BEGIN
+/** A signature check run ahead of time on the signature check threads,
+ *  valid signatures are remembered so that VerifyHash does not check them again
+ */
+class CHashSignatureCheck
+{
+private:
+    uint256 hash;
+    CPubKey pubkey;
+    std::vector<unsigned char> vchSig;
+
+public:
+    CHashSignatureCheck() {}
+    CHashSignatureCheck(const uint256& hashIn, const CPubKey& pubkeyIn, const std::vector<unsigned char>& vchSigIn) : hash(hashIn), pubkey(pubkeyIn), vchSig(vchSigIn) {}
+
+    /// Always succeeds, so that one bad signature does not stop the rest of the batch
+    bool operator()();
+
+    void swap(CHashSignatureCheck& check) {
+        std::swap(hash, check.hash);
+        std::swap(pubkey, check.pubkey);
+        vchSig.swap(check.vchSig);
+    }
+};
+
+/** Run signature check threads */
+void ThreadHashSignatureCheck();
+/** Check a batch of signatures in parallel, returns false if there are no threads to do so */
+bool PreVerifyHashSignatures(std::vector<CHashSignatureCheck>& vChecks);
+// VELES END
+
 #endif // FXTC_MESSAGESIGNER_H
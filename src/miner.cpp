@@ -46,6 +46,33 @@
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockWeight = 0;
 
+// VELES BEGIN
+/**
+ * Transactions selected for the last block template. The selection only
+ * depends on the tip, the mempool and the assembler options, so templates
+ * of every algo share it until one of those changes.
+ */
+struct CachedPackages
+{
+    uint256 hashPrevBlock;
+    int nHeight;
+    int64_t nLockTimeCutoff;
+    unsigned int nTransactionsUpdated;
+    bool fIncludeWitness;
+    unsigned int nBlockMaxWeight;
+    CFeeRate blockMinFeeRate;
+
+    std::vector<CTransactionRef> vtx;
+    std::vector<CAmount> vTxFees;
+    std::vector<int64_t> vTxSigOpsCost;
+    uint64_t nBlockWeight;
+    uint64_t nBlockSigOpsCost;
+    CAmount nFees;
+};
+
+static std::unique_ptr<CachedPackages> cachedPackages GUARDED_BY(cs_main);
+// VELES END
+
 int64_t UpdateTime(CBlock* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     int64_t nOldTime = pblock->nTime;
@@ -111,11 +138,17 @@ int64_t UpdateTime(CBlock* pblock, const Consensus::Params& consensusParams, con
 BlockAssembler::Options::Options() {
     blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
     nBlockMaxWeight = DEFAULT_BLOCK_MAX_WEIGHT;
+    // VELES BEGIN
+    nAlgo = ALGO_NULL;
+    // VELES END
 }
 
 BlockAssembler::BlockAssembler(const CChainParams& params, const Options& options) : chainparams(params)
 {
     blockMinFeeRate = options.blockMinFeeRate;
+    // VELES BEGIN
+    nAlgo = options.nAlgo;
+    // VELES END
     // Limit weight to between 4K and MAX_BLOCK_WEIGHT-4K for sanity:
     nBlockMaxWeight = std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, options.nBlockMaxWeight));
 }
@@ -138,6 +171,17 @@ static BlockAssembler::Options DefaultOptions()
 
 BlockAssembler::BlockAssembler(const CChainParams& params) : BlockAssembler(params, DefaultOptions()) {}
 
+// VELES BEGIN
+static BlockAssembler::Options AlgoOptions(int32_t nAlgo)
+{
+    BlockAssembler::Options options = DefaultOptions();
+    options.nAlgo = nAlgo;
+    return options;
+}
+
+BlockAssembler::BlockAssembler(const CChainParams& params, int32_t nAlgo) : BlockAssembler(params, AlgoOptions(nAlgo)) {}
+// VELES END
+
 void BlockAssembler::resetBlock()
 {
     inBlock.clear();
@@ -152,6 +196,50 @@ void BlockAssembler::resetBlock()
     nFees = 0;
 }
 
+// VELES BEGIN
+bool BlockAssembler::LoadCachedPackages(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated)
+{
+    if (!cachedPackages
+        || cachedPackages->hashPrevBlock != pindexPrev->GetBlockHash()
+        || cachedPackages->nHeight != nHeight
+        || cachedPackages->nLockTimeCutoff != nLockTimeCutoff
+        || cachedPackages->nTransactionsUpdated != nTransactionsUpdated
+        || cachedPackages->fIncludeWitness != fIncludeWitness
+        || cachedPackages->nBlockMaxWeight != nBlockMaxWeight
+        || cachedPackages->blockMinFeeRate != blockMinFeeRate)
+        return false;
+
+    pblock->vtx.insert(pblock->vtx.end(), cachedPackages->vtx.begin(), cachedPackages->vtx.end());
+    pblocktemplate->vTxFees.insert(pblocktemplate->vTxFees.end(), cachedPackages->vTxFees.begin(), cachedPackages->vTxFees.end());
+    pblocktemplate->vTxSigOpsCost.insert(pblocktemplate->vTxSigOpsCost.end(), cachedPackages->vTxSigOpsCost.begin(), cachedPackages->vTxSigOpsCost.end());
+    nBlockWeight = cachedPackages->nBlockWeight;
+    nBlockTx = cachedPackages->vtx.size();
+    nBlockSigOpsCost = cachedPackages->nBlockSigOpsCost;
+    nFees = cachedPackages->nFees;
+    return true;
+}
+
+void BlockAssembler::StoreCachedPackages(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated)
+{
+    cachedPackages.reset(new CachedPackages());
+    cachedPackages->hashPrevBlock = pindexPrev->GetBlockHash();
+    cachedPackages->nHeight = nHeight;
+    cachedPackages->nLockTimeCutoff = nLockTimeCutoff;
+    cachedPackages->nTransactionsUpdated = nTransactionsUpdated;
+    cachedPackages->fIncludeWitness = fIncludeWitness;
+    cachedPackages->nBlockMaxWeight = nBlockMaxWeight;
+    cachedPackages->blockMinFeeRate = blockMinFeeRate;
+
+    // Everything but the coinbase
+    cachedPackages->vtx.assign(pblock->vtx.begin() + 1, pblock->vtx.end());
+    cachedPackages->vTxFees.assign(pblocktemplate->vTxFees.begin() + 1, pblocktemplate->vTxFees.end());
+    cachedPackages->vTxSigOpsCost.assign(pblocktemplate->vTxSigOpsCost.begin() + 1, pblocktemplate->vTxSigOpsCost.end());
+    cachedPackages->nBlockWeight = nBlockWeight;
+    cachedPackages->nBlockSigOpsCost = nBlockSigOpsCost;
+    cachedPackages->nFees = nFees;
+}
+// VELES END
+
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx)
 {
     int64_t nTimeStart = GetTimeMicros();
@@ -179,6 +267,11 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     // -blockversion=N to test forking scenarios
     if (chainparams.MineBlocksOnDemand())
         pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
+    // VELES BEGIN
+    // Mine another algo than -algo, once blocks carry the algo in their version
+    if (nAlgo != ALGO_NULL && (pblock->nVersion & VERSIONBITS_TOP_MASK) == VERSIONBITS_TOP_BITS)
+        pblock->nVersion = (pblock->nVersion & ~ALGO_VERSION_MASK) | nAlgo;
+    // VELES END
 
     pblock->nTime = GetAdjustedTime();
     const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
@@ -200,7 +293,12 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
-    addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    // VELES BEGIN
+    const unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    const bool fCachedPackages = LoadCachedPackages(pindexPrev, nTransactionsUpdated);
+    if (!fCachedPackages)
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    // VELES END
 
     int64_t nTime1 = GetTimeMicros();
 
@@ -255,12 +353,22 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
     CValidationState state;
-    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+    // VELES BEGIN
+    // The cached transactions already passed TestBlockValidity on this tip, so their
+    // scripts are not run again; the coinbase and the header differ between algos
+    if (fCachedPackages) {
+        if (!TestBlockTemplateValidity(state, chainparams, *pblock, pindexPrev, nFees)) {
+            throw std::runtime_error(strprintf("%s: TestBlockTemplateValidity failed: %s", __func__, FormatStateMessage(state)));
+        }
+    } else if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
         throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+    } else {
+        StoreCachedPackages(pindexPrev, nTransactionsUpdated);
     }
+    // VELES END
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants%s), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, fCachedPackages ? ", cached" : "", 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -134,6 +134,9 @@ private:
     bool fIncludeWitness;
     unsigned int nBlockMaxWeight;
     CFeeRate blockMinFeeRate;
+    // VELES BEGIN
+    int32_t nAlgo;
+    // VELES END
 
     // Information on the current status of the block
     uint64_t nBlockWeight;
@@ -152,9 +155,17 @@ public:
         Options();
         size_t nBlockMaxWeight;
         CFeeRate blockMinFeeRate;
+        // VELES BEGIN
+        /** Algo the block is mined with, ALGO_NULL for -algo */
+        int32_t nAlgo;
+        // VELES END
     };
 
     explicit BlockAssembler(const CChainParams& params);
+    // VELES BEGIN
+    /** Default options, mining nAlgo instead of -algo */
+    BlockAssembler(const CChainParams& params, int32_t nAlgo);
+    // VELES END
     BlockAssembler(const CChainParams& params, const Options& options);
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
@@ -192,6 +203,13 @@ private:
       * state updated assuming given transactions are inBlock. Returns number
       * of updated descendants. */
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    // VELES BEGIN
+    /** Fill the block with the transactions selected for the last template,
+      * if it was built on the same tip and mempool with the same options */
+    bool LoadCachedPackages(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Remember the transactions selected for this template */
+    void StoreCachedPackages(const CBlockIndex* pindexPrev, unsigned int nTransactionsUpdated) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    // VELES END
 };
 
 /** Modify the extranonce in a block */
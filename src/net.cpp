@@ -923,6 +923,10 @@ int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
     if (hdr.nMessageSize > MAX_SIZE)
         return -1;
 
+    // VELES BEGIN
+    nCommandId = GetNetMessageTypeId(hdr.GetCommand());
+    // VELES END
+
     // switch state to reading message data
     in_data = true;
 
@@ -969,7 +973,9 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
+        // VELES BEGIN
+        const auto &data = **it;
+        // VELES END
         assert(data.size() > pnode->nSendOffset);
         int nBytes = 0;
         {
@@ -2269,6 +2275,90 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+// VELES BEGIN
+void CConnman::PushMasternodeMessage(CNode* pnode, std::list<CNetMessage>& msgs, MasternodeMessagePriority nPriority)
+{
+    {
+        // Keep the message counted against the receive flood size until it is processed
+        LOCK(pnode->cs_vProcessMsg);
+        pnode->nProcessQueueSize += msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutexMnMsgProc);
+        std::list<CNetMessage>& vProcessMnMsg = pnode->vProcessMnMsg[nPriority];
+        vProcessMnMsg.splice(vProcessMnMsg.end(), msgs, msgs.begin());
+        if (pnode->fMnMsgScheduled[nPriority])
+            return;
+        pnode->fMnMsgScheduled[nPriority] = true;
+        pnode->AddRef();
+        vMnMsgReadyNodes[nPriority].push_back(pnode);
+    }
+    condMnMsgProc.notify_one();
+}
+
+void CConnman::StartMasternodeMessageThreads()
+{
+    for (int i = 0; i < nMasternodeMessageThreads; i++)
+        threadMasternodeMessageHandlers.emplace_back(&TraceThread<std::function<void()> >, "mnmsghand", std::function<void()>(std::bind(&CConnman::ThreadMasternodeMessageHandler, this)));
+}
+
+void CConnman::ThreadMasternodeMessageHandler()
+{
+    while (!flagInterruptMsgProc)
+    {
+        CNode* pnode;
+        int nPriority;
+        std::list<CNetMessage> msgs;
+        {
+            std::unique_lock<std::mutex> lock(mutexMnMsgProc);
+            condMnMsgProc.wait(lock, [this] {
+                if (flagInterruptMsgProc)
+                    return true;
+                for (const auto& vReadyNodes : vMnMsgReadyNodes) {
+                    if (!vReadyNodes.empty())
+                        return true;
+                }
+                return false;
+            });
+            if (flagInterruptMsgProc)
+                return;
+
+            // A node's queue is taken by one thread at a time, which keeps its messages in order
+            for (nPriority = 0; vMnMsgReadyNodes[nPriority].empty(); nPriority++) {}
+            pnode = vMnMsgReadyNodes[nPriority].front();
+            vMnMsgReadyNodes[nPriority].pop_front();
+            msgs.splice(msgs.begin(), pnode->vProcessMnMsg[nPriority], pnode->vProcessMnMsg[nPriority].begin());
+        }
+
+        // Processing consumes vRecv, so take the size it was counted with first
+        const size_t nMessageSize = msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        if (!pnode->fDisconnect)
+            m_msgproc->ProcessMasternodeMessage(pnode, msgs.front(), flagInterruptMsgProc);
+
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            pnode->nProcessQueueSize -= nMessageSize;
+            pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+        }
+
+        bool fRelease = false;
+        {
+            // Go to the back of the line to let the other peers' messages of this priority through
+            std::lock_guard<std::mutex> lock(mutexMnMsgProc);
+            if (!pnode->vProcessMnMsg[nPriority].empty()) {
+                vMnMsgReadyNodes[nPriority].push_back(pnode);
+            } else {
+                pnode->fMnMsgScheduled[nPriority] = false;
+                fRelease = true;
+            }
+        }
+        if (fRelease)
+            pnode->Release();
+    }
+}
+// VELES END
 
 
 
@@ -2585,6 +2675,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // VELES BEGIN
+    StartMasternodeMessageThreads();
+    // VELES END
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
@@ -2614,6 +2707,13 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    // VELES BEGIN
+    {
+        // The masternode message threads check the flag under their own mutex
+        std::lock_guard<std::mutex> lock(mutexMnMsgProc);
+    }
+    condMnMsgProc.notify_all();
+    // VELES END
 
     interruptNet();
     InterruptSocks5(true);
@@ -2635,6 +2735,21 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    // VELES BEGIN
+    for (std::thread& threadMasternodeMessageHandler : threadMasternodeMessageHandlers) {
+        if (threadMasternodeMessageHandler.joinable())
+            threadMasternodeMessageHandler.join();
+    }
+    threadMasternodeMessageHandlers.clear();
+    for (int nPriority = 0; nPriority < MNMSG_PRIORITY_COUNT; nPriority++) {
+        for (CNode* pnode : vMnMsgReadyNodes[nPriority]) {
+            pnode->vProcessMnMsg[nPriority].clear();
+            pnode->fMnMsgScheduled[nPriority] = false;
+            pnode->Release();
+        }
+        vMnMsgReadyNodes[nPriority].clear();
+    }
+    // VELES END
     // Dash
     if (threadMnbRequestConnections.joinable())
         threadMnbRequestConnections.join();
@@ -3059,6 +3174,11 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fPauseRecv = false;
     fPauseSend = false;
     nProcessQueueSize = 0;
+    // VELES BEGIN
+    nPreVerifiedMsgs = 0;
+    for (bool& fScheduled : fMnMsgScheduled)
+        fScheduled = false;
+    // VELES END
 
     for (const std::string &msg : getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
@@ -3129,19 +3249,44 @@ bool CConnman::NotMasternodesOnly(const CNode* pnode)
     return pnode && !pnode->fMasternode;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+// VELES BEGIN
+static std::vector<unsigned char> SerializeMessageHeader(const std::string& command, const std::vector<unsigned char>& data)
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
-
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    uint256 hash = Hash(data.data(), data.data() + data.size());
+    CMessageHeader hdr(Params().MessageStart(), command.c_str(), data.size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    return serializedHeader;
+}
+
+CSharedNetMsg::CSharedNetMsg(const std::string& commandIn, std::vector<unsigned char>&& dataIn)
+    : command(commandIn), header(SerializeMessageHeader(commandIn, dataIn)), data(std::move(dataIn))
+{
+}
+// VELES END
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    // VELES BEGIN
+    CSendBufferRef header = std::make_shared<const std::vector<unsigned char> >(SerializeMessageHeader(msg.command, msg.data));
+    PushMessageBuffers(pnode, msg.command, std::move(header), std::make_shared<const std::vector<unsigned char> >(std::move(msg.data)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSharedNetMsgRef& msg)
+{
+    // The send queue keeps the whole message alive through its header and payload
+    PushMessageBuffers(pnode, msg->command, CSendBufferRef(msg, &msg->header), CSendBufferRef(msg, &msg->data));
+}
+
+void CConnman::PushMessageBuffers(CNode* pnode, const std::string& command, CSendBufferRef header, CSendBufferRef data)
+{
+    size_t nMessageSize = data->size();
+    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(command.c_str()), nMessageSize, pnode->GetId());
+    // VELES END
 
     size_t nBytesSent = 0;
     {
@@ -3149,14 +3294,16 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         bool optimisticSend(pnode->vSendMsg.empty());
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendBytesPerMsgCmd[command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        // VELES BEGIN
+        pnode->vSendMsg.push_back(std::move(header));
         if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            pnode->vSendMsg.push_back(std::move(data));
+        // VELES END
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
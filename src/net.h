@@ -91,6 +91,21 @@ static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
+// VELES BEGIN
+/** -mnmsgthreads default, 0 processes masternode subsystem messages on the message handler thread */
+static const int DEFAULT_MNMSG_THREADS = 1;
+/** Maximum number of masternode message threads */
+static const int MAX_MNMSG_THREADS = 16;
+
+/** Queues of the masternode message threads, a lower one is always served first */
+enum MasternodeMessagePriority {
+    MNMSG_PRIORITY_INSTANTSEND,
+    MNMSG_PRIORITY_MASTERNODE,
+    MNMSG_PRIORITY_GOVERNANCE,
+    MNMSG_PRIORITY_COUNT
+};
+// VELES END
+
 typedef int64_t NodeId;
 
 struct AddedNodeInfo
@@ -117,7 +132,28 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+// VELES BEGIN
+/** A message serialized once, which any number of peers can be sent without copying it */
+class CSharedNetMsg
+{
+public:
+    CSharedNetMsg(const std::string& commandIn, std::vector<unsigned char>&& dataIn);
+
+    const std::string command;
+    /** Message header with the payload checksum */
+    const std::vector<unsigned char> header;
+    const std::vector<unsigned char> data;
+};
+typedef std::shared_ptr<const CSharedNetMsg> CSharedNetMsgRef;
+
+/** A chunk of a peer's send queue, shared with the other peers it goes to */
+typedef std::shared_ptr<const std::vector<unsigned char> > CSendBufferRef;
+// VELES END
+
 class NetEventsInterface;
+// VELES BEGIN
+class CNetMessage;
+// VELES END
 class CConnman
 {
 public:
@@ -149,6 +185,9 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        // VELES BEGIN
+        int nMasternodeMessageThreads = 0;
+        // VELES END
     };
 
     void Init(const Options& connOptions) {
@@ -160,6 +199,9 @@ public:
         nBestHeight = connOptions.nBestHeight;
         clientInterface = connOptions.uiInterface;
         m_msgproc = connOptions.m_msgproc;
+        // VELES BEGIN
+        nMasternodeMessageThreads = connOptions.nMasternodeMessageThreads;
+        // VELES END
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         {
@@ -217,6 +259,9 @@ public:
     //
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    // VELES BEGIN
+    void PushMessage(CNode* pnode, const CSharedNetMsgRef& msg);
+    // VELES END
 
     template<typename Condition, typename Callable>
     bool ForEachNodeContinueIf(const Condition& cond, Callable&& func)
@@ -401,6 +446,17 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    // VELES BEGIN
+    /** Whether masternode subsystem messages are processed on their own threads */
+    bool HasMasternodeMessageThreads() const { return nMasternodeMessageThreads > 0; }
+    /**
+     * Hand a received message over to the masternode message threads. The
+     * messages of one peer and priority are processed one at a time, in the
+     * order they were pushed.
+     */
+    void PushMasternodeMessage(CNode* pnode, std::list<CNetMessage>& msgs, MasternodeMessagePriority nPriority);
+    // VELES END
+
     void WakeMessageHandler();
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
@@ -425,6 +481,10 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    // VELES BEGIN
+    void ThreadMasternodeMessageHandler();
+    void StartMasternodeMessageThreads();
+    // VELES END
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -451,6 +511,9 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+    // VELES BEGIN
+    void PushMessageBuffers(CNode* pnode, const std::string& command, CSendBufferRef header, CSendBufferRef data);
+    // VELES END
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -531,6 +594,16 @@ private:
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
 
+    // VELES BEGIN
+    int nMasternodeMessageThreads;
+    std::condition_variable condMnMsgProc;
+    /** Guards vMnMsgReadyNodes and the masternode message queues of the nodes */
+    std::mutex mutexMnMsgProc;
+    /** Nodes with masternode messages waiting and no thread processing them, each holds a reference */
+    std::deque<CNode*> vMnMsgReadyNodes[MNMSG_PRIORITY_COUNT];
+    std::vector<std::thread> threadMasternodeMessageHandlers;
+    // VELES END
+
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
@@ -581,6 +654,10 @@ class NetEventsInterface
 {
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    // VELES BEGIN
+    /** Process a message handed over to the masternode message threads */
+    virtual void ProcessMasternodeMessage(CNode* pnode, CNetMessage& msg, std::atomic<bool>& interrupt) = 0;
+    // VELES END
     virtual bool SendMessages(CNode* pnode) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
@@ -693,6 +770,9 @@ public:
     unsigned int nDataPos;
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
+    // VELES BEGIN
+    int nCommandId;                 // hdr command interned by GetNetMessageTypeId
+    // VELES END
 
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
@@ -700,6 +780,9 @@ public:
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        // VELES BEGIN
+        nCommandId = NET_MESSAGE_TYPE_UNKNOWN;
+        // VELES END
     }
 
     bool complete() const
@@ -733,7 +816,9 @@ public:
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<std::vector<unsigned char>> vSendMsg;
+    // VELES BEGIN
+    std::deque<CSendBufferRef> vSendMsg;
+    // VELES END
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -741,6 +826,15 @@ public:
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg;
     size_t nProcessQueueSize;
+    // VELES BEGIN
+    // Messages at the front of vProcessMsg whose signatures were already checked ahead, message handler thread only
+    size_t nPreVerifiedMsgs;
+    // Masternode subsystem messages waiting for the masternode message threads, guarded by CConnman::mutexMnMsgProc.
+    // They stay counted in nProcessQueueSize until processed.
+    std::list<CNetMessage> vProcessMnMsg[MNMSG_PRIORITY_COUNT];
+    // Whether the queue of a priority is in CConnman::vMnMsgReadyNodes or being processed
+    bool fMnMsgScheduled[MNMSG_PRIORITY_COUNT];
+    // VELES END
 
     CCriticalSection cs_sendProcessing;
 
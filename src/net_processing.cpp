@@ -40,6 +40,9 @@
 #include <masternode-payments.h>
 #include <masternode-sync.h>
 #include <masternodeman.h>
+// VELES BEGIN
+#include <messagesigner.h>
+// VELES END
 #ifdef ENABLE_WALLET
 #include <privatesend-client.h>
 #endif // ENABLE_WALLET
@@ -810,6 +813,11 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans)
     return nEvicted;
 }
 
+// VELES BEGIN
+/** Misbehaving calls that scored a peer on this thread, so a masternode message thread takes cs_main only when needed */
+static thread_local uint64_t nMisbehavingCalls = 0;
+// VELES END
+
 /**
  * Mark a misbehaving peer to be banned depending upon the value of `-banscore`.
  */
@@ -822,6 +830,10 @@ void Misbehaving(NodeId pnode, int howmuch, const std::string& message) EXCLUSIV
     if (state == nullptr)
         return;
 
+    // VELES BEGIN
+    nMisbehavingCalls++;
+    // VELES END
+
     state->nMisbehavior += howmuch;
     int banscore = gArgs.GetArg("-banscore", DEFAULT_BANSCORE_THRESHOLD);
     std::string message_prefixed = message.empty() ? "" : (": " + message);
@@ -1441,54 +1453,43 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                     }
                 }
 
+                // VELES BEGIN
+                // Masternode, payment and governance messages are serialized once and shared by all the
+                // peers asking for them, the subsystem locks are only held to look them up
                 if (!pushed && inv.type == MSG_MASTERNODE_PAYMENT_VOTE) {
-                    if(mnpayments.HasVerifiedPaymentVote(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnpayments.mapMasternodePaymentVotes[inv.hash];
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, ss));
+                    CSharedNetMsgRef message = mnpayments.GetPaymentVoteMessage(inv.hash);
+                    if (message) {
+                        connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_MASTERNODE_PAYMENT_BLOCK) {
                     BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                    LOCK(cs_mapMasternodeBlocks);
-                    if (mi != mapBlockIndex.end() && mnpayments.mapMasternodeBlocks.count(mi->second->nHeight)) {
-                        for (CMasternodePayee& payee : mnpayments.mapMasternodeBlocks[mi->second->nHeight].vecPayees) {
-                            std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
-                            for (uint256& hash : vecVoteHashes) {
-                                if(mnpayments.HasVerifiedPaymentVote(hash)) {
-                                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                                    ss.reserve(1000);
-                                    ss << mnpayments.mapMasternodePaymentVotes[hash];
-                                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MASTERNODEPAYMENTVOTE, ss));
-                                }
-                            }
-                        }
+                    std::vector<CSharedNetMsgRef> vMessages;
+                    if (mi != mapBlockIndex.end() && mnpayments.GetPaymentBlockMessages(mi->second->nHeight, vMessages)) {
+                        for (const CSharedNetMsgRef& message : vMessages)
+                            connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_MASTERNODE_ANNOUNCE) {
-                    if(mnodeman.mapSeenMasternodeBroadcast.count(inv.hash)){
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodeBroadcast[inv.hash].second;
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNANNOUNCE, ss));
+                    CSharedNetMsgRef message = mnodeman.GetMasternodeBroadcastMessage(inv.hash);
+                    if (message) {
+                        connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_MASTERNODE_PING) {
-                    if(mnodeman.mapSeenMasternodePing.count(inv.hash)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << mnodeman.mapSeenMasternodePing[inv.hash];
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, ss));
+                    CSharedNetMsgRef message = mnodeman.GetMasternodePingMessage(inv.hash);
+                    if (message) {
+                        connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
+                // VELES END
 
                 if (!pushed && inv.type == MSG_DSTX) {
                     CDarksendBroadcastTx dstx = CPrivateSend::GetDSTX(inv.hash);
@@ -1501,42 +1502,26 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                     }
                 }
 
+                // VELES BEGIN
                 if (!pushed && inv.type == MSG_GOVERNANCE_OBJECT) {
                     LogPrint(BCLog::NET, "ProcessGetData -- MSG_GOVERNANCE_OBJECT: inv = %s\n", inv.ToString());
-                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                    bool topush = false;
-                    {
-                        if(governance.HaveObjectForHash(inv.hash)) {
-                            ss.reserve(1000);
-                            if(governance.SerializeObjectForHash(inv.hash, ss)) {
-                                topush = true;
-                            }
-                        }
-                    }
-                    LogPrint(BCLog::NET, "ProcessGetData -- MSG_GOVERNANCE_OBJECT: topush = %d, inv = %s\n", topush, inv.ToString());
-                    if(topush) {
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCEOBJECT, ss));
+                    CSharedNetMsgRef message = governance.GetObjectMessage(inv.hash);
+                    LogPrint(BCLog::NET, "ProcessGetData -- MSG_GOVERNANCE_OBJECT: topush = %d, inv = %s\n", message != nullptr, inv.ToString());
+                    if (message) {
+                        connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
 
                 if (!pushed && inv.type == MSG_GOVERNANCE_OBJECT_VOTE) {
-                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                    bool topush = false;
-                    {
-                        if(governance.HaveVoteForHash(inv.hash)) {
-                            ss.reserve(1000);
-                            if(governance.SerializeVoteForHash(inv.hash, ss)) {
-                                topush = true;
-                            }
-                        }
-                    }
-                    if(topush) {
+                    CSharedNetMsgRef message = governance.GetVoteMessage(inv.hash);
+                    if (message) {
                         LogPrint(BCLog::NET, "ProcessGetData -- pushing: inv = %s\n", inv.ToString());
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::MNGOVERNANCEOBJECTVOTE, ss));
+                        connman->PushMessage(pfrom, message);
                         pushed = true;
                     }
                 }
+                // VELES END
 
                 if (!pushed && inv.type == MSG_MASTERNODE_VERIFY) {
                     if(mnodeman.mapSeenMasternodeVerification.count(inv.hash)) {
@@ -1824,7 +1809,102 @@ bool static ProcessHeadersMessage(CNode *pfrom, CConnman *connman, const std::ve
     return true;
 }
 
-bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
+// VELES BEGIN
+typedef std::function<void(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)> NetMessageHandler;
+
+/** Handlers of the masternode subsystem messages, indexed by message type id */
+class CNetMessageDispatcher
+{
+private:
+    std::vector<NetMessageHandler> vHandlers;
+    std::vector<MasternodeMessagePriority> vPriorities;
+
+public:
+    CNetMessageDispatcher() : vHandlers(getAllNetMessageTypes().size()), vPriorities(getAllNetMessageTypes().size(), MNMSG_PRIORITY_COUNT) {}
+
+    void Register(const char* pszCommand, MasternodeMessagePriority nPriority, NetMessageHandler handler)
+    {
+        int nCommandId = GetNetMessageTypeId(pszCommand);
+        assert(nCommandId != NET_MESSAGE_TYPE_UNKNOWN && !vHandlers[nCommandId]);
+        vHandlers[nCommandId] = std::move(handler);
+        vPriorities[nCommandId] = nPriority;
+    }
+
+    /** Queue of the masternode message threads serving a registered message type */
+    MasternodeMessagePriority GetPriority(int nCommandId) const { return vPriorities[nCommandId]; }
+
+    /** The handler registered for a message type, nullptr if it is not a masternode subsystem message */
+    const NetMessageHandler* Find(int nCommandId) const
+    {
+        if (nCommandId == NET_MESSAGE_TYPE_UNKNOWN || !vHandlers[nCommandId])
+            return nullptr;
+        return &vHandlers[nCommandId];
+    }
+};
+
+static const CNetMessageDispatcher& GetMasternodeMessageDispatcher()
+{
+    static const CNetMessageDispatcher dispatcher = [] {
+        CNetMessageDispatcher d;
+        auto mnodemanHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            mnodeman.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        };
+        auto mnpaymentsHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        };
+        auto governanceHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            governance.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        };
+        auto sporkHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
+        };
+        auto privateSendServerHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        };
+        auto privateSendClientHandler = [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+#ifdef ENABLE_WALLET
+            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, connman);
+#endif // ENABLE_WALLET
+        };
+
+        d.Register(NetMsgType::MNANNOUNCE, MNMSG_PRIORITY_MASTERNODE, mnodemanHandler);
+        d.Register(NetMsgType::MNPING, MNMSG_PRIORITY_MASTERNODE, mnodemanHandler);
+        d.Register(NetMsgType::DSEG, MNMSG_PRIORITY_MASTERNODE, mnodemanHandler);
+        d.Register(NetMsgType::MNVERIFY, MNMSG_PRIORITY_MASTERNODE, mnodemanHandler);
+        d.Register(NetMsgType::MASTERNODEPAYMENTSYNC, MNMSG_PRIORITY_MASTERNODE, mnpaymentsHandler);
+        d.Register(NetMsgType::MASTERNODEPAYMENTVOTE, MNMSG_PRIORITY_MASTERNODE, mnpaymentsHandler);
+        d.Register(NetMsgType::MNGOVERNANCESYNC, MNMSG_PRIORITY_GOVERNANCE, governanceHandler);
+        d.Register(NetMsgType::MNGOVERNANCEOBJECT, MNMSG_PRIORITY_GOVERNANCE, governanceHandler);
+        d.Register(NetMsgType::MNGOVERNANCEOBJECTVOTE, MNMSG_PRIORITY_GOVERNANCE, governanceHandler);
+        d.Register(NetMsgType::SPORK, MNMSG_PRIORITY_MASTERNODE, sporkHandler);
+        d.Register(NetMsgType::GETSPORKS, MNMSG_PRIORITY_MASTERNODE, sporkHandler);
+        d.Register(NetMsgType::TXLOCKVOTE, MNMSG_PRIORITY_INSTANTSEND, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
+        });
+        d.Register(NetMsgType::SYNCSTATUSCOUNT, MNMSG_PRIORITY_MASTERNODE, [](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+        });
+        // PrivateSend sessions are as time critical as InstantSend locks
+        d.Register(NetMsgType::DSACCEPT, MNMSG_PRIORITY_INSTANTSEND, privateSendServerHandler);
+        d.Register(NetMsgType::DSVIN, MNMSG_PRIORITY_INSTANTSEND, privateSendServerHandler);
+        d.Register(NetMsgType::DSSIGNFINALTX, MNMSG_PRIORITY_INSTANTSEND, privateSendServerHandler);
+        d.Register(NetMsgType::DSSTATUSUPDATE, MNMSG_PRIORITY_INSTANTSEND, privateSendClientHandler);
+        d.Register(NetMsgType::DSFINALTX, MNMSG_PRIORITY_INSTANTSEND, privateSendClientHandler);
+        d.Register(NetMsgType::DSCOMPLETE, MNMSG_PRIORITY_INSTANTSEND, privateSendClientHandler);
+        // Queue announcements go to the masternode or to the mixing client, whichever this node runs
+        d.Register(NetMsgType::DSQUEUE, MNMSG_PRIORITY_INSTANTSEND, [privateSendServerHandler, privateSendClientHandler](CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman) {
+            if (fMasterNode)
+                privateSendServerHandler(pfrom, strCommand, vRecv, connman);
+            else
+                privateSendClientHandler(pfrom, strCommand, vRecv, connman);
+        });
+        return d;
+    }();
+    return dispatcher;
+}
+// VELES END
+
+bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, int nCommandId, CDataStream& vRecv, int64_t nTimeReceived, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc, bool enable_bip61)
 {
     LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
     if (gArgs.IsArgSet("-dropmessagestest") && GetRand(gArgs.GetArg("-dropmessagestest", 0)) == 0)
@@ -2113,6 +2193,13 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         return false;
     }
 
+    // VELES BEGIN
+    else if (const NetMessageHandler* pHandler = GetMasternodeMessageDispatcher().Find(nCommandId))
+    {
+        (*pHandler)(pfrom, strCommand, vRecv, *connman);
+    }
+    // VELES END
+
     else if (strCommand == NetMsgType::ADDR)
     {
         std::vector<CAddress> vAddr;
@@ -2922,7 +3009,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         } // cs_main
 
         if (fProcessBLOCKTXN)
-            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, blockTxnMsg, nTimeReceived, chainparams, connman, interruptMsgProc, enable_bip61);
+            return ProcessMessage(pfrom, NetMsgType::BLOCKTXN, GetNetMessageTypeId(NetMsgType::BLOCKTXN), blockTxnMsg, nTimeReceived, chainparams, connman, interruptMsgProc, enable_bip61);
 
         if (fRevertToHeaderProcessing) {
             // Headers received from HB compact block peers are permitted to be
@@ -3298,40 +3385,10 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         // message would be undesirable as we transmit it ourselves.
     }
     else
-    {
-        // Dash
-        bool found = false;
-        const std::vector<std::string> &allMessages = getAllNetMessageTypes();
-        for (const std::string msg : allMessages) {
-            if(msg == strCommand) {
-                found = true;
-                break;
-            }
-        }
-
-        if (found)
-        {
-            //probably one the extensions
-#ifdef ENABLE_WALLET
-            privateSendClient.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-#endif // ENABLE_WALLET
-            privateSendServer.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-            mnodeman.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-            mnpayments.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-            instantsend.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-            sporkManager.ProcessSpork(pfrom, strCommand, vRecv, *connman);
-            masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
-            governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
-        }
-        //
-    else
     {
         // Ignore unknown commands for extensibility
         LogPrint(BCLog::NET, "Unknown command \"%s\" from peer=%d\n", SanitizeString(strCommand), pfrom->GetId());
     }
-    // Dash
-    }
-    //
 
     return true;
 }
@@ -3368,6 +3425,81 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman, bool en
     return false;
 }
 
+// VELES BEGIN
+/** How many queued messages to look through for masternode signatures to check ahead */
+static const size_t MAX_SIGNATURE_LOOKAHEAD = 256;
+
+static bool IsMasternodeSignedMessage(const std::string& strCommand)
+{
+    return strCommand == NetMsgType::MNANNOUNCE || strCommand == NetMsgType::MNPING ||
+            strCommand == NetMsgType::TXLOCKVOTE || strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE;
+}
+
+static void AddMasternodeSignatureChecks(const std::string& strCommand, CDataStream& vRecv, std::vector<CHashSignatureCheck>& vChecks)
+{
+    CHashSignatureCheck check;
+    if (strCommand == NetMsgType::MNANNOUNCE) {
+        CMasternodeBroadcast mnb;
+        vRecv >> mnb;
+        vChecks.push_back(mnb.GetSignatureCheck());
+        vChecks.push_back(mnb.lastPing.GetSignatureCheck(mnb.pubKeyMasternode));
+    } else if (strCommand == NetMsgType::MNPING) {
+        CMasternodePing mnp;
+        vRecv >> mnp;
+        masternode_info_t infoMn;
+        if (mnodeman.GetMasternodeInfo(mnp.vin.prevout, infoMn))
+            vChecks.push_back(mnp.GetSignatureCheck(infoMn.pubKeyMasternode));
+    } else if (strCommand == NetMsgType::TXLOCKVOTE) {
+        CTxLockVote vote;
+        vRecv >> vote;
+        if (vote.GetSignatureCheck(check))
+            vChecks.push_back(check);
+    } else if (strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE) {
+        CGovernanceVote vote;
+        vRecv >> vote;
+        if (vote.GetSignatureCheck(check))
+            vChecks.push_back(check);
+    }
+}
+
+/**
+ * Check the signatures of the masternode messages queued from this peer on
+ * the signature check threads. The messages are still processed one by one in
+ * the order they arrived, they just find their signatures already verified.
+ */
+static void PreVerifyMasternodeSignatures(CNode* pfrom, const CNetMessage& msg)
+{
+    if (!nScriptCheckThreads || fLiteMode || !masternodeSync.IsBlockchainSynced())
+        return;
+
+    std::vector<std::pair<std::string, CDataStream> > vMessages;
+    vMessages.emplace_back(msg.hdr.GetCommand(), msg.vRecv);
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        for (const CNetMessage& msgQueued : pfrom->vProcessMsg) {
+            if (pfrom->nPreVerifiedMsgs == MAX_SIGNATURE_LOOKAHEAD)
+                break;
+            ++pfrom->nPreVerifiedMsgs;
+            std::string strCommand = msgQueued.hdr.GetCommand();
+            if (IsMasternodeSignedMessage(strCommand))
+                vMessages.emplace_back(strCommand, msgQueued.vRecv);
+        }
+    }
+
+    std::vector<CHashSignatureCheck> vChecks;
+    for (auto& pairMessage : vMessages) {
+        pairMessage.second.SetVersion(pfrom->GetRecvVersion());
+        try {
+            AddMasternodeSignatureChecks(pairMessage.first, pairMessage.second, vChecks);
+        } catch (const std::exception&) {
+            // malformed messages are dealt with when they are processed
+        }
+    }
+    if (vChecks.size() > 1)
+        PreVerifyHashSignatures(vChecks);
+}
+// VELES END
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3395,6 +3527,9 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return false;
 
     std::list<CNetMessage> msgs;
+    // VELES BEGIN
+    bool fPreVerified = false;
+    // VELES END
     {
         LOCK(pfrom->cs_vProcessMsg);
         if (pfrom->vProcessMsg.empty())
@@ -3404,6 +3539,11 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
         pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
         fMoreWork = !pfrom->vProcessMsg.empty();
+        // VELES BEGIN
+        fPreVerified = pfrom->nPreVerifiedMsgs > 0;
+        if (fPreVerified)
+            --pfrom->nPreVerifiedMsgs;
+        // VELES END
     }
     CNetMessage& msg(msgs.front());
 
@@ -3439,11 +3579,26 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
         return fMoreWork;
     }
 
+    // VELES BEGIN
+    // Leave the masternode subsystems to their own threads once the peer is past the handshake,
+    // signatures included, so they never hold up this thread
+    if (pfrom->fSuccessfullyConnected && connman->HasMasternodeMessageThreads()) {
+        const CNetMessageDispatcher& dispatcher = GetMasternodeMessageDispatcher();
+        if (dispatcher.Find(msg.nCommandId)) {
+            connman->PushMasternodeMessage(pfrom, msgs, dispatcher.GetPriority(msg.nCommandId));
+            return fMoreWork;
+        }
+    }
+
+    if (!fPreVerified && IsMasternodeSignedMessage(strCommand))
+        PreVerifyMasternodeSignatures(pfrom, msg);
+    // VELES END
+
     // Process message
     bool fRet = false;
     try
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
+        fRet = ProcessMessage(pfrom, strCommand, msg.nCommandId, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
         if (interruptMsgProc)
             return false;
         if (!pfrom->vRecvGetData.empty())
@@ -3490,6 +3645,36 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     return fMoreWork;
 }
 
+// VELES BEGIN
+void PeerLogicValidation::ProcessMasternodeMessage(CNode* pfrom, CNetMessage& msg, std::atomic<bool>& interruptMsgProc)
+{
+    const std::string strCommand = msg.hdr.GetCommand();
+    const NetMessageHandler* pHandler = GetMasternodeMessageDispatcher().Find(msg.nCommandId);
+    assert(pHandler);
+
+    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), msg.vRecv.size(), pfrom->GetId());
+    const uint64_t nMisbehavingCallsBefore = nMisbehavingCalls;
+    try {
+        (*pHandler)(pfrom, strCommand, msg.vRecv, *connman);
+    } catch (const std::ios_base::failure& e) {
+        if (m_enable_bip61) {
+            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+        }
+        LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), msg.hdr.nMessageSize, e.what());
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMasternodeMessage()");
+    } catch (...) {
+        PrintExceptionContinue(nullptr, "ProcessMasternodeMessage()");
+    }
+
+    // Masternode handlers queue no rejects, only a peer they scored may need banning
+    if (nMisbehavingCalls != nMisbehavingCallsBefore) {
+        LOCK(cs_main);
+        SendRejectsAndCheckIfBanned(pfrom, connman, m_enable_bip61);
+    }
+}
+// VELES END
+
 void PeerLogicValidation::ConsiderEviction(CNode *pto, int64_t time_in_seconds)
 {
     AssertLockHeld(cs_main);
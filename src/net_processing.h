@@ -66,6 +66,16 @@ public:
     * @param[in]   interrupt       Interrupt condition for processing threads
     */
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override;
+    // VELES BEGIN
+    /**
+    * Process a masternode subsystem message on a masternode message thread
+    *
+    * @param[in]   pfrom           The node which we have received the message from.
+    * @param[in]   msg             The message, already checked by ProcessMessages.
+    * @param[in]   interrupt       Interrupt condition for processing threads
+    */
+    void ProcessMasternodeMessage(CNode* pfrom, CNetMessage& msg, std::atomic<bool>& interrupt) override;
+    // VELES END
     /**
     * Send queued protocol messages to be sent to a give node.
     *
@@ -37,6 +37,17 @@ public:
         READWRITE(mapFulfilledRequests);
     }
 
+    // VELES BEGIN
+    /** CJournalDB support: the requests expire within the hour, store them whole */
+    template <typename Stream, typename Operation>
+    inline void JournalBaseOp(Stream& s, Operation ser_action) {
+        SerializationOp(s, ser_action);
+    }
+
+    template <typename Journal>
+    void JournalMapsOp(Journal& journal) {}
+    // VELES END
+
     void AddFulfilledRequest(CAddress addr, std::string strRequest); // expire after 1 hour by default
     bool HasFulfilledRequest(CAddress addr, std::string strRequest);
     void RemoveFulfilledRequest(CAddress addr, std::string strRequest);
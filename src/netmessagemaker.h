@@ -33,4 +33,16 @@ private:
     const int nVersion;
 };
 
+// VELES BEGIN
+/** Serialize a relayed object once, for pushing to every peer that asks for it */
+template <typename T>
+CSharedNetMsgRef MakeSharedNetMsg(const std::string& sCommand, const T& obj)
+{
+    // Some masternode objects look at the stream size, which only CDataStream has
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    return std::make_shared<const CSharedNetMsg>(sCommand, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+// VELES END
+
 #endif // FXTC_NETMESSAGEMAKER_H
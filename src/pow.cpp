@@ -12,7 +12,21 @@
 #include <arith_uint256.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <uint256.h>
+// VELES BEGIN
+#include <crypto/sha256.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util.h>
+
+#include <atomic>
+
+#include <boost/thread.hpp>
+// VELES END
+
+#include <map>
 
 // VELES BEGIN
 unsigned int static DarkGravityWaveVLS(const CBlockIndex* pindexLast, const Consensus::Params& params) {
@@ -173,10 +187,16 @@ unsigned int GetNextWorkRequiredVLS(const CBlockIndex* pindexLast, const CBlockH
 }
 // VELES END
 
-unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params) {
-    if (params.fPowNoRetargeting)
-        return pindexLast->nBits;
-
+// VELES BEGIN
+/** Normalized DarkGravityWave targets by (previous block hash, algo). They only
+ *  depend on the ancestors of the previous block, so entries never go stale. */
+static CCriticalSection cs_dgwcache;
+static std::map<std::pair<uint256, int32_t>, arith_uint256> mapDarkGravityWaveCache GUARDED_BY(cs_dgwcache);
+static const size_t DGW_CACHE_MAX_SIZE = 8192;
+
+/** Average normalized target of the chain and of nAlgo before pindexLast,
+ *  retargeted by their timespans. Returns false if the chain is too short. */
+static bool DarkGravityWaveTarget(const CBlockIndex* pindexLast, int32_t nAlgo, const Consensus::Params& params, arith_uint256& bnNew) {
     const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
 
     const int64_t nPastAlgoFastBlocks = 5; // fast average for algo
@@ -192,15 +212,13 @@ unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const CBlockH
     // make sure we have at least ALGO_ACTIVE_COUNT blocks, otherwise just return powLimit
     if (!pindexLast || pindexLast->nHeight < nPastBlocks) {
         if (pindexLast->nHeight < nPastAlgoBlocks)
-            return bnPowLimit.GetCompact();
+            return false;
         else
             nPastBlocks = pindexLast->nHeight;
     }
 
     const CBlockIndex *pindex = pindexLast;
     const CBlockIndex *pindexFast = pindexLast;
-    arith_uint256 bnPastTargetAvg(0);
-    arith_uint256 bnPastTargetAvgFast(0);
 
     const CBlockIndex *pindexAlgo = nullptr;
     const CBlockIndex *pindexAlgoFast = nullptr;
@@ -208,66 +226,55 @@ unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const CBlockH
     arith_uint256 bnPastAlgoTargetAvg(0);
     arith_uint256 bnPastAlgoTargetAvgFast(0);
 
-    // count blocks mined by actual algo for secondary average
-    int32_t nVersion = pblock->nVersion & ALGO_VERSION_MASK;
-
     unsigned int nCountBlocks = 0;
     unsigned int nCountFastBlocks = 0;
     unsigned int nCountAlgoBlocks = 0;
     unsigned int nCountAlgoFastBlocks = 0;
 
-    while (nCountBlocks < nPastBlocks && nCountAlgoBlocks < nPastAlgoBlocks) {
-        arith_uint256 bnTarget = arith_uint256().SetCompact(pindex->nBits) / pindex->GetBlockHeader().GetAlgoEfficiency(pindex->nHeight); // convert to normalized target by algo efficiency
-
-        // calculate algo average
-        if (nVersion == (pindex->nVersion & ALGO_VERSION_MASK))
-        {
-            nCountAlgoBlocks++;
+    // Only the blocks mined by actual algo are averaged; the chain average of
+    // all blocks in the window never ends up in the result, so blocks of other
+    // algos are skipped along the algo chain
+    for (const CBlockIndex *pindexWalk = pindexLast->GetLastAlgoAncestor(nAlgo, pindexLast->nHeight - nPastBlocks + 1);
+         pindexWalk && pindexLast->nHeight - pindexWalk->nHeight < nPastBlocks && nCountAlgoBlocks < nPastAlgoBlocks;
+         pindexWalk = pindexWalk->GetPrevAlgo()) {
+        arith_uint256 bnTarget = arith_uint256().SetCompact(pindexWalk->nBits) / pindexWalk->GetBlockHeader().GetAlgoEfficiency(pindexWalk->nHeight); // convert to normalized target by algo efficiency
 
-            pindexAlgo = pindex;
-            if (!pindexAlgoLast)
-                pindexAlgoLast = pindex;
-
-            // algo average
-            bnPastAlgoTargetAvg = (bnPastAlgoTargetAvg * (nCountAlgoBlocks - 1) + bnTarget) / nCountAlgoBlocks;
-            // fast algo average
-            if (nCountAlgoBlocks <= nPastAlgoFastBlocks)
-            {
-                nCountAlgoFastBlocks++;
-                pindexAlgoFast = pindex;
-                bnPastAlgoTargetAvgFast = bnPastAlgoTargetAvg;
-            }
-        }
+        nCountAlgoBlocks++;
 
-        nCountBlocks++;
+        pindexAlgo = pindexWalk;
+        if (!pindexAlgoLast)
+            pindexAlgoLast = pindexWalk;
 
-        // average
-        bnPastTargetAvg = (bnPastTargetAvg * (nCountBlocks - 1) + bnTarget) / nCountBlocks;
-        // fast average
-        if (nCountBlocks <= nPastFastBlocks)
+        // algo average
+        bnPastAlgoTargetAvg = (bnPastAlgoTargetAvg * (nCountAlgoBlocks - 1) + bnTarget) / nCountAlgoBlocks;
+        // fast algo average
+        if (nCountAlgoBlocks <= nPastAlgoFastBlocks)
         {
-            nCountFastBlocks++;
-            pindexFast = pindex;
-            bnPastTargetAvgFast = bnPastTargetAvg;
-        }
-
-        // next block
-        if(nCountBlocks != nPastBlocks) {
-            assert(pindex->pprev); // should never fail
-            pindex = pindex->pprev;
+            nCountAlgoFastBlocks++;
+            pindexAlgoFast = pindexWalk;
+            bnPastAlgoTargetAvgFast = bnPastAlgoTargetAvg;
         }
     }
 
+    // The chain window ends at the oldest algo block averaged, or spans
+    // nPastBlocks; it is left at the block before its last one unless full
+    if (nCountAlgoBlocks == nPastAlgoBlocks)
+        nCountBlocks = pindexLast->nHeight - pindexAlgo->nHeight + 1;
+    else
+        nCountBlocks = nPastBlocks;
+    pindex = pindexLast->GetAncestor(pindexLast->nHeight - (int)nCountBlocks + (nCountBlocks == nPastBlocks ? 1 : 0));
+
+    // fast average
+    nCountFastBlocks = std::min<unsigned int>(nCountBlocks, nPastFastBlocks);
+    pindexFast = pindexLast->GetAncestor(pindexLast->nHeight - (int)nCountFastBlocks + 1);
+
     // FXTC instamine protection for blockchain
     if (pindexLast->GetBlockTime() - pindexFast->GetBlockTime() < params.nPowTargetSpacing / 2)
     {
         nCountBlocks = nCountFastBlocks;
         pindex = pindexFast;
-        bnPastTargetAvg = bnPastTargetAvgFast;
     }
 
-    arith_uint256 bnNew(bnPastTargetAvg);
-
     if (pindexAlgo && pindexAlgoLast && nCountAlgoBlocks > 1)
     {
         // FXTC instamine protection for algo
@@ -312,6 +319,48 @@ unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const CBlockH
     bnNew *= nActualTimespan;
     bnNew /= nTargetTimespan;
 
+    return true;
+}
+
+/** Cached wrapper around DarkGravityWaveTarget() */
+static bool GetDarkGravityWaveTarget(const CBlockIndex* pindexLast, int32_t nAlgo, const Consensus::Params& params, arith_uint256& bnNew) {
+    // index entries built by hand (unit tests) have no hash to key on
+    if (pindexLast->phashBlock == nullptr)
+        return DarkGravityWaveTarget(pindexLast, nAlgo, params, bnNew);
+
+    const std::pair<uint256, int32_t> key(pindexLast->GetBlockHash(), nAlgo);
+    {
+        LOCK(cs_dgwcache);
+        auto it = mapDarkGravityWaveCache.find(key);
+        if (it != mapDarkGravityWaveCache.end()) {
+            bnNew = it->second;
+            return true;
+        }
+    }
+
+    if (!DarkGravityWaveTarget(pindexLast, nAlgo, params, bnNew))
+        return false;
+
+    LOCK(cs_dgwcache);
+    if (mapDarkGravityWaveCache.size() >= DGW_CACHE_MAX_SIZE)
+        mapDarkGravityWaveCache.clear();
+    mapDarkGravityWaveCache.emplace(key, bnNew);
+    return true;
+}
+// VELES END
+
+unsigned int static DarkGravityWave(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params) {
+    if (params.fPowNoRetargeting)
+        return pindexLast->nBits;
+
+    const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
+
+    // VELES BEGIN
+    arith_uint256 bnNew;
+    if (!GetDarkGravityWaveTarget(pindexLast, pblock->nVersion & ALGO_VERSION_MASK, params, bnNew))
+        return bnPowLimit.GetCompact();
+    // VELES END
+
     // at least PoW limit
     if ((bnPowLimit / pblock->GetAlgoEfficiency(pindexLast->nHeight+1)) > bnNew)
         bnNew *= pblock->GetAlgoEfficiency(pindexLast->nHeight+1); // convert normalized target to actual algo target
@@ -440,6 +489,96 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
     return true;
 }
 
+// VELES BEGIN
+namespace {
+/**
+ * Headers that passed their proof of work check, to avoid computing the
+ * hashes of memory-hard algos again when the same header is checked by
+ * header sync, block validation and ReadBlockFromDisk
+ */
+class CPoWCache
+{
+private:
+    //! Entries are SHA256(nonce || block hash || pow limit); the block hash commits to nBits
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_powcache;
+    //! Nothing is cached until the cache has been set up
+    std::atomic<bool> fSetup;
+
+public:
+    CPoWCache() : fSetup(false) {}
+
+    uint32_t setup_bytes(size_t n)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_powcache);
+        GetRandBytes(nonce.begin(), 32);
+        uint32_t nElems = setValid.setup_bytes(n);
+        fSetup = true;
+        return nElems;
+    }
+
+    bool IsSetup() const
+    {
+        return fSetup;
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hashBlock, const uint256& powLimit)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hashBlock.begin(), 32).Write(powLimit.begin(), 32).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_powcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_powcache);
+        setValid.insert(entry);
+    }
+};
+
+static CPoWCache powCache;
+} // namespace
+
+void InitPoWCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxpowcachesize", DEFAULT_MAX_POW_CACHE_SIZE)), MAX_MAX_POW_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = powCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for proof of work cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+bool CheckBlockHeaderProofOfWork(const CBlockHeader& header, const Consensus::Params& params, const uint256* pPoWHash)
+{
+    if (!powCache.IsSetup())
+        return CheckProofOfWork(pPoWHash ? *pPoWHash : header.GetPoWHash(), header.nBits, params);
+
+    uint256 entry;
+    powCache.ComputeEntry(entry, header.GetHash(), params.powLimit);
+    if (powCache.Get(entry))
+        return true;
+    if (!CheckProofOfWork(pPoWHash ? *pPoWHash : header.GetPoWHash(), header.nBits, params))
+        return false;
+    powCache.Set(entry);
+    return true;
+}
+
+void CacheBlockHeaderProofOfWork(const CBlockHeader& header, const Consensus::Params& params)
+{
+    if (!powCache.IsSetup())
+        return;
+
+    uint256 entry;
+    powCache.ComputeEntry(entry, header.GetHash(), params.powLimit);
+    powCache.Set(entry);
+}
+// VELES END
+
 // FXTC BEGIN
 unsigned int GetHandbrakeForce(int32_t nVersion, int nHeight)
 {
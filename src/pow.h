@@ -32,6 +32,24 @@ unsigned int CalculateNextWorkRequired(const CBlockIndex* pindexLast, int64_t nF
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
 
+// VELES BEGIN
+/** Default for -maxpowcachesize, the size in MiB of the cache of headers that passed their proof of work check */
+static const int64_t DEFAULT_MAX_POW_CACHE_SIZE = 8;
+/** Maximum for -maxpowcachesize */
+static const int64_t MAX_MAX_POW_CACHE_SIZE = 16384;
+
+/** To be called once in AppInitMain/BasicTestingSetup, before any header is checked, to set up the cache */
+void InitPoWCache();
+
+/**
+ * Check the proof of work of a header, computing its hash (unless given in
+ * pPoWHash) only if the header has not passed the check before in this process
+ */
+bool CheckBlockHeaderProofOfWork(const CBlockHeader& header, const Consensus::Params& params, const uint256* pPoWHash = nullptr);
+/** Remember that a header passed its proof of work check */
+void CacheBlockHeaderProofOfWork(const CBlockHeader& header, const Consensus::Params& params);
+// VELES END
+
 // FXTC BEGIN
 unsigned int GetHandbrakeForce(int32_t nVersion, int nHeight);
 // FXTC END
@@ -55,6 +55,30 @@ uint256 CBlockHeader::GetPoWHash() const
     return powHash;
 }
 
+// VELES BEGIN
+void GetBlockHeaderPoWHashes(const CBlockHeader* pheaders, size_t nCount, uint256* phashes)
+{
+    std::vector<size_t> vScrypt;
+    std::vector<char> vInput;
+    for (size_t i = 0; i < nCount; i++) {
+        const CBlockHeader& header = pheaders[i];
+        if ((header.nVersion & VERSIONBITS_TOP_MASK) != VERSIONBITS_TOP_BITS || (header.nVersion & ALGO_VERSION_MASK) == ALGO_SCRYPT) {
+            vScrypt.push_back(i);
+            vInput.insert(vInput.end(), BEGIN(header.nVersion), END(header.nNonce));
+        } else {
+            phashes[i] = header.GetPoWHash();
+        }
+    }
+    if (vScrypt.empty())
+        return;
+
+    std::vector<uint256> vOutput(vScrypt.size());
+    scrypt_1024_1_1_256_multi(vInput.data(), BEGIN(vOutput[0]), vScrypt.size());
+    for (size_t i = 0; i < vScrypt.size(); i++)
+        phashes[vScrypt[i]] = vOutput[i];
+}
+// VELES END
+
 // FXTC BEGIN
 unsigned int CBlockHeader::GetAlgoEfficiency(int nBlockHeight) const
 {
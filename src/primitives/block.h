@@ -97,6 +97,13 @@ public:
     }
 };
 
+// VELES BEGIN
+/** Compute the proof of work hashes of nCount consecutive headers. Headers
+ *  hashed with scrypt are computed several at a time when a multi-lane
+ *  implementation was detected. */
+void GetBlockHeaderPoWHashes(const CBlockHeader* pheaders, size_t nCount, uint256* phashes);
+// VELES END
+
 
 class CBlock : public CBlockHeader
 {
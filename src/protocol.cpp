@@ -10,6 +10,10 @@
 #include <util.h>
 #include <utilstrencodings.h>
 
+// VELES BEGIN
+#include <unordered_map>
+// VELES END
+
 #ifndef WIN32
 # include <arpa/inet.h>
 #endif
@@ -267,3 +271,18 @@ const std::vector<std::string> &getAllNetMessageTypes()
 {
     return allNetMessageTypesVec;
 }
+
+// VELES BEGIN
+int GetNetMessageTypeId(const std::string& strCommand)
+{
+    static const std::unordered_map<std::string, int> mapNetMessageTypeIds = [] {
+        std::unordered_map<std::string, int> mapIds;
+        for (size_t i = 0; i < allNetMessageTypesVec.size(); i++)
+            mapIds.emplace(allNetMessageTypesVec[i], i);
+        return mapIds;
+    }();
+
+    auto it = mapNetMessageTypeIds.find(strCommand);
+    return it == mapNetMessageTypeIds.end() ? NET_MESSAGE_TYPE_UNKNOWN : it->second;
+}
+// VELES END
@@ -271,6 +271,14 @@ extern const char *MNVERIFY;
 /* Get a vector of all valid message types (see above) */
 const std::vector<std::string> &getAllNetMessageTypes();
 
+// VELES BEGIN
+/** Message type id of the commands not in getAllNetMessageTypes() */
+static const int NET_MESSAGE_TYPE_UNKNOWN = -1;
+
+/** Intern a command to its index in getAllNetMessageTypes(), or NET_MESSAGE_TYPE_UNKNOWN */
+int GetNetMessageTypeId(const std::string& strCommand);
+// VELES END
+
 /** nServices flags */
 enum ServiceFlags : uint64_t {
     // Nothing
@@ -280,12 +280,14 @@ void MasternodeList::updateNodeList()
     ui->tableWidgetMasternodes->setSortingEnabled(false);
     ui->tableWidgetMasternodes->clearContents();
     ui->tableWidgetMasternodes->setRowCount(0);
-    std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
+    // VELES BEGIN
+    CMasternodeMan::list_snapshot_ptr_t pSnapshot = mnodeman.GetMasternodeListSnapshot();
+    // VELES END
     int offsetFromUtc = GetOffsetFromUtc();
 
-    for(auto& mnpair : mapMasternodes)
+    for(const auto& mnpair : pSnapshot->mapMasternodes)
     {
-        CMasternode mn = mnpair.second;
+        const CMasternode& mn = *mnpair.second;
         // populate list
         // Address, Protocol, Status, Active Seconds, Last Seen, Pub Key
         QTableWidgetItem *addressItem = new QTableWidgetItem(QString::fromStdString(mn.addr.ToString()));
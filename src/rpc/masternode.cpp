@@ -483,6 +483,49 @@ UniValue masternode(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+// VELES BEGIN
+static CMasternodeFilter ParseMasternodeFilter(const std::string& strFilter)
+{
+    UniValue filterObj;
+    if (!filterObj.read(strFilter) || !filterObj.isObject())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Filter object is not valid JSON");
+    RPCTypeCheckObj(filterObj,
+        {
+            {"status", UniValueType(UniValue::VSTR)},
+            {"protocol", UniValueType(UniValue::VNUM)},
+            {"payee", UniValueType(UniValue::VSTR)},
+            {"addr", UniValueType(UniValue::VSTR)},
+        }, true, true);
+
+    CMasternodeFilter filter;
+    if (filterObj.exists("status")) {
+        const std::string strStatus = filterObj["status"].get_str();
+        for (int nState = CMasternode::MASTERNODE_PRE_ENABLED; nState <= CMasternode::MASTERNODE_POSE_BAN; nState++) {
+            if (CMasternode::StateToString(nState) == strStatus)
+                filter.nActiveState = nState;
+        }
+        if (filter.nActiveState == -1)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown masternode status: " + strStatus);
+    }
+    if (filterObj.exists("protocol")) {
+        filter.nProtocolVersion = filterObj["protocol"].get_int();
+    }
+    if (filterObj.exists("payee")) {
+        CTxDestination dest = DecodeDestination(filterObj["payee"].get_str());
+        const CKeyID* pkeyID = boost::get<CKeyID>(&dest);
+        if (!pkeyID)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid payee address");
+        filter.payee = *pkeyID;
+    }
+    if (filterObj.exists("addr")) {
+        const std::string strAddr = filterObj["addr"].get_str();
+        if (!Lookup(strAddr.c_str(), filter.addr, Params().GetDefaultPort(), false))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid masternode address: " + strAddr);
+    }
+    return filter;
+}
+// VELES END
+
 UniValue masternodelist(const JSONRPCRequest& request)
 {
     std::string strMode = "status";
@@ -503,7 +546,9 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 "\nArguments:\n"
                 "1. \"mode\"      (string, optional/required to use filter, defaults = status) The mode to run list in\n"
                 "2. \"filter\"    (string, optional) Filter results. Partial match by outpoint by default in all modes,\n"
-                "                                    additional matches in some modes are also available\n"
+                "                                    additional matches in some modes are also available.\n"
+                "                                    A JSON object {\"status\":\"ENABLED\",\"protocol\":n,\"payee\":\"address\",\"addr\":\"ip:port\"}\n"
+                "                                    selects masternodes matching all of the given fields exactly in all modes but rank\n"
                 "\nAvailable modes:\n"
                 "  activeseconds  - Print number of seconds masternode recognized by the network as enabled\n"
                 "                   (since latest issued \"masternode start/start-many/start-alias\")\n"
@@ -544,10 +589,17 @@ UniValue masternodelist(const JSONRPCRequest& request)
             obj.push_back(Pair(strOutpoint, s.first));
         }
     } else {
-        std::map<COutPoint, CMasternode> mapMasternodes = mnodeman.GetFullMasternodeMap();
-        for (auto& mnpair : mapMasternodes) {
-            CMasternode mn = mnpair.second;
-            std::string strOutpoint = mnpair.first.ToStringShort();
+        // VELES BEGIN
+        CMasternodeMan::list_snapshot_ptr_t pSnapshot = mnodeman.GetMasternodeListSnapshot();
+        CMasternodeFilter filter;
+        if (!strFilter.empty() && strFilter[0] == '{') {
+            filter = ParseMasternodeFilter(strFilter);
+            strFilter = "";
+        }
+        for (const CMasternode* pmn : pSnapshot->Query(filter)) {
+            const CMasternode& mn = *pmn;
+            std::string strOutpoint = mn.vin.prevout.ToStringShort();
+        // VELES END
             if (strMode == "activeseconds") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
                 obj.push_back(Pair(strOutpoint, (int64_t)(mn.lastPing.sigTime - mn.sigTime)));
@@ -564,8 +616,8 @@ UniValue masternodelist(const JSONRPCRequest& request)
                                EncodeDestination(mn.pubKeyCollateralAddress.GetID()) << " " <<
                                (int64_t)mn.lastPing.sigTime << " " << std::setw(8) <<
                                (int64_t)(mn.lastPing.sigTime - mn.sigTime) << " " << std::setw(10) <<
-                               mn.GetLastPaidTime() << " "  << std::setw(6) <<
-                               mn.GetLastPaidBlock() << " " <<
+                               mn.nTimeLastPaid << " "  << std::setw(6) <<
+                               mn.nBlockLastPaid << " " <<
                                mn.addr.ToString();
                 std::string strFull = streamFull.str();
                 if (strFilter !="" && strFull.find(strFilter) == std::string::npos &&
@@ -588,10 +640,10 @@ UniValue masternodelist(const JSONRPCRequest& request)
                 obj.push_back(Pair(strOutpoint, strInfo));
             } else if (strMode == "lastpaidblock") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, mn.GetLastPaidBlock()));
+                obj.push_back(Pair(strOutpoint, mn.nBlockLastPaid));
             } else if (strMode == "lastpaidtime") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
-                obj.push_back(Pair(strOutpoint, mn.GetLastPaidTime()));
+                obj.push_back(Pair(strOutpoint, mn.nTimeLastPaid));
             } else if (strMode == "lastseen") {
                 if (strFilter !="" && strOutpoint.find(strFilter) == std::string::npos) continue;
                 obj.push_back(Pair(strOutpoint, (int64_t)mn.lastPing.sigTime));
@@ -149,14 +149,10 @@ static UniValue getnetworkhashps(const JSONRPCRequest& request)
 // VELES BEGIN
 /* Returns last block mined by the given algo */
 static const CBlockIndex *GetLastAlgoBlock(int32_t nAlgo) {
-    CBlockIndex *pb = chainActive.Tip();
-
-    // Look up last block mined by the current algo
-    while ((pb->nVersion & ALGO_VERSION_MASK) != nAlgo && pb->pprev) {
-        pb = pb->pprev;
-    }
+    const CBlockIndex *pb = chainActive.Tip()->GetLastAlgoAncestor(nAlgo);
 
-   return pb;
+    // Genesis block if the algo has not been used yet
+    return pb ? pb : chainActive.Genesis();
 }
 
 /**
@@ -179,37 +175,36 @@ static double GetLastAlgoDifficulty(int32_t nAlgo) {
 
 /* Returns sum of rewards for blocks mined by this algo from last X blocks */
 CAmount CountAlgoBlockRewards(int32_t nAlgo, int nBlocks) {
-    CBlockIndex *pb = chainActive.Tip();
+    CBlockIndex *pindexTip = chainActive.Tip();
     CAmount nRewards = 0;
 
-    // Look up last block mined by the current algo
-    while (nBlocks && pb->pprev) {
-        if ((pb->nVersion & ALGO_VERSION_MASK) == nAlgo)
-            nRewards += GetBlockSubsidy(pb->nHeight, pb->GetBlockHeader(), Params().GetConsensus(), false);
-        pb = pb->pprev;
-        nBlocks--;
-    }
+    // Walk the blocks mined by the algo only, the genesis block is never counted
+    int nStartHeight = std::max(pindexTip->nHeight - nBlocks + 1, 1);
+    for (const CBlockIndex *pb = pindexTip->GetLastAlgoAncestor(nAlgo, nStartHeight); pb && pb->nHeight >= nStartHeight; pb = pb->GetPrevAlgo())
+        nRewards += GetBlockSubsidy(pb->nHeight, pb->GetBlockHeader(), Params().GetConsensus(), false);
 
    return nRewards;
 }
 
 /* Returns number of blocks mined by the given algo from last X blocks */
 int CountAlgoBlocks(int32_t nAlgo, int nBlocks) {
-    CBlockIndex *pb = chainActive.Tip();
-    int nAlgoBlocks = 0;
-
-    // Look up last block mined by the current algo
-    while (nBlocks && pb->pprev) {
-        if ((pb->nVersion & ALGO_VERSION_MASK) == nAlgo)
-            nAlgoBlocks++;
-        pb = pb->pprev;
-        nBlocks--;
-    }
+    CBlockIndex *pindexTip = chainActive.Tip();
 
-   return nAlgoBlocks;
+    // Walk the blocks mined by the algo only, the genesis block is never counted
+    int nStartHeight = std::max(pindexTip->nHeight - nBlocks + 1, 1);
+    int nCount = 0;
+    for (const CBlockIndex *pb = pindexTip->GetLastAlgoAncestor(nAlgo, nStartHeight); pb && pb->nHeight >= nStartHeight; pb = pb->GetPrevAlgo())
+        nCount++;
+
+   return nCount;
 }
 // VELES END
 
+// VELES BEGIN
+/** Largest number of nonces generateBlocks hashes at once */
+static const uint64_t MAX_GENERATE_BATCH_SIZE = 1024;
+// VELES END
+
 UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGenerate, uint64_t nMaxTries, bool keepScript)
 {
     static const int nInnerLoopCount = 0x10000;
@@ -233,10 +228,34 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetPoWHash(), pblock->nBits, Params().GetConsensus())) {
-            ++pblock->nNonce;
-            --nMaxTries;
+        // VELES BEGIN
+        // Try nonces in growing batches hashed by the worker threads, so easy
+        // (regtest) targets stay cheap and hard ones make use of every core.
+        uint64_t nBatchSize = 1;
+        std::vector<CBlockHeader> vHeaders;
+        std::vector<uint256> vPoWHashes;
+        bool fFound = false;
+        while (!fFound && nMaxTries > 0 && pblock->nNonce < nInnerLoopCount) {
+            unsigned int nCount = std::min<uint64_t>(std::min<uint64_t>(nBatchSize, nMaxTries), nInnerLoopCount - pblock->nNonce);
+            vHeaders.assign(nCount, pblock->GetBlockHeader());
+            for (unsigned int i = 0; i < nCount; i++)
+                vHeaders[i].nNonce = pblock->nNonce + i;
+            GetPoWHashes(vHeaders, vPoWHashes);
+            unsigned int nTried = 0;
+            for (; nTried < nCount; nTried++) {
+                if (CheckProofOfWork(vPoWHashes[nTried], pblock->nBits, Params().GetConsensus())) {
+                    fFound = true;
+                    break;
+                }
+            }
+            pblock->nNonce += nTried;
+            nMaxTries -= nTried;
+            nBatchSize = std::min<uint64_t>(nBatchSize * 2, MAX_GENERATE_BATCH_SIZE);
         }
+        // ProcessNewBlock checks the proof of work again, without hashing
+        if (fFound)
+            CacheBlockHeaderProofOfWork(*pblock, Params().GetConsensus());
+        // VELES END
         if (nMaxTries == 0) {
             break;
         }
@@ -385,7 +404,7 @@ static UniValue gethalvingstatus(const JSONRPCRequest& request)
             + HelpExampleRpc("gethalvingstatus", "")
         );
 
-    HalvingParameters *halvingParams = GetSubsidyHalvingParameters();
+    std::shared_ptr<const HalvingParameters> halvingParams = GetSubsidyHalvingParameters();
     std::vector<std::string> knownEpochs = { "COINSWAP", "BOOTSTRAP", "ALPHA" };
     std::string epochName;
     int nHalvings = 0;
@@ -431,7 +450,7 @@ static UniValue gethalvingstatus(const JSONRPCRequest& request)
             : CountBlockRewards(
                 halvingParams->epochs[i].nStartBlock, 
                 chainActive.Height(), 
-                GetSubsidyHalvingParameters(chainActive.Height(), Params().GetConsensus())
+                halvingParams.get()
                 );
         nSupplySinceHalving += nEpochRealSupply;
 
@@ -19,6 +19,10 @@
 
 #include <boost/lexical_cast.hpp>
 
+// VELES BEGIN
+#include <limits>
+// VELES END
+
 class CSporkMessage;
 class CSporkManager;
 
@@ -26,6 +30,96 @@ CSporkManager sporkManager;
 
 std::map<uint256, CSporkMessage> mapSporks;
 
+// VELES BEGIN
+/** Table value of sporks in the known ID ranges that have no name */
+static const int64_t SPORK_VALUE_UNKNOWN = std::numeric_limits<int64_t>::min();
+
+/** Slot of a spork in the value table, -1 outside the known ID ranges */
+static int GetSporkIndex(int nSporkID)
+{
+    if (nSporkID >= SPORK_START && nSporkID <= SPORK_END)
+        return nSporkID - SPORK_START;
+    if (nSporkID >= SPORK_FXTC_START && nSporkID <= SPORK_FXTC_END)
+        return (SPORK_END - SPORK_START + 1) + (nSporkID - SPORK_FXTC_START);
+    if (nSporkID >= SPORK_VELES_START && nSporkID <= SPORK_VELES_END)
+        return (SPORK_END - SPORK_START + 1) + (SPORK_FXTC_END - SPORK_FXTC_START + 1) + (nSporkID - SPORK_VELES_START);
+    return -1;
+}
+
+static int GetSporkIDByIndex(int nIndex)
+{
+    if (nIndex < SPORK_END - SPORK_START + 1)
+        return SPORK_START + nIndex;
+    nIndex -= SPORK_END - SPORK_START + 1;
+    if (nIndex < SPORK_FXTC_END - SPORK_FXTC_START + 1)
+        return SPORK_FXTC_START + nIndex;
+    nIndex -= SPORK_FXTC_END - SPORK_FXTC_START + 1;
+    return SPORK_VELES_START + nIndex;
+}
+
+/** Value of a spork until a signed spork message sets it */
+static int64_t GetSporkDefaultValue(int nSporkID)
+{
+    switch (nSporkID) {
+        case SPORK_2_INSTANTSEND_ENABLED:               return SPORK_2_INSTANTSEND_ENABLED_DEFAULT;
+        case SPORK_3_INSTANTSEND_BLOCK_FILTERING:       return SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT;
+        case SPORK_5_INSTANTSEND_MAX_VALUE:             return SPORK_5_INSTANTSEND_MAX_VALUE_DEFAULT;
+        case SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT:    return SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
+        case SPORK_9_SUPERBLOCKS_ENABLED:               return SPORK_9_SUPERBLOCKS_ENABLED_DEFAULT;
+        case SPORK_10_MASTERNODE_PAY_UPDATED_NODES:     return SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
+        case SPORK_12_RECONSIDER_BLOCKS:                return SPORK_12_RECONSIDER_BLOCKS_DEFAULT;
+        case SPORK_13_OLD_SUPERBLOCK_FLAG:              return SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT;
+        case SPORK_14_REQUIRE_SENTINEL_FLAG:            return SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT;
+        // FXTC BEGIN
+        case SPORK_FXTC_01_HANDBRAKE_HEIGHT:            return SPORK_FXTC_01_HANDBRAKE_HEIGHT_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D:     return SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT:      return SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5:       return SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z:      return SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_X11:         return SPORK_FXTC_01_HANDBRAKE_FORCE_X11_DEFAULT;
+        case SPORK_FXTC_01_HANDBRAKE_FORCE_X16R:        return SPORK_FXTC_01_HANDBRAKE_FORCE_X16R_DEFAULT;
+        case SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE:     return SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE_DEFAULT;
+        case SPORK_VELES_02_OPTIONAL_DEV_REWARD_START:          return SPORK_VELES_02_OPTIONAL_DEV_REWARD_START_DEFAULT;
+        case SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE:          return SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE_DEFAULT;
+        case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE:      return SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE_DEFAULT;
+        case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE:      return SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE_DEFAULT;
+        case SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START:   return SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START_DEFAULT;
+        // FXTC END
+        case SPORK_VELES_01_FXTC_CHAIN_START:                     return SPORK_VELES_01_FXTC_CHAIN_START_DEFAULT;
+        case SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START:        return SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START_DEFAULT;
+        case SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS:       return SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS_DEFAULT;
+        case SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START:           return SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_START:            return SPORK_VELES_05A_ADJUST_COST_FACTOR_START_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D:          return SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT:           return SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5:            return SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z:           return SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_X11:              return SPORK_VELES_05A_ADJUST_COST_FACTOR_X11_DEFAULT;
+        case SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R:             return SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_START:            return SPORK_VELES_05B_ADJUST_COST_FACTOR_START_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D:          return SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT:           return SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5:            return SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z:           return SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_X11:              return SPORK_VELES_05B_ADJUST_COST_FACTOR_X11_DEFAULT;
+        case SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R:             return SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R_DEFAULT;
+        case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START:         return SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START_DEFAULT;
+        case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR:        return SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR_DEFAULT;
+        case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START:         return SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START_DEFAULT;
+        case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR:        return SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR_DEFAULT;
+        case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START:         return SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START_DEFAULT;
+        case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR:        return SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR_DEFAULT;
+        default:                                        return SPORK_VALUE_UNKNOWN;
+    }
+}
+
+CSporkManager::CSporkManager()
+{
+    for (int i = 0; i < SPORK_COUNT; i++)
+        anSporkValues[i] = GetSporkDefaultValue(GetSporkIDByIndex(i));
+}
+// VELES END
+
 // FXTC BEGIN
 std::unique_ptr<CSporkDB> pSporkDB = NULL;
 
@@ -55,8 +149,17 @@ void CSporkManager::LoadSporksFromDB()
             continue;
         }
         // add spork to memory
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        // VELES BEGIN
+        bool fChanged;
+        {
+            LOCK(cs);
+            mapSporks[spork.GetHash()] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+            fChanged = SetSporkValue(spork.nSporkID, spork.nValue);
+        }
+        if (fChanged)
+            NotifySporkChanged(spork.nSporkID, spork.nValue);
+        // VELES END
         std::time_t result = spork.nValue;
         // If SPORK Value is greater than 1,000,000 assume it's actually a Date and then convert to a more readable format
         if (spork.nValue > 1000000) {
@@ -90,26 +193,41 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->GetId());
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
-                return;
+        // VELES BEGIN
+        // Compared and stored under one lock, so an older spork handled at
+        // the same time can't replace a newer one
+        bool fValid, fChanged = false;
+        {
+            LOCK(cs);
+            auto it = mapSporksActive.find(spork.nSporkID);
+            if (it != mapSporksActive.end()) {
+                if (it->second.nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint(BCLog::SPORK, "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
+            }
+
+            fValid = spork.CheckSignature();
+            if (fValid) {
+                mapSporks[hash] = spork;
+                mapSporksActive[spork.nSporkID] = spork;
+                fChanged = SetSporkValue(spork.nSporkID, spork.nValue);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
-        if(!spork.CheckSignature()) {
+        if(!fValid) {
             LOCK(cs_main);
             LogPrintf("CSporkManager::ProcessSpork -- invalid signature\n");
             Misbehaving(pfrom->GetId(), 100);
             return;
         }
-
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        if (fChanged)
+            NotifySporkChanged(spork.nSporkID, spork.nValue);
+        // VELES END
         spork.Relay(connman);
 
         //does a task if needed
@@ -121,6 +239,9 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
         // FXTC END
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
+        // VELES BEGIN
+        LOCK(cs);
+        // VELES END
         std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
 
         while(it != mapSporksActive.end()) {
@@ -167,8 +288,17 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 
     if(spork.Sign(strMasterPrivKey)) {
         spork.Relay(connman);
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[nSporkID] = spork;
+        // VELES BEGIN
+        bool fChanged;
+        {
+            LOCK(cs);
+            mapSporks[spork.GetHash()] = spork;
+            mapSporksActive[nSporkID] = spork;
+            fChanged = SetSporkValue(nSporkID, nValue);
+        }
+        if (fChanged)
+            NotifySporkChanged(nSporkID, nValue);
+        // VELES END
         return true;
     }
 
@@ -178,69 +308,15 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, CConnman& connman)
 // grab the spork, otherwise say it's off
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
-    int64_t r = -1;
+    // VELES BEGIN
+    int nIndex = GetSporkIndex(nSporkID);
+    int64_t r = nIndex < 0 ? GetSporkMessageValue(nSporkID) : anSporkValues[nIndex].load();
 
-    if(mapSporksActive.count(nSporkID)){
-        r = mapSporksActive[nSporkID].nValue;
-    } else {
-        switch (nSporkID) {
-            case SPORK_2_INSTANTSEND_ENABLED:               r = SPORK_2_INSTANTSEND_ENABLED_DEFAULT; break;
-            case SPORK_3_INSTANTSEND_BLOCK_FILTERING:       r = SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT; break;
-            case SPORK_5_INSTANTSEND_MAX_VALUE:             r = SPORK_5_INSTANTSEND_MAX_VALUE_DEFAULT; break;
-            case SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT:    r = SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT; break;
-            case SPORK_9_SUPERBLOCKS_ENABLED:               r = SPORK_9_SUPERBLOCKS_ENABLED_DEFAULT; break;
-            case SPORK_10_MASTERNODE_PAY_UPDATED_NODES:     r = SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT; break;
-            case SPORK_12_RECONSIDER_BLOCKS:                r = SPORK_12_RECONSIDER_BLOCKS_DEFAULT; break;
-            case SPORK_13_OLD_SUPERBLOCK_FLAG:              r = SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT; break;
-            case SPORK_14_REQUIRE_SENTINEL_FLAG:            r = SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT; break;
-            // FXTC BEGIN
-            case SPORK_FXTC_01_HANDBRAKE_HEIGHT :           r = SPORK_FXTC_01_HANDBRAKE_HEIGHT_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D:     r = SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT:      r = SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5:       r = SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z:      r = SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_X11:         r = SPORK_FXTC_01_HANDBRAKE_FORCE_X11_DEFAULT; break;
-            case SPORK_FXTC_01_HANDBRAKE_FORCE_X16R:        r = SPORK_FXTC_01_HANDBRAKE_FORCE_X16R_DEFAULT; break;
-
-            case SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE:     r = SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE_DEFAULT; break;
-            case SPORK_VELES_02_OPTIONAL_DEV_REWARD_START:          r = SPORK_VELES_02_OPTIONAL_DEV_REWARD_START_DEFAULT; break;
-            case SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE:          r = SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE_DEFAULT; break;
-            case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE:      r = SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE_DEFAULT; break;
-            case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE:      r = SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE_DEFAULT; break;
-            case SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START:   r = SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START_DEFAULT; break;
-            // FXTC END
-            // VELES BEGIN
-            case SPORK_VELES_01_FXTC_CHAIN_START:                     r = SPORK_VELES_01_FXTC_CHAIN_START_DEFAULT; break;
-            case SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START:        r = SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START_DEFAULT; break;
-            case SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS:       r = SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS_DEFAULT; break;
-            case SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START:           r = SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_START:            r = SPORK_VELES_05A_ADJUST_COST_FACTOR_START_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D:          r = SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT:           r = SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5:            r = SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z:           r = SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_X11:              r = SPORK_VELES_05A_ADJUST_COST_FACTOR_X11_DEFAULT; break;
-            case SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R:             r = SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_START:            r = SPORK_VELES_05B_ADJUST_COST_FACTOR_START_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D:          r = SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT:           r = SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5:            r = SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z:           r = SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_X11:              r = SPORK_VELES_05B_ADJUST_COST_FACTOR_X11_DEFAULT; break;
-            case SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R:             r = SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R_DEFAULT; break;
-            case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START:         r = SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START_DEFAULT; break;
-            case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR:        r = SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR_DEFAULT; break;
-            case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START:         r = SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START_DEFAULT; break;
-            case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR:        r = SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR_DEFAULT; break;
-            case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START:         r = SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START_DEFAULT; break;
-            case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR:        r = SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR_DEFAULT; break;
-            // VELES END
-            default:
-                LogPrint(BCLog::SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
-                r = 4070908800ULL; // 2099-1-1 i.e. off by default
-                break;
-        }
+    if (r == SPORK_VALUE_UNKNOWN) {
+        LogPrint(BCLog::SPORK, "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
+        r = 4070908800ULL; // 2099-1-1 i.e. off by default
     }
+    // VELES END
 
     return r < GetAdjustedTime();
 }
@@ -248,66 +324,34 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
-    if (mapSporksActive.count(nSporkID))
-        return mapSporksActive[nSporkID].nValue;
+    // VELES BEGIN
+    int nIndex = GetSporkIndex(nSporkID);
+    int64_t nValue = nIndex < 0 ? GetSporkMessageValue(nSporkID) : anSporkValues[nIndex].load();
 
-    switch (nSporkID) {
-        case SPORK_2_INSTANTSEND_ENABLED:               return SPORK_2_INSTANTSEND_ENABLED_DEFAULT;
-        case SPORK_3_INSTANTSEND_BLOCK_FILTERING:       return SPORK_3_INSTANTSEND_BLOCK_FILTERING_DEFAULT;
-        case SPORK_5_INSTANTSEND_MAX_VALUE:             return SPORK_5_INSTANTSEND_MAX_VALUE_DEFAULT;
-        case SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT:    return SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT_DEFAULT;
-        case SPORK_9_SUPERBLOCKS_ENABLED:               return SPORK_9_SUPERBLOCKS_ENABLED_DEFAULT;
-        case SPORK_10_MASTERNODE_PAY_UPDATED_NODES:     return SPORK_10_MASTERNODE_PAY_UPDATED_NODES_DEFAULT;
-        case SPORK_12_RECONSIDER_BLOCKS:                return SPORK_12_RECONSIDER_BLOCKS_DEFAULT;
-        case SPORK_13_OLD_SUPERBLOCK_FLAG:              return SPORK_13_OLD_SUPERBLOCK_FLAG_DEFAULT;
-        case SPORK_14_REQUIRE_SENTINEL_FLAG:            return SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT;
-        // FXTC BEGIN
-        case SPORK_FXTC_01_HANDBRAKE_HEIGHT:            return SPORK_FXTC_01_HANDBRAKE_HEIGHT_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D:     return SPORK_FXTC_01_HANDBRAKE_FORCE_SHA256D_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT:      return SPORK_FXTC_01_HANDBRAKE_FORCE_SCRYPT_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5:       return SPORK_FXTC_01_HANDBRAKE_FORCE_NIST5_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z:      return SPORK_FXTC_01_HANDBRAKE_FORCE_LYRA2Z_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_X11:         return SPORK_FXTC_01_HANDBRAKE_FORCE_X11_DEFAULT;
-        case SPORK_FXTC_01_HANDBRAKE_FORCE_X16R:        return SPORK_FXTC_01_HANDBRAKE_FORCE_X16R_DEFAULT;
-        case SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE:     return SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE_DEFAULT;
-        case SPORK_VELES_02_OPTIONAL_DEV_REWARD_START:          return SPORK_VELES_02_OPTIONAL_DEV_REWARD_START_DEFAULT;
-        case SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE:          return SPORK_VELES_02_OPTIONAL_DEV_REWARD_VALUE_DEFAULT;
-        case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE:      return SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE_DEFAULT;
-        case SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE:      return SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE_DEFAULT;
-        case SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START:   return SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START_DEFAULT;
-        // FXTC END
-        // VELES BEGIN
-        case SPORK_VELES_01_FXTC_CHAIN_START:                     return SPORK_VELES_01_FXTC_CHAIN_START_DEFAULT;
-        case SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START:        return SPORK_VELES_02_UNLIMITED_BLOCK_SUBSIDY_START_DEFAULT;
-        case SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS:       return SPORK_VELES_03_RECALCULATE_HALVING_PARAMETERS_DEFAULT;
-        case SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START:           return SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_START:            return SPORK_VELES_05A_ADJUST_COST_FACTOR_START_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D:          return SPORK_VELES_05A_ADJUST_COST_FACTOR_SHA256D_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT:           return SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5:            return SPORK_VELES_05A_ADJUST_COST_FACTOR_NIST5_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z:           return SPORK_VELES_05A_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_X11:              return SPORK_VELES_05A_ADJUST_COST_FACTOR_X11_DEFAULT;
-        case SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R:             return SPORK_VELES_05A_ADJUST_COST_FACTOR_X16R_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_START:            return SPORK_VELES_05B_ADJUST_COST_FACTOR_START_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D:          return SPORK_VELES_05B_ADJUST_COST_FACTOR_SHA256D_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT:           return SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5:            return SPORK_VELES_05B_ADJUST_COST_FACTOR_NIST5_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z:           return SPORK_VELES_05B_ADJUST_COST_FACTOR_LYRA2Z_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_X11:              return SPORK_VELES_05B_ADJUST_COST_FACTOR_X11_DEFAULT;
-        case SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R:             return SPORK_VELES_05B_ADJUST_COST_FACTOR_X16R_DEFAULT;
-        case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START:         return SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_START_DEFAULT;
-        case SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR:        return SPORK_VELES_06A_DYNAMIC_REWARD_BOOST1_FACTOR_DEFAULT;
-        case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START:         return SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_START_DEFAULT;
-        case SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR:        return SPORK_VELES_06B_DYNAMIC_REWARD_BOOST2_FACTOR_DEFAULT;
-        case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START:         return SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_START_DEFAULT;
-        case SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR:        return SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR_DEFAULT;
-        // VELES END
-        default:
-            LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
-            return -1;
+    if (nValue == SPORK_VALUE_UNKNOWN) {
+        LogPrint(BCLog::SPORK, "CSporkManager::GetSporkValue -- Unknown Spork ID %d\n", nSporkID);
+        return -1;
     }
+    return nValue;
+    // VELES END
+}
 
+// VELES BEGIN
+int64_t CSporkManager::GetSporkMessageValue(int nSporkID)
+{
+    LOCK(cs);
+
+    auto it = mapSporksActive.find(nSporkID);
+    return it == mapSporksActive.end() ? SPORK_VALUE_UNKNOWN : it->second.nValue;
+}
+
+bool CSporkManager::SetSporkValue(int nSporkID, int64_t nValue)
+{
+    AssertLockHeld(cs);
+    int nIndex = GetSporkIndex(nSporkID);
+    return nIndex < 0 || anSporkValues[nIndex].exchange(nValue) != nValue;
 }
+// VELES END
 
 int CSporkManager::GetSporkIDByName(std::string strName)
 {
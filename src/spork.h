@@ -9,8 +9,16 @@
 
 #include <hash.h>
 #include <net.h>
+#include <sync.h>
 #include <utilstrencodings.h>
 
+// VELES BEGIN
+#include <array>
+#include <atomic>
+
+#include <boost/signals2/signal.hpp>
+// VELES END
+
 // FXTC BEGIN
 class CSporkDB;
 
@@ -34,6 +42,8 @@ static const int SPORK_FXTC_END                                      = 94680031;
 // VELES BEGIN
 static const int SPORK_VELES_START                                    = 94690010;
 static const int SPORK_VELES_END                                      = 94690051;
+/** Number of IDs in the ranges above, each of which has a slot in the spork value table */
+static const int SPORK_COUNT = (SPORK_END - SPORK_START + 1) + (SPORK_FXTC_END - SPORK_FXTC_START + 1) + (SPORK_VELES_END - SPORK_VELES_START + 1);
 // VELES END
 
 static const int SPORK_2_INSTANTSEND_ENABLED                            = 10001;
@@ -203,11 +213,25 @@ class CSporkManager
 private:
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
-    std::map<int, CSporkMessage> mapSporksActive;
+    // VELES BEGIN
+    CCriticalSection cs;
+    std::map<int, CSporkMessage> mapSporksActive GUARDED_BY(cs);
+    /** Value of every spork in the known ID ranges, the network's or the default, read without locking */
+    std::array<std::atomic<int64_t>, SPORK_COUNT> anSporkValues;
+
+    /** Value of a spork outside the known ID ranges */
+    int64_t GetSporkMessageValue(int nSporkID);
+    /** Store a spork value received or signed; true if it changed, for NotifySporkChanged once cs is released */
+    bool SetSporkValue(int nSporkID, int64_t nValue) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    // VELES END
 
 public:
+    // VELES BEGIN
+    /** A spork changed its value, so values derived from sporks have to be recomputed */
+    boost::signals2::signal<void (int nSporkID, int64_t nValue)> NotifySporkChanged;
+    // VELES END
 
-    CSporkManager() {}
+    CSporkManager();
 
     // FXTC BEGIN
     void LoadSporksFromDB();
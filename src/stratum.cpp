@@ -0,0 +1,651 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stratum.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <governance-classes.h>
+#include <hash.h>
+#include <key_io.h>
+#include <masternode-payments.h>
+#include <masternode-sync.h>
+#include <miner.h>
+#include <netbase.h>
+#include <pow.h>
+#include <random.h>
+#include <script/standard.h>
+#include <spork.h>
+#include <streams.h>
+#include <timedata.h>
+#include <txmempool.h>
+#include <ui_interface.h>
+#include <util.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <univalue.h>
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include <boost/algorithm/string.hpp>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+/** Longest line a miner may send before it is disconnected */
+static const size_t MAX_STRATUM_LINE = 16 * 1024;
+/** Jobs kept for share submission while the tip stays the same */
+static const size_t MAX_STRATUM_JOBS = 64;
+
+CStratumJob::CStratumJob(const std::string& strIdIn, const CBlock& blockIn, int nHeightIn) : strId(strIdIn), nHeight(nHeightIn), block(blockIn)
+{
+    // Room for the extranonce after the height, where IncrementExtraNonce puts its own
+    CMutableTransaction txCoinbase(*block.vtx[0]);
+    txCoinbase.vin[0].scriptSig = CScript() << nHeight << std::vector<unsigned char>(STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE, 0);
+    block.vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+
+    // The coinbase is leaf 0, so every step of its branch is the right-hand sibling
+    std::vector<uint256> vLevel;
+    for (const auto& tx : block.vtx)
+        vLevel.push_back(tx->GetHash());
+    while (vLevel.size() > 1) {
+        vMerkleBranch.push_back(vLevel[1]);
+        if (vLevel.size() & 1)
+            vLevel.push_back(vLevel.back());
+        std::vector<uint256> vNext;
+        for (size_t i = 0; i < vLevel.size(); i += 2)
+            vNext.push_back(Hash(vLevel[i].begin(), vLevel[i].end(), vLevel[i + 1].begin(), vLevel[i + 1].end()));
+        vLevel.swap(vNext);
+    }
+}
+
+void CStratumJob::GetCoinbase(const CScript& scriptPubKey, std::vector<unsigned char>& vchCoinb1, std::vector<unsigned char>& vchCoinb2) const
+{
+    CMutableTransaction txCoinbase(*block.vtx[0]);
+    txCoinbase.vout[0].scriptPubKey = scriptPubKey;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << txCoinbase;
+    // nVersion, one input, its prevout and the scriptSig length come before the scriptSig,
+    // which ends with the extranonce
+    const CScript& scriptSig = txCoinbase.vin[0].scriptSig;
+    size_t nOffset = 4 + 1 + 36 + GetSizeOfCompactSize(scriptSig.size()) + scriptSig.size() - STRATUM_EXTRANONCE1_SIZE - STRATUM_EXTRANONCE2_SIZE;
+    vchCoinb1.assign(ss.begin(), ss.begin() + nOffset);
+    vchCoinb2.assign(ss.begin() + nOffset + STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE, ss.end());
+}
+
+CBlock CStratumJob::GetBlock(const CScript& scriptPubKey, const std::vector<unsigned char>& vchExtraNonce, uint32_t nTime, uint32_t nNonce) const
+{
+    CBlock blockSolved(block);
+    CMutableTransaction txCoinbase(*block.vtx[0]);
+    txCoinbase.vout[0].scriptPubKey = scriptPubKey;
+    txCoinbase.vin[0].scriptSig = CScript() << nHeight << vchExtraNonce;
+    blockSolved.vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    blockSolved.hashMerkleRoot = BlockMerkleRoot(blockSolved);
+    blockSolved.nTime = nTime;
+    blockSolved.nNonce = nNonce;
+    return blockSolved;
+}
+
+arith_uint256 GetStratumShareTarget(int32_t nAlgo, double dDifficulty)
+{
+    // Scaled so that fractional difficulties keep their precision
+    static const uint64_t SCALE = 4096;
+    dDifficulty = std::min(MAX_STRATUM_DIFFICULTY, std::max(MIN_STRATUM_DIFFICULTY, dDifficulty));
+    arith_uint256 target;
+    target.SetCompact(0x1d00ffff);
+    if (nAlgo == ALGO_SCRYPT)
+        target <<= 16;
+    target *= SCALE;
+    target /= std::max<uint64_t>(1, (uint64_t)(dDifficulty * SCALE));
+    return target;
+}
+
+namespace {
+
+/** A miner connection, only ever touched from the stratum event thread */
+struct StratumClient
+{
+    struct bufferevent* bev;
+    std::string strPeer;
+    std::vector<unsigned char> vchExtraNonce1;
+    bool fSubscribed;
+    bool fAuthorized;
+    CScript scriptPubKey;
+    int32_t nAlgo;
+    double dDifficulty;
+};
+
+struct event_base* stratumBase = nullptr;
+struct evconnlistener* stratumListener = nullptr;
+struct event* stratumRefresh = nullptr;
+std::thread stratumThread;
+
+std::map<struct bufferevent*, StratumClient> mapClients;
+uint32_t nExtraNonce1Next = 0;
+double dDefaultDifficulty = DEFAULT_STRATUM_DIFFICULTY;
+
+/** Jobs on the current tip, by number and by algo, and the shares already seen on each */
+std::map<uint64_t, std::shared_ptr<const CStratumJob>> mapJobs;
+std::map<int32_t, std::shared_ptr<const CStratumJob>> mapAlgoJobs;
+std::map<uint64_t, std::set<uint256>> mapJobShares;
+uint256 hashJobsTip;
+unsigned int nJobsTransactionsUpdated = 0;
+uint64_t nJobCounter = 0;
+
+UniValue StratumError(int nCode, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(nCode);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+    return error;
+}
+
+void Send(const StratumClient& client, const UniValue& msg)
+{
+    std::string strMsg = msg.write() + "\n";
+    bufferevent_write(client.bev, strMsg.data(), strMsg.size());
+}
+
+void Reply(const StratumClient& client, const UniValue& id, const UniValue& result, const UniValue& error)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.pushKV("id", id);
+    reply.pushKV("result", result);
+    reply.pushKV("error", error);
+    Send(client, reply);
+}
+
+void Call(const StratumClient& client, const std::string& strMethod, const UniValue& params)
+{
+    UniValue call(UniValue::VOBJ);
+    call.pushKV("id", NullUniValue);
+    call.pushKV("method", strMethod);
+    call.pushKV("params", params);
+    Send(client, call);
+}
+
+/** Whether a block mined now would be accepted, as getblocktemplate checks */
+bool CanMine(int nHeight)
+{
+    if (IsInitialBlockDownload())
+        return false;
+    CScript payee;
+    if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)
+        && !masternodeSync.IsWinnersListSynced()
+        && !mnpayments.GetBlockPayee(nHeight, payee))
+        return false;
+    if (sporkManager.IsSporkActive(SPORK_9_SUPERBLOCKS_ENABLED)
+        && !masternodeSync.IsSynced()
+        && CSuperblock::IsValidBlockHeight(nHeight))
+        return false;
+    return true;
+}
+
+std::shared_ptr<const CStratumJob> BuildJob(int32_t nAlgo)
+{
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height() + 1;
+    }
+    if (!CanMine(nHeight))
+        return nullptr;
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    try {
+        pblocktemplate = BlockAssembler(Params(), nAlgo).CreateNewBlock(CScript() << OP_TRUE);
+    } catch (const std::exception& e) {
+        LogPrintf("Stratum: could not create a %s block: %s\n", GetAlgoName(nAlgo), e.what());
+        return nullptr;
+    }
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexPrev = LookupBlockIndex(pblocktemplate->block.hashPrevBlock);
+        nHeight = pindexPrev->nHeight + 1;
+    }
+
+    uint64_t nJob = ++nJobCounter;
+    auto job = std::make_shared<const CStratumJob>(strprintf("%x", nJob), pblocktemplate->block, nHeight);
+    mapJobs[nJob] = job;
+    while (mapJobs.size() > MAX_STRATUM_JOBS) {
+        mapJobShares.erase(mapJobs.begin()->first);
+        mapJobs.erase(mapJobs.begin());
+    }
+    mapAlgoJobs[nAlgo] = job;
+    LogPrint(BCLog::STRATUM, "Stratum: job %s for %s at height %d, %u txs\n", job->strId, GetAlgoName(nAlgo), nHeight, job->block.vtx.size());
+    return job;
+}
+
+std::shared_ptr<const CStratumJob> GetJob(int32_t nAlgo)
+{
+    auto it = mapAlgoJobs.find(nAlgo);
+    if (it != mapAlgoJobs.end())
+        return it->second;
+    return BuildJob(nAlgo);
+}
+
+/** The words of a hash as miners expect the previous block hash: each 4-byte word byte-reversed */
+std::string SwapWords(const uint256& hash)
+{
+    std::vector<unsigned char> vch(hash.begin(), hash.end());
+    for (size_t i = 0; i < vch.size(); i += 4)
+        std::reverse(vch.begin() + i, vch.begin() + i + 4);
+    return HexStr(vch);
+}
+
+void Notify(const StratumClient& client, const CStratumJob& job, bool fClean)
+{
+    std::vector<unsigned char> vchCoinb1, vchCoinb2;
+    job.GetCoinbase(client.scriptPubKey, vchCoinb1, vchCoinb2);
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : job.vMerkleBranch)
+        branch.push_back(HexStr(hash.begin(), hash.end()));
+
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strId);
+    params.push_back(SwapWords(job.block.hashPrevBlock));
+    params.push_back(HexStr(vchCoinb1));
+    params.push_back(HexStr(vchCoinb2));
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", (uint32_t)job.block.nVersion));
+    params.push_back(strprintf("%08x", job.block.nBits));
+    params.push_back(strprintf("%08x", job.block.nTime));
+    params.push_back(fClean);
+    Call(client, "mining.notify", params);
+}
+
+/** Rebuild the jobs of the algos being mined after the tip or the mempool changed */
+void RefreshJobs(evutil_socket_t, short, void*)
+{
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+    bool fClean = hashTip != hashJobsTip;
+    if (!fClean && mempool.GetTransactionsUpdated() == nJobsTransactionsUpdated)
+        return;
+    if (fClean) {
+        mapJobs.clear();
+        mapAlgoJobs.clear();
+        mapJobShares.clear();
+    }
+    hashJobsTip = hashTip;
+    nJobsTransactionsUpdated = mempool.GetTransactionsUpdated();
+
+    std::set<int32_t> setAlgos;
+    for (const auto& item : mapClients)
+        if (item.second.fAuthorized)
+            setAlgos.insert(item.second.nAlgo);
+    for (int32_t nAlgo : setAlgos) {
+        if (!BuildJob(nAlgo)) {
+            // Try again on the next trigger instead of keeping the miners on the old tip
+            hashJobsTip.SetNull();
+        }
+    }
+    for (const auto& item : mapClients) {
+        auto it = mapAlgoJobs.find(item.second.nAlgo);
+        if (item.second.fAuthorized && it != mapAlgoJobs.end())
+            Notify(item.second, *it->second, fClean);
+    }
+}
+
+UniValue Subscribe(StratumClient& client, const UniValue& params)
+{
+    client.fSubscribed = true;
+    UniValue subscriptions(UniValue::VARR);
+    for (const char* method : {"mining.set_difficulty", "mining.notify"}) {
+        UniValue subscription(UniValue::VARR);
+        subscription.push_back(method);
+        subscription.push_back(HexStr(client.vchExtraNonce1));
+        subscriptions.push_back(subscription);
+    }
+    UniValue result(UniValue::VARR);
+    result.push_back(subscriptions);
+    result.push_back(HexStr(client.vchExtraNonce1));
+    result.push_back((int)STRATUM_EXTRANONCE2_SIZE);
+    return result;
+}
+
+/** Username is the payout address, optionally followed by .worker; the password may hold algo=<algo>,d=<difficulty> */
+bool Authorize(StratumClient& client, const UniValue& params)
+{
+    std::string strUser = params[0].get_str();
+    CTxDestination dest = DecodeDestination(strUser.substr(0, strUser.find('.')));
+    if (!IsValidDestination(dest))
+        return false;
+
+    int32_t nAlgo = miningAlgo;
+    double dDifficulty = dDefaultDifficulty;
+    if (params.size() > 1 && params[1].isStr()) {
+        std::vector<std::string> vOptions;
+        boost::split(vOptions, params[1].get_str(), boost::is_any_of(","));
+        for (const std::string& strOption : vOptions) {
+            size_t nPos = strOption.find('=');
+            std::string strKey = strOption.substr(0, nPos);
+            std::string strValue = nPos == std::string::npos ? "" : strOption.substr(nPos + 1);
+            if (strKey == "algo") {
+                nAlgo = GetAlgoId(strValue);
+                if (GetAlgoName(nAlgo) != strValue)
+                    return false;
+            } else if (strKey == "d") {
+                dDifficulty = atof(strValue.c_str());
+                if (!(dDifficulty >= MIN_STRATUM_DIFFICULTY && dDifficulty <= MAX_STRATUM_DIFFICULTY))
+                    return false;
+            }
+        }
+    }
+
+    client.scriptPubKey = GetScriptForDestination(dest);
+    client.nAlgo = nAlgo;
+    client.dDifficulty = dDifficulty;
+    client.fAuthorized = true;
+    LogPrint(BCLog::STRATUM, "Stratum: %s authorized as %s mining %s at difficulty %g\n", client.strPeer, strUser, GetAlgoName(nAlgo), dDifficulty);
+    return true;
+}
+
+/** Retire a job that has seen too many shares, moving the miners on its algo to fresh work */
+void RolloverJob(uint64_t nJob)
+{
+    std::shared_ptr<const CStratumJob> job = mapJobs.at(nJob);
+    int32_t nAlgo = job->block.nVersion & ALGO_VERSION_MASK;
+    mapJobs.erase(nJob);
+    mapJobShares.erase(nJob);
+    LogPrint(BCLog::STRATUM, "Stratum: job %s is full, replacing it\n", job->strId);
+    auto it = mapAlgoJobs.find(nAlgo);
+    if (it == mapAlgoJobs.end() || it->second != job)
+        return;
+    mapAlgoJobs.erase(it);
+    job = BuildJob(nAlgo);
+    if (!job)
+        return;
+    for (const auto& item : mapClients)
+        if (item.second.fAuthorized && item.second.nAlgo == nAlgo)
+            Notify(item.second, *job, true);
+}
+
+/** Check a share and submit it as a block if it meets the block target; returns an error or null */
+UniValue SubmitShare(const StratumClient& client, const UniValue& params)
+{
+    if (!client.fAuthorized)
+        return StratumError(24, "Unauthorized worker");
+    if (params.size() < 5)
+        return StratumError(20, "Invalid parameters");
+
+    uint64_t nJob = strtoull(params[1].get_str().c_str(), nullptr, 16);
+    auto it = mapJobs.find(nJob);
+    if (it == mapJobs.end())
+        return StratumError(21, "Job not found");
+    // Held on to, as a full job is dropped from mapJobs
+    std::shared_ptr<const CStratumJob> job = it->second;
+
+    std::vector<unsigned char> vchExtraNonce2 = ParseHex(params[2].get_str());
+    if (vchExtraNonce2.size() != STRATUM_EXTRANONCE2_SIZE || params[3].get_str().size() != 8 || params[4].get_str().size() != 8 || !IsHex(params[3].get_str()) || !IsHex(params[4].get_str()))
+        return StratumError(20, "Invalid parameters");
+    uint32_t nTime = strtoul(params[3].get_str().c_str(), nullptr, 16);
+    uint32_t nNonce = strtoul(params[4].get_str().c_str(), nullptr, 16);
+    if (nTime < job->block.nTime || nTime > GetAdjustedTime() + MAX_FUTURE_BLOCK_TIME)
+        return StratumError(20, "Time out of range");
+
+    std::vector<unsigned char> vchExtraNonce(client.vchExtraNonce1);
+    vchExtraNonce.insert(vchExtraNonce.end(), vchExtraNonce2.begin(), vchExtraNonce2.end());
+    CBlock block = job->GetBlock(client.scriptPubKey, vchExtraNonce, nTime, nNonce);
+    int32_t nAlgo = block.nVersion & ALGO_VERSION_MASK;
+    uint256 hashPoW = block.GetPoWHash();
+    if (UintToArith256(hashPoW) > GetStratumShareTarget(nAlgo, client.dDifficulty))
+        return StratumError(23, "Low difficulty share");
+    std::set<uint256>& setShares = mapJobShares[nJob];
+    if (!setShares.insert(block.GetHash()).second)
+        return StratumError(22, "Duplicate share");
+    if (setShares.size() >= MAX_STRATUM_JOB_SHARES)
+        RolloverJob(nJob);
+
+    if (CheckBlockHeaderProofOfWork(block, Params().GetConsensus(), &hashPoW)) {
+        LogPrintf("Stratum: %s found %s block %s at height %d\n", client.strPeer, GetAlgoName(nAlgo), block.GetHash().ToString(), job->nHeight);
+        bool fNewBlock = false;
+        if (!ProcessNewBlock(Params(), std::make_shared<const CBlock>(block), true, &fNewBlock))
+            return StratumError(20, "Block rejected");
+    }
+    return NullUniValue;
+}
+
+/** Handle one request line; false drops the connection */
+bool HandleLine(StratumClient& client, const std::string& strLine)
+{
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject())
+        return false;
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    UniValue params = find_value(request, "params");
+    if (!params.isArray())
+        params = UniValue(UniValue::VARR);
+    if (!method.isStr()) {
+        Reply(client, id, NullUniValue, StratumError(20, "Missing method"));
+        return true;
+    }
+
+    try {
+        const std::string& strMethod = method.get_str();
+        if (strMethod == "mining.subscribe") {
+            Reply(client, id, Subscribe(client, params), NullUniValue);
+        } else if (strMethod == "mining.authorize") {
+            if (!client.fSubscribed) {
+                Reply(client, id, NullUniValue, StratumError(25, "Not subscribed"));
+                return true;
+            }
+            bool fAuthorized = params.size() > 0 && Authorize(client, params);
+            Reply(client, id, fAuthorized, fAuthorized ? NullUniValue : StratumError(24, "Unauthorized worker"));
+            if (fAuthorized) {
+                UniValue difficulty(UniValue::VARR);
+                difficulty.push_back(client.dDifficulty);
+                Call(client, "mining.set_difficulty", difficulty);
+                std::shared_ptr<const CStratumJob> job = GetJob(client.nAlgo);
+                if (job)
+                    Notify(client, *job, true);
+            }
+        } else if (strMethod == "mining.submit") {
+            UniValue error = SubmitShare(client, params);
+            Reply(client, id, error.isNull(), error);
+        } else {
+            Reply(client, id, NullUniValue, StratumError(20, "Method not found"));
+        }
+    } catch (const std::exception& e) {
+        Reply(client, id, NullUniValue, StratumError(20, e.what()));
+    }
+    return true;
+}
+
+void Disconnect(struct bufferevent* bev)
+{
+    auto it = mapClients.find(bev);
+    if (it != mapClients.end()) {
+        LogPrint(BCLog::STRATUM, "Stratum: %s disconnected\n", it->second.strPeer);
+        mapClients.erase(it);
+    }
+    bufferevent_free(bev);
+}
+
+void ReadCallback(struct bufferevent* bev, void*)
+{
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t nLength;
+    char* line;
+    while ((line = evbuffer_readln(input, &nLength, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string strLine(line, nLength);
+        free(line);
+        if (strLine.empty())
+            continue;
+        if (!HandleLine(mapClients.at(bev), strLine)) {
+            Disconnect(bev);
+            return;
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE)
+        Disconnect(bev);
+}
+
+void EventCallback(struct bufferevent* bev, short what, void*)
+{
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        Disconnect(bev);
+}
+
+void AddClient(struct bufferevent* bev, const std::string& strPeer)
+{
+    StratumClient& client = mapClients[bev];
+    client.bev = bev;
+    client.strPeer = strPeer;
+    uint32_t nExtraNonce1 = nExtraNonce1Next++;
+    client.vchExtraNonce1.assign((unsigned char*)&nExtraNonce1, (unsigned char*)&nExtraNonce1 + STRATUM_EXTRANONCE1_SIZE);
+    client.fSubscribed = false;
+    client.fAuthorized = false;
+    client.nAlgo = miningAlgo;
+    client.dDifficulty = dDefaultDifficulty;
+    LogPrint(BCLog::STRATUM, "Stratum: %s connected\n", client.strPeer);
+}
+
+void AcceptCallback(struct evconnlistener*, evutil_socket_t fd, struct sockaddr* addr, int socklen, void*)
+{
+    struct bufferevent* bev = bufferevent_socket_new(stratumBase, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    CService peer;
+    AddClient(bev, peer.SetSockAddr(addr) ? peer.ToString() : "unknown");
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, nullptr);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+}
+
+/** Wakes the event thread to refresh jobs when the chain or the mempool moves */
+class CStratumNotifier : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        if (!fInitialDownload)
+            event_active(stratumRefresh, EV_TIMEOUT, 0);
+    }
+
+    void TransactionAddedToMempool(const CTransactionRef& ptx) override
+    {
+        // Batched like getblocktemplate, which rebuilds at most every few seconds
+        if (!event_pending(stratumRefresh, EV_TIMEOUT, nullptr)) {
+            struct timeval tv = {STRATUM_MEMPOOL_REFRESH, 0};
+            event_add(stratumRefresh, &tv);
+        }
+    }
+};
+
+std::unique_ptr<CStratumNotifier> stratumNotifier;
+
+} // namespace
+
+bool StartStratumServer()
+{
+    int nPort = gArgs.GetArg("-stratum", DEFAULT_STRATUM_PORT);
+    if (nPort <= 0)
+        return true;
+
+    std::string strBind = gArgs.GetArg("-stratumbind", DEFAULT_STRATUM_BIND);
+    CService addrBind;
+    if (!Lookup(strBind.c_str(), addrBind, nPort, false))
+        return InitError(strprintf(_("Cannot resolve -stratumbind address: '%s'"), strBind));
+    dDefaultDifficulty = atof(gArgs.GetArg("-stratumdifficulty", std::to_string(DEFAULT_STRATUM_DIFFICULTY)).c_str());
+    if (!(dDefaultDifficulty >= MIN_STRATUM_DIFFICULTY && dDefaultDifficulty <= MAX_STRATUM_DIFFICULTY))
+        return InitError(strprintf(_("-stratumdifficulty must be between %g and %g"), MIN_STRATUM_DIFFICULTY, MAX_STRATUM_DIFFICULTY));
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    stratumBase = event_base_new();
+    if (!stratumBase)
+        return InitError(_("Unable to create the stratum event base"));
+
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrBind.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        StopStratumServer();
+        return InitError(strprintf(_("Unable to bind stratum server to %s"), addrBind.ToString()));
+    }
+    stratumListener = evconnlistener_new_bind(stratumBase, AcceptCallback, nullptr, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!stratumListener) {
+        StopStratumServer();
+        return InitError(strprintf(_("Unable to bind stratum server to %s"), addrBind.ToString()));
+    }
+    stratumRefresh = event_new(stratumBase, -1, 0, RefreshJobs, nullptr);
+    nExtraNonce1Next = GetRand(std::numeric_limits<uint32_t>::max());
+
+    stratumNotifier.reset(new CStratumNotifier());
+    RegisterValidationInterface(stratumNotifier.get());
+    stratumThread = std::thread([] {
+        RenameThread("veles-stratum");
+        event_base_dispatch(stratumBase);
+    });
+    LogPrintf("Stratum server listening on %s\n", addrBind.ToString());
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (stratumBase)
+        event_base_loopbreak(stratumBase);
+}
+
+void StopStratumServer()
+{
+    if (stratumNotifier) {
+        UnregisterValidationInterface(stratumNotifier.get());
+        stratumNotifier.reset();
+    }
+    if (stratumThread.joinable()) {
+        event_base_loopbreak(stratumBase);
+        stratumThread.join();
+    }
+    for (const auto& item : mapClients)
+        bufferevent_free(item.first);
+    mapClients.clear();
+    mapJobs.clear();
+    mapAlgoJobs.clear();
+    mapJobShares.clear();
+    hashJobsTip.SetNull();
+    if (stratumRefresh) {
+        event_free(stratumRefresh);
+        stratumRefresh = nullptr;
+    }
+    if (stratumListener) {
+        evconnlistener_free(stratumListener);
+        stratumListener = nullptr;
+    }
+    if (stratumBase) {
+        event_base_free(stratumBase);
+        stratumBase = nullptr;
+    }
+}
+
+void StratumTest::AddClient(struct bufferevent* bev)
+{
+    ::AddClient(bev, "test");
+}
+
+bool StratumTest::HandleLine(struct bufferevent* bev, const std::string& strLine)
+{
+    return ::HandleLine(mapClients.at(bev), strLine);
+}
@@ -0,0 +1,79 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef VELES_STRATUM_H
+#define VELES_STRATUM_H
+
+#include <arith_uint256.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <uint256.h>
+
+#include <string>
+#include <vector>
+
+/** Port of the stratum server, 0 to run none */
+static const int DEFAULT_STRATUM_PORT = 0;
+static const std::string DEFAULT_STRATUM_BIND = "127.0.0.1";
+/** Share difficulty given to miners that don't ask for one */
+static const double DEFAULT_STRATUM_DIFFICULTY = 1.0;
+/** Share difficulties a miner may ask for; outside them the share target would not fit its arithmetic */
+static const double MIN_STRATUM_DIFFICULTY = 1.0 / 4096;
+static const double MAX_STRATUM_DIFFICULTY = 1e12;
+/** Seconds mempool changes are batched for before jobs are rebuilt, as getblocktemplate does */
+static const int STRATUM_MEMPOOL_REFRESH = 5;
+/** Bytes of extranonce the server assigns to each connection */
+static const size_t STRATUM_EXTRANONCE1_SIZE = 4;
+/** Bytes of extranonce each connection rolls within its range */
+static const size_t STRATUM_EXTRANONCE2_SIZE = 4;
+/** Shares remembered per job to catch duplicates; a job that fills up is replaced by a fresh one */
+static const size_t MAX_STRATUM_JOB_SHARES = 65536;
+
+/**
+ * Work for one algo, kept the way stratum miners rebuild it: the coinbase
+ * split around the extranonce, and the merkle branch that hashes the
+ * coinbase up to the merkle root.
+ */
+class CStratumJob
+{
+public:
+    std::string strId;
+    int nHeight;
+    /** The block template, its coinbase with a zero extranonce */
+    CBlock block;
+    std::vector<uint256> vMerkleBranch;
+
+    CStratumJob(const std::string& strIdIn, const CBlock& blockIn, int nHeightIn);
+
+    /** Coinbase paying scriptPubKey, serialized without witness and split at the extranonce */
+    void GetCoinbase(const CScript& scriptPubKey, std::vector<unsigned char>& vchCoinb1, std::vector<unsigned char>& vchCoinb2) const;
+    /** Block solved with the given extranonce1 + extranonce2, time and nonce */
+    CBlock GetBlock(const CScript& scriptPubKey, const std::vector<unsigned char>& vchExtraNonce, uint32_t nTime, uint32_t nNonce) const;
+};
+
+/**
+ * Target a share of the given difficulty must meet; difficulty 1 is 0x1d00ffff, 65536 times easier for scrypt as miners count it.
+ * The difficulty is clamped to [MIN_STRATUM_DIFFICULTY, MAX_STRATUM_DIFFICULTY].
+ */
+arith_uint256 GetStratumShareTarget(int32_t nAlgo, double dDifficulty);
+
+/** Start the stratum server on -stratum, if set */
+bool StartStratumServer();
+/** Stop accepting connections and work */
+void InterruptStratumServer();
+/** Stop the stratum server */
+void StopStratumServer();
+
+struct bufferevent;
+
+/** Lets the unit tests drive a miner session without a socket or the event thread */
+struct StratumTest
+{
+    /** Add a connection whose replies are written to bev; StopStratumServer frees it */
+    static void AddClient(struct bufferevent* bev);
+    /** Handle one request line of that connection; false if it would be dropped */
+    static bool HandleLine(struct bufferevent* bev, const std::string& strLine);
+};
+
+#endif // VELES_STRATUM_H
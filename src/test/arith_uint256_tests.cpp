@@ -359,6 +359,16 @@ BOOST_AUTO_TEST_CASE( divide )
     BOOST_CHECK(R2L / MaxL == ZeroL);
     BOOST_CHECK(MaxL / R2L == 1);
     BOOST_CHECK_THROW(R2L / ZeroL, uint_error);
+
+    // single limb divisors
+    BOOST_CHECK((R1L / 7).ToString() == "11dfb32191627a1e74dcb499ac3cede0674299e8c44bbcbd0294c34243e60bcd");
+    BOOST_CHECK((R1L / 0x87654321UL).ToString() == "00000000ec90bb52dc92ede64db1028d02ef259f50333ddc5f7180f31473bab8");
+    BOOST_CHECK((R1L / 2) * 3 / 3 == R1L / 2);
+    for (uint32_t d : {2U, 3U, 10U, 5000U, 12984U, 1973648U, 0x7fffffffU, 0xffffffffU}) {
+        const arith_uint256 q = R2L / d;
+        BOOST_CHECK(q * d <= R2L);
+        BOOST_CHECK(R2L - q * d < d);
+    }
 }
 
 
@@ -4,7 +4,9 @@
 
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
+#include <crypto/lyra2z.h>
 #include <crypto/ripemd160.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
@@ -562,4 +564,42 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(scrypt_multi)
+{
+    for (int i = 0; i <= 19; ++i) {
+        char in[80 * 19];
+        char out1[32 * 19], out2[32 * 19];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            scrypt_1024_1_1_256(in + 80 * j, out1 + 32 * j);
+        }
+        scrypt_1024_1_1_256_multi(in, out2, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lyra2z_scratchpad)
+{
+    static const char* const expected[] = {
+        "d589a56f62a65ab13b816d3531518cd8e7a53c114be052269488b473563e5535",
+        "c3fba582158e59e25b6ede75ff9155f7ee193c06a4b2a12e9c6a7f9f3ab8453f",
+        "37ba1cb6d9ee554bdac8c1574d08fc7221181e85991bfd4dbc636ae298794389",
+    };
+    // A reused scratchpad must not carry state from one hash into the next
+    alignas(32) uint64_t scratchpad[LYRA2Z_SCRATCHPAD_SIZE / 8];
+    memset(scratchpad, 0xa5, sizeof(scratchpad));
+    for (int t = 0; t < 3; ++t) {
+        unsigned char in[80], out1[32], out2[32];
+        for (int i = 0; i < 80; ++i) {
+            in[i] = t * 80 + i * 7 + t;
+        }
+        lyra2z_hash((const char*)in, (char*)out1);
+        lyra2z_hash_sp((const char*)in, (char*)out2, scratchpad);
+        BOOST_CHECK_EQUAL(HexStr(out1, out1 + 32), expected[t]);
+        BOOST_CHECK_EQUAL(HexStr(out2, out2 + 32), expected[t]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,187 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <journal-database.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct JournalTestObject
+{
+    int nBase;
+    std::vector<std::string> vBase;
+    std::map<int, std::string> mapItems;
+
+    JournalTestObject() : nBase(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nBase);
+        READWRITE(vBase);
+        READWRITE(mapItems);
+    }
+
+    template <typename Stream, typename Operation>
+    inline void JournalBaseOp(Stream& s, Operation ser_action) {
+        READWRITE(nBase);
+        READWRITE(vBase);
+    }
+
+    template <typename Journal>
+    void JournalMapsOp(Journal& journal) {
+        journal.Map(1, mapItems);
+    }
+
+    void Clear() { nBase = 0; vBase.clear(); mapItems.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("JournalTestObject(%d, %u)", nBase, mapItems.size()); }
+
+    bool operator==(const JournalTestObject& other) const { return nBase == other.nBase && vBase == other.vBase && mapItems == other.mapItems; }
+};
+
+JournalTestObject MakeObject(int nItems)
+{
+    JournalTestObject obj;
+    obj.nBase = nItems;
+    for (int i = 0; i < nItems; i++)
+        obj.mapItems[i] = std::string(100, 'a' + i % 26);
+    return obj;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(journal_database_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(journal_append_and_reload)
+{
+    SetDataDir("journal_append_and_reload");
+    ClearDatadirCache();
+    fs::path path = GetDataDir() / "journal.dat";
+
+    JournalTestObject obj = MakeObject(100);
+    CJournalDB<JournalTestObject> journal("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journal.Dump(obj));
+    uint64_t nFullSize = fs::file_size(path);
+
+    // A dump after a few changes only appends those
+    obj.nBase = 7;
+    obj.mapItems[3] = "changed";
+    obj.mapItems.erase(4);
+    obj.mapItems[1000] = "added";
+    BOOST_CHECK(journal.Dump(obj));
+    uint64_t nAppendedSize = fs::file_size(path) - nFullSize;
+    BOOST_CHECK(nAppendedSize > 0);
+    BOOST_CHECK(nAppendedSize < nFullSize / 10);
+
+    JournalTestObject objLoaded;
+    CJournalDB<JournalTestObject> journalLoaded("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journalLoaded.Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+
+    // Nothing changed, so the reloaded journal appends no entries either
+    uint64_t nSize = fs::file_size(path);
+    BOOST_CHECK(journalLoaded.Dump(objLoaded));
+    BOOST_CHECK(fs::file_size(path) - nSize < nAppendedSize);
+
+    // Once stale records outweigh live ones the file is compacted
+    for (int i = 0; i < 3; i++) {
+        for (auto& item : obj.mapItems)
+            item.second += "x";
+        BOOST_CHECK(journal.Dump(obj));
+    }
+    BOOST_CHECK(fs::file_size(path) < 3 * nFullSize);
+    JournalTestObject objCompacted;
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objCompacted));
+    BOOST_CHECK(objCompacted == obj);
+}
+
+BOOST_AUTO_TEST_CASE(journal_torn_tail)
+{
+    SetDataDir("journal_torn_tail");
+    ClearDatadirCache();
+    fs::path path = GetDataDir() / "journal.dat";
+
+    JournalTestObject obj = MakeObject(20);
+    CJournalDB<JournalTestObject> journal("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journal.Dump(obj));
+
+    // Half a dump, or garbage, after the last commit is dropped
+    FILE* file = fsbridge::fopen(path, "ab");
+    fwrite("torn record", 1, 11, file);
+    fclose(file);
+
+    JournalTestObject objLoaded;
+    CJournalDB<JournalTestObject> journalLoaded("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journalLoaded.Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+
+    // The next dump rewrites the file instead of appending after the garbage
+    objLoaded.mapItems[5] = "changed";
+    BOOST_CHECK(journalLoaded.Dump(objLoaded));
+    JournalTestObject objReloaded;
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objReloaded));
+    BOOST_CHECK(objReloaded == objLoaded);
+}
+
+BOOST_AUTO_TEST_CASE(journal_legacy_and_foreign_files)
+{
+    SetDataDir("journal_legacy_and_foreign_files");
+    ClearDatadirCache();
+
+    // Flat files are still loaded
+    JournalTestObject obj = MakeObject(10);
+    BOOST_CHECK(CFlatDB<JournalTestObject>("journal.dat", "magicJournalTest").Dump(obj));
+    JournalTestObject objLoaded;
+    CJournalDB<JournalTestObject> journal("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journal.Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+
+    // Journals of another kind are neither loaded nor overwritten
+    BOOST_CHECK(journal.Dump(objLoaded));
+    JournalTestObject objOther;
+    CJournalDB<JournalTestObject> journalOther("journal.dat", "magicOtherTest");
+    BOOST_CHECK(!journalOther.Load(objOther));
+    BOOST_CHECK(!journalOther.Dump(objOther));
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objOther));
+    BOOST_CHECK(objOther == obj);
+}
+
+BOOST_AUTO_TEST_CASE(journal_oversize_records)
+{
+    SetDataDir("journal_oversize_records");
+    ClearDatadirCache();
+    fs::path path = GetDataDir() / "journal.dat";
+
+    // A base state over the record size limit is split over several records
+    JournalTestObject obj = MakeObject(10);
+    obj.vBase.assign(3, std::string(MAX_SIZE / 2, 'b'));
+    CJournalDB<JournalTestObject> journal("journal.dat", "magicJournalTest");
+    BOOST_CHECK(journal.Dump(obj));
+    JournalTestObject objLoaded;
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+
+    // An entry over the limit fails the dump and leaves the file alone
+    uint64_t nSize = fs::file_size(path);
+    JournalTestObject objTooBig = obj;
+    objTooBig.mapItems[5] = std::string(MAX_SIZE, 'c');
+    BOOST_CHECK(!journal.Dump(objTooBig));
+    BOOST_CHECK_EQUAL(fs::file_size(path), nSize);
+    objLoaded.Clear();
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+
+    // and the next dump still erases what the file holds
+    obj.mapItems.erase(2);
+    BOOST_CHECK(journal.Dump(obj));
+    objLoaded.Clear();
+    BOOST_CHECK(CJournalDB<JournalTestObject>("journal.dat", "magicJournalTest").Load(objLoaded));
+    BOOST_CHECK(objLoaded == obj);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
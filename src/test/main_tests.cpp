@@ -6,9 +6,12 @@
 #include <chainparams.h>
 #include <validation.h>
 #include <net.h>
+#include <spork.h>
 
 #include <test/test_bitcoin.h>
 
+#include <thread>
+
 #include <boost/signals2/signal.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -79,4 +82,197 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+// VELES BEGIN
+static void CheckChainSubsidy(const Consensus::Params& consensusParams)
+{
+    CAmount nChainSubsidy = 0;
+    for (CBlockIndex* pindex = chainActive[1]; pindex; pindex = chainActive.Next(pindex)) {
+        nChainSubsidy += GetBlockSubsidy(pindex->nHeight, pindex->GetBlockHeader(), consensusParams);
+        BOOST_CHECK_EQUAL(pindex->nChainSubsidy, nChainSubsidy);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(chain_subsidy_index, TestChain100Setup)
+{
+    LOCK(cs_main);
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // Connected blocks carry the subsidy of their chain
+    CheckChainSubsidy(consensusParams);
+
+    // The tip is not counted
+    CAmount nRewards = chainActive.Tip()->pprev->nChainSubsidy - chainActive[9]->nChainSubsidy;
+    BOOST_CHECK_EQUAL(CountBlockRewards(10, chainActive.Height(), nullptr), nRewards);
+    BOOST_CHECK_EQUAL(CountBlockRewards(chainActive.Height(), chainActive.Height(), nullptr), 0);
+
+    // Without the index the chain is walked, and the index is rebuilt on startup
+    for (CBlockIndex* pindex = chainActive[1]; pindex; pindex = chainActive.Next(pindex))
+        pindex->nChainSubsidy = -1;
+    BOOST_CHECK_EQUAL(CountBlockRewards(10, chainActive.Height(), nullptr), nRewards);
+    IndexChainSubsidy(Params());
+    CheckChainSubsidy(consensusParams);
+
+    // The subsidy is not stored with the block index, as it depends on sporks
+    CDiskBlockIndex diskindex(chainActive.Tip());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << diskindex;
+    CDiskBlockIndex loaded;
+    ss >> loaded;
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK_EQUAL(loaded.nChainSubsidy, -1);
+
+    // and is indexed again from scratch when one of them changes
+    ReindexChainSubsidy(Params());
+    CheckChainSubsidy(consensusParams);
+}
+
+BOOST_FIXTURE_TEST_CASE(reward_sporks_reset_derived_values, TestChain100Setup)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    boost::signals2::scoped_connection connection = sporkManager.NotifySporkChanged.connect(&RewardSporkChanged);
+    BOOST_REQUIRE(sporkManager.SetPrivKey("8SFpqTiknk8VJ6wC5DC73izzbgUh1fB1nNz5Zrf6YMjgFmZiE7J"));
+
+    // VCIP01 from block 30 on, so that the supply of the bootstrap epoch is counted
+    BOOST_REQUIRE(sporkManager.UpdateSpork(SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START, 30, *connman));
+    CAmount nBootstrapSupply;
+    {
+        LOCK(cs_main);
+        std::shared_ptr<const HalvingParameters> params = GetSubsidyHalvingParameters(chainActive.Height());
+        BOOST_REQUIRE_EQUAL(params->epochs.size(), 3U);
+        nBootstrapSupply = params->epochs[1].nEndSupply - params->epochs[1].nStartSupply;
+    }
+
+    // Dynamic rewards from block 2 on change the rewards of blocks connected before
+    BOOST_REQUIRE(sporkManager.UpdateSpork(SPORK_VELES_01_FXTC_CHAIN_START, 2, *connman));
+    {
+        LOCK(cs_main);
+        std::shared_ptr<const HalvingParameters> params = GetSubsidyHalvingParameters(chainActive.Height());
+        BOOST_REQUIRE_EQUAL(params->epochs.size(), 3U);
+        CAmount nRewards = 0;
+        for (int nHeight = 2; nHeight < 29; nHeight++)
+            nRewards += GetBlockSubsidy(nHeight, chainActive[nHeight]->GetBlockHeader(), consensusParams);
+        BOOST_CHECK_EQUAL(params->epochs[1].nEndSupply - params->epochs[1].nStartSupply, nRewards);
+        BOOST_CHECK(nRewards != nBootstrapSupply);
+        CheckChainSubsidy(consensusParams);
+    }
+
+    // The cost factors follow the sporks as well
+    BOOST_REQUIRE(sporkManager.UpdateSpork(SPORK_VELES_05B_ADJUST_COST_FACTOR_START, 100, *connman));
+    double nScryptFactor = GetAlgoCostFactor(ALGO_SCRYPT, 100);
+    BOOST_REQUIRE(sporkManager.UpdateSpork(SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT, 500, *connman));
+    BOOST_CHECK(GetAlgoCostFactor(ALGO_SCRYPT, 100) > nScryptFactor);
+    BOOST_CHECK_EQUAL(GetAlgoCostFactor(ALGO_SCRYPT, 100), CAlgoCostFactorTable::Compute(ALGO_SCRYPT, 100));
+
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT, SPORK_VELES_05B_ADJUST_COST_FACTOR_SCRYPT_DEFAULT, *connman));
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_VELES_05B_ADJUST_COST_FACTOR_START, SPORK_VELES_05B_ADJUST_COST_FACTOR_START_DEFAULT, *connman));
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_VELES_01_FXTC_CHAIN_START, SPORK_VELES_01_FXTC_CHAIN_START_DEFAULT, *connman));
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START, SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START_DEFAULT, *connman));
+}
+
+static void CheckHalvingParameters(const HalvingParameters& params, const HalvingParameters& expected)
+{
+    BOOST_CHECK_EQUAL(params.nHalvingCount, expected.nHalvingCount);
+    BOOST_CHECK_EQUAL(params.nHalvingInterval, expected.nHalvingInterval);
+    BOOST_CHECK_EQUAL(params.nDynamicRewardsBoostFactor, expected.nDynamicRewardsBoostFactor);
+    BOOST_REQUIRE_EQUAL(params.epochs.size(), expected.epochs.size());
+    for (size_t i = 0; i < params.epochs.size(); i++) {
+        BOOST_CHECK_EQUAL(params.epochs[i].nStartBlock, expected.epochs[i].nStartBlock);
+        BOOST_CHECK_EQUAL(params.epochs[i].nEndBlock, expected.epochs[i].nEndBlock);
+        BOOST_CHECK_EQUAL(params.epochs[i].nDynamicRewardsBoostFactor, expected.epochs[i].nDynamicRewardsBoostFactor);
+        BOOST_CHECK_EQUAL(params.epochs[i].fHasEnded, expected.epochs[i].fHasEnded);
+        BOOST_CHECK_EQUAL(params.epochs[i].fIsSubsidyHalved, expected.epochs[i].fIsSubsidyHalved);
+        BOOST_CHECK_EQUAL(params.epochs[i].nMaxBlockSubsidy, expected.epochs[i].nMaxBlockSubsidy);
+        BOOST_CHECK_EQUAL(params.epochs[i].nStartSupply, expected.epochs[i].nStartSupply);
+        BOOST_CHECK_EQUAL(params.epochs[i].nEndSupply, expected.epochs[i].nEndSupply);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(halving_epoch_table)
+{
+    Consensus::Params consensusParams = Params().GetConsensus();
+    consensusParams.nSubsidyHalvingInterval = 10;
+    const int nHeightOffset = 20;
+    const int nHeights = 1000;
+
+    // Blocks pay 90% of the epoch maximum, enough to halve, and blocks from
+    // nReorgHeight on pay 10%, which boosts the dynamic rewards instead
+    int nReorgHeight = nHeights;
+    CHalvingEpochTable::RewardCounter countRewards = [&nReorgHeight](int nStartBlock, int nEndBlock, const HalvingParameters *halvingParams) {
+        CAmount nRewards = 0;
+        for (int nHeight = nStartBlock; nHeight <= nEndBlock; nHeight++)
+            nRewards += halvingParams->epochs.back().nMaxBlockSubsidy * (nHeight < nReorgHeight ? 9 : 1) / 10;
+        return nRewards;
+    };
+
+    // Replay the chain: every height gets what a table built from scratch returns,
+    // and heights of an epoch share one snapshot
+    CHalvingEpochTable table;
+    std::vector<std::shared_ptr<const HalvingParameters>> vSnapshots;
+    for (int nHeight = 0; nHeight < nHeights; nHeight++) {
+        std::shared_ptr<const HalvingParameters> params = table.Get(nHeight, nHeight - 1, nHeightOffset, consensusParams, countRewards);
+        CheckHalvingParameters(*params, *CHalvingEpochTable().Get(nHeight, nHeight - 1, nHeightOffset, consensusParams, countRewards));
+        BOOST_CHECK(nHeight >= params->epochs.back().nStartBlock || params->epochs.size() == 2);
+        BOOST_CHECK(nHeight <= params->epochs.back().nEndBlock);
+        if (vSnapshots.empty() || vSnapshots.back() != params)
+            vSnapshots.push_back(params);
+        BOOST_CHECK(table.Get(nHeight, nHeights, nHeightOffset, consensusParams, countRewards) == params);
+    }
+    BOOST_CHECK(vSnapshots.back()->nHalvingCount > 1);
+    BOOST_CHECK_EQUAL(vSnapshots.back()->nDynamicRewardsBoostFactor, 0);
+
+    // Epochs counting blocks above the tip are not kept
+    CHalvingEpochTable tableAhead;
+    std::shared_ptr<const HalvingParameters> paramsAhead = tableAhead.Get(nHeights - 1, nHeightOffset, nHeightOffset, consensusParams, countRewards);
+    CheckHalvingParameters(*paramsAhead, *vSnapshots.back());
+    BOOST_CHECK(tableAhead.Get(nHeights - 1, nHeightOffset, nHeightOffset, consensusParams, countRewards) != paramsAhead);
+
+    // Reorganize the chain from the middle of an epoch: the epochs counting
+    // the replaced blocks are rebuilt, the ones before are kept
+    nReorgHeight = vSnapshots[vSnapshots.size() / 2]->epochs.back().nStartBlock + 3;
+    table.Invalidate(nReorgHeight);
+    for (int nHeight = 0; nHeight < nHeights; nHeight++) {
+        std::shared_ptr<const HalvingParameters> params = table.Get(nHeight, nHeight - 1, nHeightOffset, consensusParams, countRewards);
+        CheckHalvingParameters(*params, *CHalvingEpochTable().Get(nHeight, nHeight - 1, nHeightOffset, consensusParams, countRewards));
+        bool fCountsReorg = params->epochs.size() > 2 && params->epochs[params->epochs.size() - 2].nEndBlock > nReorgHeight;
+        BOOST_CHECK_EQUAL(std::count(vSnapshots.begin(), vSnapshots.end(), params), fCountsReorg ? 0 : 1);
+    }
+    BOOST_CHECK(table.Get(nHeights - 1, nHeights, nHeightOffset, consensusParams, countRewards)->nDynamicRewardsBoostFactor > 0);
+
+    // A new VCIP01 start height rebuilds the table
+    std::shared_ptr<const HalvingParameters> params = table.Get(nHeights - 1, nHeights, nHeightOffset + 5, consensusParams, countRewards);
+    CheckHalvingParameters(*params, *CHalvingEpochTable().Get(nHeights - 1, nHeights, nHeightOffset + 5, consensusParams, countRewards));
+    BOOST_CHECK_EQUAL(params->epochs[2].nStartBlock, nHeightOffset + 5);
+}
+
+BOOST_AUTO_TEST_CASE(algo_cost_factor_table)
+{
+    CAlgoCostFactorTable table;
+    const int32_t vAlgos[] = {ALGO_SHA256D, ALGO_SCRYPT, ALGO_NIST5, ALGO_LYRA2Z, ALGO_X11, ALGO_X16R, ALGO_NULL, ALGO_X16R + 1, ALGO_X11 | 1, -1};
+    const int vHeights[] = {0, 1, 50999, 51000, 51001, 1000000, std::numeric_limits<int>::max()};
+
+    for (int32_t nAlgo : vAlgos) {
+        for (int nHeight : vHeights)
+            BOOST_CHECK_EQUAL(table.Get(nAlgo, nHeight), CAlgoCostFactorTable::Compute(nAlgo, nHeight));
+    }
+
+    // The Nist5 bump-up gives it a larger share of the total
+    BOOST_CHECK(table.Get(ALGO_NIST5, 51000) > table.Get(ALGO_NIST5, 50999));
+    BOOST_CHECK(table.Get(ALGO_SHA256D, 51000) < table.Get(ALGO_SHA256D, 50999));
+    BOOST_CHECK_EQUAL(GetAlgoCostFactor(ALGO_X11, 51000), table.Get(ALGO_X11, 51000));
+
+    // Lookups do not lock, so they keep reading a complete table while it is rebuilt
+    const double nX11Factor = CAlgoCostFactorTable::Compute(ALGO_X11, 51000);
+    std::thread rebuilder([&table] {
+        for (int i = 0; i < 1000; i++)
+            table.Rebuild();
+    });
+    int nMismatches = 0;
+    for (int i = 0; i < 100000; i++)
+        nMismatches += table.Get(ALGO_X11, 51000) != nX11Factor;
+    rebuilder.join();
+    BOOST_CHECK_EQUAL(nMismatches, 0);
+}
+// VELES END
+
 BOOST_AUTO_TEST_SUITE_END()
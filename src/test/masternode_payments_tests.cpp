@@ -0,0 +1,101 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternode-payments.h>
+
+#include <chain.h>
+#include <journal-database.h>
+#include <validation.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_payments_tests, BasicTestingSetup)
+
+static CTransaction PayMasternode(int nHeight, const CScript& payee)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.SetNull();
+    tx.vout.resize(2);
+    tx.vout[1].nValue = GetMasternodePayment(nHeight, 100 * COIN);
+    tx.vout[1].scriptPubKey = payee;
+    tx.vout[0].nValue = 100 * COIN - tx.vout[1].nValue;
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    return CTransaction(tx);
+}
+
+static void AddVotes(CMasternodePayments& payments, int nHeight, const CScript& payee, int nVotes)
+{
+    CMasternodeBlockPayees& blockPayees = payments.mapMasternodeBlocks[nHeight];
+    blockPayees.nBlockHeight = nHeight;
+    for (int i = 0; i < nVotes; i++)
+        blockPayees.AddPayee(CMasternodePaymentVote(COutPoint(InsecureRand256(), i), nHeight, payee));
+}
+
+BOOST_AUTO_TEST_CASE(masternode_paid_blocks)
+{
+    CMasternodePayments payments;
+    CScript payeeA = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0xaa) << OP_EQUALVERIFY << OP_CHECKSIG;
+    CScript payeeB = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0xbb) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    const int nBlocks = 300;
+    std::vector<uint256> hashes(nBlocks + 1);
+    std::vector<CBlockIndex> blocks(nBlocks + 1);
+    for (int i = 0; i <= nBlocks; i++) {
+        hashes[i] = InsecureRand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = 1538000000 + i;
+        blocks[i].BuildSkip();
+    }
+    // The last block forks off at the height of the one before
+    blocks[nBlocks].pprev = &blocks[nBlocks - 2];
+    blocks[nBlocks].nHeight = nBlocks - 1;
+    blocks[nBlocks].BuildSkip();
+    const CBlockIndex* pindexTip = &blocks[nBlocks - 1];
+    const CBlockIndex* pindexFork = &blocks[nBlocks];
+
+    // A is paid every 10 blocks, B otherwise; A has a single vote at height 280
+    for (int nHeight = 100; nHeight < nBlocks; nHeight++) {
+        const CScript& payee = nHeight % 10 == 0 ? payeeA : payeeB;
+        AddVotes(payments, nHeight, payee, nHeight == 280 ? 1 : 2);
+        payments.AddPaidBlock(nHeight, blocks[nHeight].GetBlockHash(), PayMasternode(nHeight, payee));
+    }
+
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeA, pindexTip, 1000, 0), &blocks[290]);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeA, &blocks[289], 1000, 0), &blocks[270]);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeB, pindexTip, 1000, 0), &blocks[299]);
+    // Limited by the scan window and the height last paid at
+    BOOST_CHECK(payments.GetLastPaidBlock(payeeA, pindexTip, 9, 0) == nullptr);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeA, pindexTip, 10, 0), &blocks[290]);
+    BOOST_CHECK(payments.GetLastPaidBlock(payeeA, pindexTip, 1000, 290) == nullptr);
+    BOOST_CHECK(payments.GetLastPaidBlock(payeeA, &blocks[99], 1000, 0) == nullptr);
+
+    // A block replacing the tip records its own payment; the old tip is not counted
+    // for the chain it left, and the new one is not counted for the old chain
+    payments.AddPaidBlock(nBlocks - 1, pindexFork->GetBlockHash(), PayMasternode(nBlocks - 1, payeeA));
+    AddVotes(payments, nBlocks - 1, payeeA, 2);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeA, pindexFork, 1000, 0), pindexFork);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeA, pindexTip, 1000, 0), &blocks[290]);
+    BOOST_CHECK_EQUAL(payments.GetLastPaidBlock(payeeB, pindexTip, 1000, 0), &blocks[298]);
+
+    // Only the paid blocks are stored, the reverse index is rebuilt when they are loaded
+    SetDataDir("masternode_paid_blocks");
+    ClearDatadirCache();
+    BOOST_CHECK(CJournalDB<CMasternodePayments>("mnpayments.dat", "magicMasternodePaymentsCache").Dump(payments));
+    CMasternodePayments paymentsLoaded;
+    BOOST_CHECK(CJournalDB<CMasternodePayments>("mnpayments.dat", "magicMasternodePaymentsCache").Load(paymentsLoaded));
+    BOOST_CHECK_EQUAL(paymentsLoaded.mapPaidBlocks.size(), payments.mapPaidBlocks.size());
+    BOOST_CHECK(!paymentsLoaded.mapPayeeHeights.empty());
+    BOOST_CHECK(paymentsLoaded.mapPayeeHeights == payments.mapPayeeHeights);
+
+    // Nothing else rebuilds it
+    paymentsLoaded.mapPayeeHeights.clear();
+    paymentsLoaded.CheckAndRemove();
+    BOOST_CHECK(paymentsLoaded.mapPayeeHeights.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
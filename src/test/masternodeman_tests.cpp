@@ -0,0 +1,174 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodeman.h>
+
+#include <key.h>
+#include <netbase.h>
+#include <test/test_bitcoin.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternodeman_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(masternode_list_snapshot_query)
+{
+    std::vector<CPubKey> vPubKeys;
+    for (int i = 0; i < 3; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        vPubKeys.push_back(key.GetPubKey());
+    }
+
+    // 12 masternodes on 4 addresses, cycling through payees, states and protocols
+    CMasternodeListSnapshot::masternode_map_t mapMasternodes;
+    for (int i = 0; i < 12; i++) {
+        CService addr = LookupNumeric(strprintf("1.2.3.%d", i % 4).c_str(), 25522);
+        COutPoint outpoint(InsecureRand256(), i);
+        CMasternode mn(addr, outpoint, vPubKeys[i % 3], vPubKeys[0], 70200 + i % 2);
+        mn.nActiveState = i % 2 ? CMasternode::MASTERNODE_ENABLED : CMasternode::MASTERNODE_EXPIRED;
+        mapMasternodes.emplace(outpoint, std::make_shared<const CMasternode>(mn));
+    }
+    const CMasternodeListSnapshot snapshot(std::move(mapMasternodes));
+    BOOST_CHECK_EQUAL(snapshot.size(), 12U);
+
+    // Unfiltered query walks the whole list in outpoint order
+    std::vector<const CMasternode*> vecAll = snapshot.Query(CMasternodeFilter());
+    BOOST_CHECK_EQUAL(vecAll.size(), 12U);
+    auto it = snapshot.mapMasternodes.begin();
+    for (const CMasternode* pmn : vecAll) {
+        BOOST_CHECK(pmn == (it++)->second.get());
+    }
+
+    // Every combination of filters matches exactly what a linear scan finds
+    for (int nState : {-1, (int)CMasternode::MASTERNODE_ENABLED, (int)CMasternode::MASTERNODE_POSE_BAN}) {
+        for (int nProtocol : {-1, 70200, 70201}) {
+            for (int nMinProtocol : {-1, 70201, 70202}) {
+                for (int nPayee = -1; nPayee < 3; nPayee++) {
+                    for (int nAddr = -1; nAddr < 5; nAddr++) {
+                        CMasternodeFilter filter;
+                        filter.nActiveState = nState;
+                        filter.nProtocolVersion = nProtocol;
+                        filter.nMinProtocolVersion = nMinProtocol;
+                        if (nPayee >= 0) filter.payee = vPubKeys[nPayee].GetID();
+                        if (nAddr >= 0) filter.addr = LookupNumeric(strprintf("1.2.3.%d", nAddr).c_str(), 25522);
+
+                        std::vector<const CMasternode*> vecExpected;
+                        for (const auto& mnpair : snapshot.mapMasternodes) {
+                            if (filter.Matches(*mnpair.second))
+                                vecExpected.push_back(mnpair.second.get());
+                        }
+                        BOOST_CHECK(snapshot.Query(filter) == vecExpected);
+                    }
+                }
+            }
+        }
+    }
+
+    CMasternodeFilter filter;
+    filter.nActiveState = CMasternode::MASTERNODE_ENABLED;
+    filter.payee = vPubKeys[1].GetID();
+    BOOST_CHECK_EQUAL(snapshot.Query(filter).size(), 2U);
+    filter.nMinProtocolVersion = 70201;
+    BOOST_CHECK_EQUAL(snapshot.Query(filter).size(), 2U);
+    filter.nProtocolVersion = 70200;
+    BOOST_CHECK(snapshot.Query(filter).empty());
+}
+
+BOOST_AUTO_TEST_CASE(masternode_list_snapshot_shared)
+{
+    CMasternodeMan mnman;
+    CMasternodeMan::list_snapshot_ptr_t pSnapshot = mnman.GetMasternodeListSnapshot();
+    BOOST_CHECK_EQUAL(pSnapshot->size(), 0U);
+    // Unchanged list hands out the same snapshot
+    BOOST_CHECK(mnman.GetMasternodeListSnapshot() == pSnapshot);
+
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternode mn(LookupNumeric("1.2.3.4", 25522), COutPoint(InsecureRand256(), 0), key.GetPubKey(), key.GetPubKey(), 70200);
+    BOOST_CHECK(mnman.Add(mn));
+    CMasternodeMan::list_snapshot_ptr_t pSnapshotNew = mnman.GetMasternodeListSnapshot();
+    BOOST_CHECK(pSnapshotNew != pSnapshot);
+    BOOST_CHECK_EQUAL(pSnapshotNew->size(), 1U);
+    // Readers holding the old snapshot keep it intact
+    BOOST_CHECK_EQUAL(pSnapshot->size(), 0U);
+
+    CMasternode mn2(LookupNumeric("1.2.3.5", 25522), COutPoint(InsecureRand256(), 0), key.GetPubKey(), key.GetPubKey(), 70200);
+    BOOST_CHECK(mnman.Add(mn2));
+    pSnapshot = mnman.GetMasternodeListSnapshot();
+    BOOST_CHECK_EQUAL(pSnapshot->size(), 2U);
+    // Unchanged masternodes are shared with the previous snapshot
+    BOOST_CHECK(pSnapshot->mapMasternodes.at(mn.vin.prevout) == pSnapshotNew->mapMasternodes.at(mn.vin.prevout));
+
+    // Read-only lookups keep the snapshot
+    BOOST_CHECK(!mnman.IsMasternodePingedWithin(mn.vin.prevout, 60));
+    BOOST_CHECK(mnman.GetMasternodeListSnapshot() == pSnapshot);
+
+    // Changing one masternode copies only that one
+    BOOST_CHECK(mnman.AllowMixing(mn2.vin.prevout));
+    pSnapshotNew = mnman.GetMasternodeListSnapshot();
+    BOOST_CHECK(pSnapshotNew != pSnapshot);
+    BOOST_CHECK(pSnapshotNew->mapMasternodes.at(mn.vin.prevout) == pSnapshot->mapMasternodes.at(mn.vin.prevout));
+    BOOST_CHECK(pSnapshotNew->mapMasternodes.at(mn2.vin.prevout) != pSnapshot->mapMasternodes.at(mn2.vin.prevout));
+    BOOST_CHECK_EQUAL(pSnapshotNew->mapMasternodes.at(mn2.vin.prevout)->nLastDsq, 1);
+    BOOST_CHECK_EQUAL(pSnapshot->mapMasternodes.at(mn2.vin.prevout)->nLastDsq, 0);
+
+    mnman.Clear();
+    BOOST_CHECK_EQUAL(mnman.GetMasternodeListSnapshot()->size(), 0U);
+}
+
+template <typename T>
+static std::vector<unsigned char> SerializeNetwork(const T& obj)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(masternode_relay_messages)
+{
+    CMasternodeMan mnman;
+    CKey key;
+    key.MakeNewKey(true);
+    CMasternodeBroadcast mnb(LookupNumeric("1.2.3.4", 25522), COutPoint(InsecureRand256(), 0), key.GetPubKey(), key.GetPubKey(), 70200);
+    CMasternodePing mnp;
+    mnp.vin = mnb.vin;
+    mnp.sigTime = 1000;
+    mnb.lastPing = mnp;
+    const uint256 hashMnb = mnb.GetHash();
+    const uint256 hashMnp = mnp.GetHash();
+    BOOST_CHECK(!mnman.GetMasternodeBroadcastMessage(hashMnb));
+    BOOST_CHECK(!mnman.GetMasternodePingMessage(hashMnp));
+
+    mnman.mapSeenMasternodeBroadcast.emplace(hashMnb, std::make_pair(GetTime(), mnb));
+    mnman.mapSeenMasternodePing.emplace(hashMnp, mnp);
+    CSharedNetMsgRef msgMnb = mnman.GetMasternodeBroadcastMessage(hashMnb);
+    CSharedNetMsgRef msgMnp = mnman.GetMasternodePingMessage(hashMnp);
+    BOOST_REQUIRE(msgMnb && msgMnp);
+    BOOST_CHECK_EQUAL(msgMnb->command, NetMsgType::MNANNOUNCE);
+    BOOST_CHECK(msgMnb->data == SerializeNetwork(mnb));
+    BOOST_CHECK_EQUAL(msgMnp->command, NetMsgType::MNPING);
+    BOOST_CHECK(msgMnp->data == SerializeNetwork(mnp));
+    // Serialized once for all requests
+    BOOST_CHECK(mnman.GetMasternodeBroadcastMessage(hashMnb) == msgMnb);
+    BOOST_CHECK(mnman.GetMasternodePingMessage(hashMnp) == msgMnp);
+
+    // A newer ping changes the seen broadcast but not its hash
+    mnp.sigTime = 2000;
+    mnb.lastPing = mnp;
+    BOOST_CHECK(mnb.GetHash() == hashMnb);
+    mnman.mapSeenMasternodeBroadcast[hashMnb].second.lastPing = mnp;
+    CSharedNetMsgRef msgMnbNew = mnman.GetMasternodeBroadcastMessage(hashMnb);
+    BOOST_REQUIRE(msgMnbNew);
+    BOOST_CHECK(msgMnbNew != msgMnb);
+    BOOST_CHECK(msgMnbNew->data == SerializeNetwork(mnb));
+    // Readers holding the old message keep it intact
+    BOOST_CHECK(msgMnb->data != msgMnbNew->data);
+
+    mnman.Clear();
+    BOOST_CHECK(!mnman.GetMasternodeBroadcastMessage(hashMnb));
+    BOOST_CHECK(!mnman.GetMasternodePingMessage(hashMnp));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include <miner.h>
 #include <policy/policy.h>
 #include <pubkey.h>
+#include <script/sign.h>
 #include <script/standard.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -521,4 +522,68 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;*/
 }
 
+// VELES BEGIN
+BOOST_FIXTURE_TEST_CASE(CreateNewBlock_cached_packages, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // A mature coinbase spend and its child
+    std::vector<CMutableTransaction> spends(2);
+    for (int i = 0; i < 2; i++) {
+        spends[i].nVersion = 1;
+        spends[i].vin.resize(1);
+        spends[i].vin[0].prevout.hash = i == 0 ? m_coinbase_txns[0]->GetHash() : spends[0].GetHash();
+        spends[i].vin[0].prevout.n = 0;
+        spends[i].vout.resize(1);
+        spends[i].vout[0].nValue = (11 - i) * CENT;
+        spends[i].vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spends[i], 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spends[i].vin[0].scriptSig << vchSig;
+    }
+
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(spends[0]), nullptr, nullptr, true, 0));
+    }
+
+    // Templates for every algo carry the same transactions, only the coinbase and header differ
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2U);
+    for (int32_t nAlgo : {ALGO_SHA256D, ALGO_SCRYPT, ALGO_NIST5, ALGO_LYRA2Z, ALGO_X11, ALGO_X16R}) {
+        std::unique_ptr<CBlockTemplate> pblocktemplateAlgo = BlockAssembler(chainparams, nAlgo).CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplateAlgo->block.vtx.size(), 2U);
+        BOOST_CHECK(pblocktemplateAlgo->block.vtx[1] == pblocktemplate->block.vtx[1]);
+        BOOST_CHECK(pblocktemplateAlgo->vTxFees == pblocktemplate->vTxFees);
+        BOOST_CHECK(pblocktemplateAlgo->vTxSigOpsCost == pblocktemplate->vTxSigOpsCost);
+        LOCK(cs_main);
+        CAmount nBlockReward = GetBlockSubsidy(chainActive.Height() + 1, pblocktemplateAlgo->block.GetBlockHeader(), chainparams.GetConsensus());
+        BOOST_CHECK_EQUAL(pblocktemplateAlgo->block.vtx[0]->GetValueOut(), nBlockReward - pblocktemplateAlgo->vTxFees[0]);
+        // Checked without its scripts, it is still a block the full checks accept
+        CValidationState state;
+        BOOST_CHECK(TestBlockValidity(state, chainparams, pblocktemplateAlgo->block, chainActive.Tip(), false, false));
+    }
+
+    // A mempool change selects the transactions again
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(spends[1]), nullptr, nullptr, true, 0));
+    }
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3U);
+
+    // So does a new tip, which confirms both transactions
+    CreateAndProcessBlock(spends, scriptPubKey);
+    BOOST_CHECK_EQUAL(mempool.size(), 0U);
+    pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1U);
+}
+// VELES END
+
 BOOST_AUTO_TEST_SUITE_END()
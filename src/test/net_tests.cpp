@@ -14,6 +14,22 @@
 #include <util.h>
 
 #include <memory>
+// VELES BEGIN
+#include <condition_variable>
+#include <consensus/validation.h>
+#include <governance-vote.h>
+#include <masternode.h>
+#include <masternode-sync.h>
+#include <masternodeman.h>
+#include <messagesigner.h>
+#include <miner.h>
+#include <net_processing.h>
+#include <netmessagemaker.h>
+#include <numeric>
+#include <pow.h>
+#include <thread>
+#include <validation.h>
+// VELES END
 
 class CAddrManSerializationMock : public CAddrMan
 {
@@ -227,4 +243,321 @@ BOOST_AUTO_TEST_CASE(ipv4_peer_with_ipv6_addrMe_test)
     BOOST_CHECK(1);
 }
 
+BOOST_AUTO_TEST_CASE(net_message_type_ids)
+{
+    const std::vector<std::string>& allMessages = getAllNetMessageTypes();
+    for (size_t i = 0; i < allMessages.size(); i++) {
+        BOOST_CHECK_EQUAL(GetNetMessageTypeId(allMessages[i]), (int)i);
+    }
+    BOOST_CHECK_EQUAL(GetNetMessageTypeId(""), NET_MESSAGE_TYPE_UNKNOWN);
+    BOOST_CHECK_EQUAL(GetNetMessageTypeId("mnb2"), NET_MESSAGE_TYPE_UNKNOWN);
+
+    // The id is interned when the header is parsed
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_CHECK_EQUAL(msg.nCommandId, NET_MESSAGE_TYPE_UNKNOWN);
+    CDataStream ssHeader(SER_NETWORK, INIT_PROTO_VERSION);
+    ssHeader << CMessageHeader(Params().MessageStart(), NetMsgType::MNPING, 0);
+    BOOST_CHECK_EQUAL(msg.readHeader(ssHeader.data(), ssHeader.size()), (int)ssHeader.size());
+    BOOST_CHECK_EQUAL(msg.nCommandId, GetNetMessageTypeId(NetMsgType::MNPING));
+}
+
+/** Records the order the masternode message threads process messages in */
+class CMasternodeMessageRecorder final : public NetEventsInterface
+{
+public:
+    std::mutex mutex;
+    std::condition_variable cond;
+    /** Sequence numbers in processing order, by (node, priority) */
+    std::map<std::pair<NodeId, int>, std::vector<int> > mapProcessed;
+    std::vector<int> vPriorities;
+    std::set<std::pair<NodeId, int> > setInFlight;
+    bool fOverlap = false;
+    bool fHold = false;
+    bool fHeld = false;
+    size_t nProcessed = 0;
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override { return false; }
+    bool SendMessages(CNode* pnode) override { return false; }
+    void InitializeNode(CNode* pnode) override {}
+    void FinalizeNode(NodeId id, bool& update_connection_time) override {}
+
+    void ProcessMasternodeMessage(CNode* pnode, CNetMessage& msg, std::atomic<bool>& interrupt) override
+    {
+        int nPriority, nSequence;
+        msg.vRecv >> nPriority >> nSequence;
+        const auto key = std::make_pair(pnode->GetId(), nPriority);
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fOverlap |= !setInFlight.insert(key).second;
+            fHeld = true;
+            cond.notify_all();
+            cond.wait(lock, [this] { return !fHold; });
+        }
+        std::this_thread::yield();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            setInFlight.erase(key);
+            mapProcessed[key].push_back(nSequence);
+            vPriorities.push_back(nPriority);
+            nProcessed++;
+        }
+        cond.notify_all();
+    }
+
+    bool WaitProcessed(size_t nCount)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cond.wait_for(lock, std::chrono::seconds(60), [this, nCount] { return nProcessed == nCount; });
+    }
+};
+
+static void PushMasternodeTestMessage(CConnman& connman, CNode* pnode, int nPriority, int nSequence)
+{
+    std::list<CNetMessage> msgs;
+    msgs.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    msgs.front().vRecv << nPriority << nSequence;
+    connman.PushMasternodeMessage(pnode, msgs, (MasternodeMessagePriority)nPriority);
+}
+
+static std::vector<std::unique_ptr<CNode> > MakeMasternodeTestNodes(int nCount)
+{
+    std::vector<std::unique_ptr<CNode> > vNodes;
+    for (NodeId id = 0; id < nCount; id++) {
+        CAddress addr(CService(LookupNumeric(strprintf("10.0.0.%d", id + 1).c_str(), 7777)), NODE_NETWORK);
+        vNodes.emplace_back(new CNode(id, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true));
+    }
+    return vNodes;
+}
+
+BOOST_AUTO_TEST_CASE(masternode_message_priorities)
+{
+    CMasternodeMessageRecorder recorder;
+    std::vector<std::unique_ptr<CNode> > vNodes = MakeMasternodeTestNodes(4);
+    CConnman connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.m_msgproc = &recorder;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.nMasternodeMessageThreads = 1;
+    connman.Init(options);
+    CConnmanTest::StartMasternodeMessageThreads(connman);
+
+    // Keep the only thread busy until all the others are queued
+    recorder.fHold = true;
+    PushMasternodeTestMessage(connman, vNodes[0].get(), MNMSG_PRIORITY_GOVERNANCE, -1);
+    {
+        std::unique_lock<std::mutex> lock(recorder.mutex);
+        recorder.cond.wait(lock, [&recorder] { return recorder.fHeld; });
+    }
+    for (int nPriority = MNMSG_PRIORITY_COUNT - 1; nPriority >= 0; nPriority--) {
+        for (const auto& pnode : vNodes) {
+            for (int i = 0; i < 10; i++)
+                PushMasternodeTestMessage(connman, pnode.get(), nPriority, i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        recorder.fHold = false;
+    }
+    recorder.cond.notify_all();
+    BOOST_REQUIRE(recorder.WaitProcessed(1 + MNMSG_PRIORITY_COUNT * vNodes.size() * 10));
+
+    // Higher priorities went first, whichever order they were queued in
+    BOOST_CHECK(std::is_sorted(recorder.vPriorities.begin() + 1, recorder.vPriorities.end()));
+}
+
+BOOST_AUTO_TEST_CASE(masternode_message_flood_ordering)
+{
+    static const int MESSAGES_PER_QUEUE = 300;
+
+    CMasternodeMessageRecorder recorder;
+    std::vector<std::unique_ptr<CNode> > vNodes = MakeMasternodeTestNodes(8);
+    CConnman connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.m_msgproc = &recorder;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.nMasternodeMessageThreads = 4;
+    connman.Init(options);
+    CConnmanTest::StartMasternodeMessageThreads(connman);
+
+    for (int i = 0; i < MESSAGES_PER_QUEUE; i++) {
+        for (const auto& pnode : vNodes) {
+            for (int nPriority = 0; nPriority < MNMSG_PRIORITY_COUNT; nPriority++)
+                PushMasternodeTestMessage(connman, pnode.get(), nPriority, i);
+        }
+    }
+    BOOST_REQUIRE(recorder.WaitProcessed(MNMSG_PRIORITY_COUNT * vNodes.size() * MESSAGES_PER_QUEUE));
+
+    // A peer's messages of one priority were processed in order, never two at a time
+    BOOST_CHECK(!recorder.fOverlap);
+    BOOST_CHECK_EQUAL(recorder.mapProcessed.size(), MNMSG_PRIORITY_COUNT * vNodes.size());
+    for (const auto& pairProcessed : recorder.mapProcessed) {
+        std::vector<int> vExpected(MESSAGES_PER_QUEUE);
+        std::iota(vExpected.begin(), vExpected.end(), 0);
+        BOOST_CHECK(pairProcessed.second == vExpected);
+    }
+    // Queued messages counted against the receive buffer until processed, and held a node reference
+    connman.Interrupt();
+    connman.Stop();
+    for (const auto& pnode : vNodes) {
+        LOCK(pnode->cs_vProcessMsg);
+        BOOST_CHECK_EQUAL(pnode->nProcessQueueSize, 0U);
+        BOOST_CHECK(!pnode->fPauseRecv);
+        BOOST_CHECK_EQUAL(pnode->GetRefCount(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(shared_net_message)
+{
+    CConnman connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    connman.Init(options);
+    std::vector<std::unique_ptr<CNode> > vNodes = MakeMasternodeTestNodes(2);
+
+    const uint64_t nNonce = 42;
+    CSharedNetMsgRef msg = MakeSharedNetMsg(NetMsgType::PING, nNonce);
+    BOOST_CHECK_EQUAL(msg->command, NetMsgType::PING);
+    BOOST_CHECK(msg->data == CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::PING, nNonce).data);
+
+    // The header is ready to go, checksum included
+    CMessageHeader hdr(Params().MessageStart());
+    CDataStream(msg->header, SER_NETWORK, INIT_PROTO_VERSION) >> hdr;
+    BOOST_CHECK(hdr.IsValid(Params().MessageStart()));
+    BOOST_CHECK_EQUAL(hdr.GetCommand(), NetMsgType::PING);
+    BOOST_CHECK_EQUAL(hdr.nMessageSize, msg->data.size());
+    uint256 hash = Hash(msg->data.begin(), msg->data.end());
+    BOOST_CHECK(memcmp(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE) == 0);
+
+    // Every peer's send queue points into the one message
+    for (const auto& pnode : vNodes)
+        connman.PushMessage(pnode.get(), msg);
+    for (const auto& pnode : vNodes) {
+        LOCK(pnode->cs_vSend);
+        BOOST_REQUIRE_EQUAL(pnode->vSendMsg.size(), 2U);
+        BOOST_CHECK(pnode->vSendMsg[0].get() == &msg->header);
+        BOOST_CHECK(pnode->vSendMsg[1].get() == &msg->data);
+        BOOST_CHECK_EQUAL(pnode->nSendSize, msg->data.size() + CMessageHeader::HEADER_SIZE);
+    }
+    BOOST_CHECK_EQUAL(msg.use_count(), 5);
+}
+
+/** Serialize a message through a CDataStream, as masternode pings need */
+template <typename T>
+static CSerializedNetMsg MakeStreamMessage(const std::string& strCommand, const T& obj)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << obj;
+    CSerializedNetMsg msg;
+    msg.command = strCommand;
+    msg.data.assign(ss.begin(), ss.end());
+    return msg;
+}
+
+/**
+ * Have a peer flood signed pings of known masternodes and unrequested governance
+ * votes, then relay a block, and time the message handler until the block is
+ * connected. The flood is processed in full either way.
+ */
+static int64_t ProcessBlockBehindMasternodeFlood(CConnman& connman, PeerLogicValidation& peerLogic, NodeId id, int nMasternodeMessageThreads)
+{
+    static const int FLOOD_MESSAGES = 3000;
+
+    const CChainParams& chainparams = Params();
+    CBlock block = BlockAssembler(chainparams).CreateNewBlock(CScript() << OP_TRUE)->block;
+    int nHeight;
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        unsigned int nExtraNonce = 0;
+        IncrementExtraNonce(&block, chainActive.Tip(), nExtraNonce);
+        nHeight = chainActive.Height();
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+    while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+
+    CConnman::Options options;
+    options.m_msgproc = &peerLogic;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.nMasternodeMessageThreads = nMasternodeMessageThreads;
+    connman.Init(options);
+    if (nMasternodeMessageThreads > 0)
+        CConnmanTest::StartMasternodeMessageThreads(connman);
+
+    CNode node(id, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(LookupNumeric("10.0.0.1", 7777)), NODE_NETWORK), 0, 0, CAddress(), "", true);
+    node.SetSendVersion(PROTOCOL_VERSION);
+    node.nVersion = PROTOCOL_VERSION;
+    node.fSuccessfullyConnected = true;
+    peerLogic.InitializeNode(&node);
+
+    // Signed without CMasternodePing::Sign, which would leave the signature cached as valid
+    CKey key;
+    key.MakeNewKey(true);
+    for (int i = 0; i < FLOOD_MESSAGES; i++) {
+        COutPoint outpoint(InsecureRand256(), 0);
+        CMasternode mn(LookupNumeric("1.2.3.4", 25522), outpoint, key.GetPubKey(), key.GetPubKey(), PROTOCOL_VERSION);
+        mn.nActiveState = CMasternode::MASTERNODE_ENABLED;
+        BOOST_REQUIRE(mnodeman.Add(mn));
+        CMasternodePing mnp(outpoint);
+        mnp.blockHash = hashTip;
+        mnp.sigTime = GetAdjustedTime();
+        BOOST_REQUIRE(CMessageSigner::SignMessage(mnp.GetSignatureMessage(), mnp.vchSig, key));
+        CConnmanTest::ReceiveMessage(node, MakeStreamMessage(NetMsgType::MNPING, mnp));
+        CGovernanceVote vote(COutPoint(InsecureRand256(), 0), InsecureRand256(), VOTE_SIGNAL_FUNDING, VOTE_OUTCOME_YES);
+        CConnmanTest::ReceiveMessage(node, MakeStreamMessage(NetMsgType::MNGOVERNANCEOBJECTVOTE, vote));
+    }
+    CConnmanTest::ReceiveMessage(node, MakeStreamMessage(NetMsgType::BLOCK, block));
+
+    std::atomic<bool> interrupt(false);
+    const int64_t nTimeStart = GetTimeMicros();
+    while (peerLogic.ProcessMessages(&node, interrupt)) {}
+    const int64_t nBlockMicros = GetTimeMicros() - nTimeStart;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(chainActive.Height(), nHeight + 1);
+        BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    }
+
+    for (int i = 0; i < 600; i++) {
+        {
+            LOCK(node.cs_vProcessMsg);
+            if (node.nProcessQueueSize == 0) break;
+        }
+        MilliSleep(100);
+    }
+    {
+        LOCK(node.cs_vProcessMsg);
+        BOOST_CHECK_EQUAL(node.nProcessQueueSize, 0U);
+    }
+    if (nMasternodeMessageThreads > 0) {
+        connman.Interrupt();
+        connman.Stop();
+    }
+    // Every ping was checked, none got the peer banned
+    BOOST_CHECK_EQUAL(mnodeman.mapSeenMasternodePing.size(), (size_t)FLOOD_MESSAGES);
+    BOOST_CHECK(!node.fDisconnect);
+    bool fUpdateConnectionTime = false;
+    peerLogic.FinalizeNode(node.GetId(), fUpdateConnectionTime);
+    mnodeman.Clear();
+    return nBlockMicros;
+}
+
+BOOST_FIXTURE_TEST_CASE(masternode_message_flood_block_latency, TestChain100Setup)
+{
+    // Past the masternode list, so pings and votes are handled in full
+    masternodeSync.Reset();
+    for (int i = 0; i < 3; i++)
+        masternodeSync.SwitchToNextAsset(*connman);
+    BOOST_REQUIRE(masternodeSync.IsMasternodeListSynced());
+
+    // Processed inline, the block waits for every ping signature queued before it;
+    // handed over to a masternode message thread, it only waits for the hand-over
+    const int64_t nInlineMicros = ProcessBlockBehindMasternodeFlood(*connman, *peerLogic, 0, 0);
+    const int64_t nThreadMicros = ProcessBlockBehindMasternodeFlood(*connman, *peerLogic, 1, 1);
+    BOOST_TEST_MESSAGE("block behind the flood: inline " << nInlineMicros << "us, masternode thread " << nThreadMicros << "us");
+    BOOST_CHECK_LT(4 * nThreadMicros, nInlineMicros);
+
+    masternodeSync.Reset();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
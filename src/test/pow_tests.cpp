@@ -2,6 +2,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <pow.h>
@@ -83,4 +84,209 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+// VELES BEGIN
+/* Straight copy of the uncached DarkGravityWave() walk, used as consensus reference */
+static unsigned int ReferenceDarkGravityWave(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
+{
+    const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
+
+    const int64_t nPastAlgoFastBlocks = 5;
+    const int64_t nPastAlgoBlocks = nPastAlgoFastBlocks * ALGO_ACTIVE_COUNT;
+    const int64_t nPastFastBlocks = nPastAlgoFastBlocks * 2;
+    int64_t nPastBlocks = nPastFastBlocks * ALGO_ACTIVE_COUNT * 100;
+
+    if (pindexLast->nHeight < nPastBlocks) {
+        if (pindexLast->nHeight < nPastAlgoBlocks)
+            return bnPowLimit.GetCompact();
+        else
+            nPastBlocks = pindexLast->nHeight;
+    }
+
+    const CBlockIndex *pindex = pindexLast;
+    const CBlockIndex *pindexFast = pindexLast;
+    arith_uint256 bnPastTargetAvg(0);
+    arith_uint256 bnPastTargetAvgFast(0);
+
+    const CBlockIndex *pindexAlgo = nullptr;
+    const CBlockIndex *pindexAlgoFast = nullptr;
+    const CBlockIndex *pindexAlgoLast = nullptr;
+    arith_uint256 bnPastAlgoTargetAvg(0);
+    arith_uint256 bnPastAlgoTargetAvgFast(0);
+
+    int32_t nVersion = pblock->nVersion & ALGO_VERSION_MASK;
+
+    unsigned int nCountBlocks = 0;
+    unsigned int nCountFastBlocks = 0;
+    unsigned int nCountAlgoBlocks = 0;
+    unsigned int nCountAlgoFastBlocks = 0;
+
+    while (nCountBlocks < nPastBlocks && nCountAlgoBlocks < nPastAlgoBlocks) {
+        arith_uint256 bnTarget = arith_uint256().SetCompact(pindex->nBits) / pindex->GetBlockHeader().GetAlgoEfficiency(pindex->nHeight);
+
+        if (nVersion == (pindex->nVersion & ALGO_VERSION_MASK)) {
+            nCountAlgoBlocks++;
+            pindexAlgo = pindex;
+            if (!pindexAlgoLast)
+                pindexAlgoLast = pindex;
+            bnPastAlgoTargetAvg = (bnPastAlgoTargetAvg * (nCountAlgoBlocks - 1) + bnTarget) / nCountAlgoBlocks;
+            if (nCountAlgoBlocks <= nPastAlgoFastBlocks) {
+                nCountAlgoFastBlocks++;
+                pindexAlgoFast = pindex;
+                bnPastAlgoTargetAvgFast = bnPastAlgoTargetAvg;
+            }
+        }
+
+        nCountBlocks++;
+        bnPastTargetAvg = (bnPastTargetAvg * (nCountBlocks - 1) + bnTarget) / nCountBlocks;
+        if (nCountBlocks <= nPastFastBlocks) {
+            nCountFastBlocks++;
+            pindexFast = pindex;
+            bnPastTargetAvgFast = bnPastTargetAvg;
+        }
+
+        if (nCountBlocks != nPastBlocks)
+            pindex = pindex->pprev;
+    }
+
+    if (pindexLast->GetBlockTime() - pindexFast->GetBlockTime() < params.nPowTargetSpacing / 2) {
+        nCountBlocks = nCountFastBlocks;
+        pindex = pindexFast;
+        bnPastTargetAvg = bnPastTargetAvgFast;
+    }
+
+    arith_uint256 bnNew(bnPastTargetAvg);
+
+    if (pindexAlgo && pindexAlgoLast && nCountAlgoBlocks > 1) {
+        if (pindexLast->GetBlockTime() - pindexAlgoFast->GetBlockTime() < params.nPowTargetSpacing * ALGO_ACTIVE_COUNT / 2) {
+            nCountAlgoBlocks = nCountAlgoFastBlocks;
+            pindexAlgo = pindexAlgoFast;
+            bnPastAlgoTargetAvg = bnPastAlgoTargetAvgFast;
+        }
+
+        bnNew = bnPastAlgoTargetAvg;
+
+        int64_t nActualTimespan = pindexLast->GetBlockTime() - pindexAlgo->GetBlockTime();
+        int64_t nTargetTimespan = nCountAlgoBlocks * params.nPowTargetSpacing * ALGO_ACTIVE_COUNT;
+        if (nActualTimespan < 1)
+            nActualTimespan = 1;
+        if (nActualTimespan > nTargetTimespan*2)
+            nActualTimespan = nTargetTimespan*2;
+        bnNew *= nActualTimespan;
+        bnNew /= nTargetTimespan;
+    } else {
+        bnNew = bnPowLimit;
+    }
+
+    int64_t nActualTimespan = pindexLast->GetBlockTime() - pindex->GetBlockTime();
+    int64_t nTargetTimespan = nCountBlocks * params.nPowTargetSpacing;
+    if (nActualTimespan < 1)
+        nActualTimespan = 1;
+    if (nActualTimespan > nTargetTimespan*2)
+        nActualTimespan = nTargetTimespan*2;
+    bnNew *= nActualTimespan;
+    bnNew /= nTargetTimespan;
+
+    if ((bnPowLimit / pblock->GetAlgoEfficiency(pindexLast->nHeight+1)) > bnNew)
+        bnNew *= pblock->GetAlgoEfficiency(pindexLast->nHeight+1);
+    else
+        bnNew = bnPowLimit;
+
+    if ((bnPowLimit * GetHandbrakeForce(pblock->nVersion, pindexLast->nHeight+1)) < bnNew)
+        bnNew = bnPowLimit;
+    else
+        bnNew /= GetHandbrakeForce(pblock->nVersion, pindexLast->nHeight+1);
+
+    return bnNew.GetCompact();
+}
+
+/* Replay a mixed-algo chain and check cached retargeting against the reference walk */
+BOOST_AUTO_TEST_CASE(dark_gravity_wave_replay)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
+    const int32_t algos[] = {ALGO_SHA256D, ALGO_SCRYPT, ALGO_NIST5, ALGO_LYRA2Z, ALGO_X11, ALGO_X16R};
+    const int32_t commonAlgos[] = {ALGO_SHA256D, ALGO_SCRYPT, ALGO_LYRA2Z, ALGO_X11, ALGO_X16R};
+
+    const int nBlocks = 5200;
+    std::vector<uint256> hashes(nBlocks);
+    std::vector<CBlockIndex> blocks(nBlocks);
+    for (int i = 0; i < nBlocks; i++) {
+        hashes[i] = ArithToUint256(arith_uint256(i + 1));
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        // NIST5 is rare, so its window reaches deep into the chain
+        blocks[i].nVersion = InsecureRandRange(100) == 0 ? ALGO_NIST5 : commonAlgos[InsecureRandRange(5)];
+        // occasional bursts of fast blocks exercise the instamine protection
+        blocks[i].nTime = i ? blocks[i - 1].nTime + (InsecureRandRange(20) == 0 ? 1 : InsecureRandRange(4 * params.nPowTargetSpacing)) : 1500000000;
+        blocks[i].nBits = arith_uint256(bnPowLimit >> (8 + InsecureRandRange(24))).GetCompact();
+        blocks[i].BuildSkip();
+        blocks[i].BuildAlgoChain();
+    }
+
+    // Same-algo predecessors skip exactly the blocks of other algos, and the
+    // last blocks of every algo match a walk back from each block
+    auto walkLastAlgo = [](const CBlockIndex* pindex, int32_t nAlgo) {
+        while (pindex && pindex->GetAlgo() != nAlgo)
+            pindex = pindex->pprev;
+        return pindex;
+    };
+    for (int i = 0; i < nBlocks; i++) {
+        const CBlockIndex* pindexPrevAlgo = walkLastAlgo(blocks[i].pprev, blocks[i].GetAlgo());
+        BOOST_CHECK_EQUAL(blocks[i].pprevAlgo, pindexPrevAlgo);
+        BOOST_CHECK_EQUAL(blocks[i].nAlgoHeight, pindexPrevAlgo ? pindexPrevAlgo->nAlgoHeight + 1 : 1);
+        // The lookup stops at the height floor
+        for (int32_t nAlgo : algos) {
+            const CBlockIndex* pindexAlgo = blocks[i].GetLastAlgoAncestor(nAlgo);
+            BOOST_CHECK_EQUAL(pindexAlgo, walkLastAlgo(&blocks[i], nAlgo));
+            int nMinHeight = i - (int)InsecureRandRange(20);
+            const CBlockIndex* pindexExpected = pindexAlgo && pindexAlgo->nHeight >= nMinHeight ? pindexAlgo : nullptr;
+            BOOST_CHECK_EQUAL(blocks[i].GetLastAlgoAncestor(nAlgo, nMinHeight), pindexExpected);
+        }
+    }
+
+    for (int nHeight = 30; nHeight < nBlocks; nHeight += 37 + InsecureRandRange(10)) {
+        const CBlockIndex* pindexLast = &blocks[nHeight];
+        for (int32_t nAlgo : algos) {
+            CBlockHeader header;
+            header.nVersion = nAlgo;
+            header.nTime = pindexLast->nTime + params.nPowTargetSpacing;
+            const unsigned int nExpected = ReferenceDarkGravityWave(pindexLast, &header, params);
+            // cold and warm cache
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(pindexLast, &header, params), nExpected);
+            BOOST_CHECK_EQUAL(GetNextWorkRequired(pindexLast, &header, params), nExpected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pow_cache)
+{
+    const auto mainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const auto regtestParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params& params = regtestParams->GetConsensus();
+
+    CBlockHeader header;
+    header.nVersion = ALGO_LYRA2Z;
+    header.hashPrevBlock = InsecureRand256();
+    header.nTime = 1538000000;
+    header.nBits = UintToArith256(params.powLimit).GetCompact();
+    while (!CheckProofOfWork(header.GetPoWHash(), header.nBits, params))
+        header.nNonce++;
+    BOOST_CHECK(CheckBlockHeaderProofOfWork(header, params));
+
+    // A header above its target fails until it is cached: the cache is what gets checked
+    arith_uint256 bnHardTarget = UintToArith256(params.powLimit) >> 128;
+    header.nBits = bnHardTarget.GetCompact();
+    uint256 hashPoW = header.GetPoWHash();
+    BOOST_CHECK(!CheckBlockHeaderProofOfWork(header, params));
+    BOOST_CHECK(!CheckBlockHeaderProofOfWork(header, params, &hashPoW));
+    CacheBlockHeaderProofOfWork(header, params);
+    BOOST_CHECK(CheckBlockHeaderProofOfWork(header, params));
+
+    // Entries are per proof of work limit
+    BOOST_CHECK(!CheckBlockHeaderProofOfWork(header, mainParams->GetConsensus()));
+}
+// VELES END
+
 BOOST_AUTO_TEST_SUITE_END()
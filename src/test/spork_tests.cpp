@@ -0,0 +1,200 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <spork.h>
+
+#include <chainparamsbase.h>
+#include <net.h>
+#include <net_processing.h>
+#include <netbase.h>
+#include <netmessagemaker.h>
+#include <protocol.h>
+#include <sporkdb.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <version.h>
+
+#include <algorithm>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+/** Secret of the regtest spork key */
+static const std::string strRegtestSporkKey = "8SFpqTiknk8VJ6wC5DC73izzbgUh1fB1nNz5Zrf6YMjgFmZiE7J";
+
+/** Regtest, whose sporks the tests can sign, with an in-memory spork database */
+struct SporkTestingSetup : public TestingSetup {
+    SporkTestingSetup() : TestingSetup(CBaseChainParams::REGTEST)
+    {
+        pSporkDB.reset(new CSporkDB(0, true));
+    }
+    ~SporkTestingSetup()
+    {
+        pSporkDB.reset();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(spork_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(spork_value_table)
+{
+    CSporkManager sporks;
+    int nKnown = 0;
+
+    for (int nSporkID : {SPORK_START, SPORK_FXTC_START, SPORK_VELES_START}) {
+        int nEnd = nSporkID == SPORK_START ? SPORK_END : nSporkID == SPORK_FXTC_START ? SPORK_FXTC_END : SPORK_VELES_END;
+        for (; nSporkID <= nEnd; nSporkID++) {
+            std::string strName = sporks.GetSporkNameByID(nSporkID);
+            if (strName == "Unknown") {
+                BOOST_CHECK_EQUAL(sporks.GetSporkValue(nSporkID), -1);
+                BOOST_CHECK(!sporks.IsSporkActive(nSporkID));
+                continue;
+            }
+            BOOST_CHECK_EQUAL(sporks.GetSporkIDByName(strName), nSporkID);
+            BOOST_CHECK(sporks.GetSporkValue(nSporkID) >= 0);
+            nKnown++;
+        }
+    }
+    BOOST_CHECK_EQUAL(nKnown, 46);
+
+    // Defaults from every ID range
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_5_INSTANTSEND_MAX_VALUE), SPORK_5_INSTANTSEND_MAX_VALUE_DEFAULT);
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START), SPORK_FXTC_03_BLOCK_REWARD_SMOOTH_HALVING_START_DEFAULT);
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT), SPORK_VELES_05A_ADJUST_COST_FACTOR_SCRYPT_DEFAULT);
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR), SPORK_VELES_06C_DYNAMIC_REWARD_BOOST3_FACTOR_DEFAULT);
+    BOOST_CHECK(sporks.IsSporkActive(SPORK_2_INSTANTSEND_ENABLED));
+    BOOST_CHECK(!sporks.IsSporkActive(SPORK_9_SUPERBLOCKS_ENABLED));
+
+    // IDs outside the ranges
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_START - 1), -1);
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_VELES_END + 1), -1);
+    BOOST_CHECK(!sporks.IsSporkActive(SPORK_FXTC_END + 1));
+}
+
+BOOST_FIXTURE_TEST_CASE(spork_update_notifies_once, SporkTestingSetup)
+{
+    CSporkManager sporks;
+    BOOST_REQUIRE(sporks.SetPrivKey(strRegtestSporkKey));
+    std::vector<std::pair<int, int64_t>> vNotified;
+    sporks.NotifySporkChanged.connect([&](int nSporkID, int64_t nValue) {
+        vNotified.emplace_back(nSporkID, nValue);
+    });
+
+    // A new value is announced once
+    BOOST_CHECK(sporks.UpdateSpork(SPORK_9_SUPERBLOCKS_ENABLED, 1000, *connman));
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_9_SUPERBLOCKS_ENABLED), 1000);
+    BOOST_REQUIRE_EQUAL(vNotified.size(), 1U);
+    BOOST_CHECK_EQUAL(vNotified[0].first, SPORK_9_SUPERBLOCKS_ENABLED);
+    BOOST_CHECK_EQUAL(vNotified[0].second, 1000);
+
+    // Signing the same value again changes nothing derived from it
+    BOOST_CHECK(sporks.UpdateSpork(SPORK_9_SUPERBLOCKS_ENABLED, 1000, *connman));
+    BOOST_CHECK_EQUAL(vNotified.size(), 1U);
+
+    // Nor does a received spork with the value already set, while a new value does
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), 0, 0, CAddress(), "", true);
+    int64_t nTimeSigned = GetAdjustedTime() + 1;
+    for (int64_t nValue : {1000, 2000}) {
+        CSporkMessage spork(SPORK_9_SUPERBLOCKS_ENABLED, nValue, nTimeSigned++);
+        BOOST_REQUIRE(spork.Sign(strRegtestSporkKey));
+        CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+        vRecv << spork;
+        sporks.ProcessSpork(&node, NetMsgType::SPORK, vRecv, *connman);
+    }
+    BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_9_SUPERBLOCKS_ENABLED), 2000);
+    BOOST_REQUIRE_EQUAL(vNotified.size(), 2U);
+    BOOST_CHECK_EQUAL(vNotified[1].second, 2000);
+}
+
+BOOST_FIXTURE_TEST_CASE(spork_concurrent_newest_wins, SporkTestingSetup)
+{
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, CAddress(CService(), NODE_NONE), 0, 0, CAddress(), "", true);
+    int64_t nTimeSigned = GetAdjustedTime();
+    std::vector<CSporkMessage> vSporks;
+    for (int64_t nValue : {1000, 2000}) {
+        vSporks.emplace_back(SPORK_14_REQUIRE_SENTINEL_FLAG, nValue, nTimeSigned + nValue);
+        BOOST_REQUIRE(vSporks.back().Sign(strRegtestSporkKey));
+    }
+
+    // Two peers relay sporks of the same ID at once; whichever is handled
+    // last, the value is the one signed last
+    for (int i = 0; i < 50; i++) {
+        CSporkManager sporks;
+        std::vector<std::thread> vThreads;
+        for (int j = 0; j < 2; j++) {
+            const CSporkMessage& spork = vSporks[(i + j) % 2];
+            vThreads.emplace_back([&sporks, &node, &spork, this] {
+                CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+                vRecv << spork;
+                sporks.ProcessSpork(&node, NetMsgType::SPORK, vRecv, *connman);
+            });
+        }
+        for (std::thread& thread : vThreads)
+            thread.join();
+        BOOST_CHECK_EQUAL(sporks.GetSporkValue(SPORK_14_REQUIRE_SENTINEL_FLAG), 2000);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(spork_relayed_concurrently_newest_wins, SporkTestingSetup)
+{
+    CConnman::Options options;
+    options.m_msgproc = peerLogic.get();
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.nMasternodeMessageThreads = 2;
+    connman->Init(options);
+    CConnmanTest::StartMasternodeMessageThreads(*connman);
+
+    std::vector<std::unique_ptr<CNode>> vNodes;
+    for (NodeId id = 0; id < 2; id++) {
+        CAddress addr(CService(LookupNumeric(strprintf("10.0.0.%d", id + 1).c_str(), 7777)), NODE_NETWORK);
+        vNodes.emplace_back(new CNode(id, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true));
+        vNodes.back()->SetSendVersion(PROTOCOL_VERSION);
+        vNodes.back()->nVersion = PROTOCOL_VERSION;
+        vNodes.back()->fSuccessfullyConnected = true;
+        peerLogic->InitializeNode(vNodes.back().get());
+    }
+
+    // Two peers relay sporks of the same ID, processed on different masternode
+    // message threads; whichever is handled last, the value is the one signed last
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    const int64_t nTimeSigned = GetAdjustedTime();
+    std::atomic<bool> interrupt(false);
+    for (int i = 0; i < 50; i++) {
+        for (int j = 0; j < 2; j++) {
+            int64_t nOffset = 2 * i + j;
+            CSporkMessage spork(SPORK_14_REQUIRE_SENTINEL_FLAG, SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT + nOffset, nTimeSigned + nOffset);
+            BOOST_REQUIRE(spork.Sign(strRegtestSporkKey));
+            CConnmanTest::ReceiveMessage(*vNodes[(i + j) % 2], msgMaker.Make(NetMsgType::SPORK, spork));
+        }
+        for (const auto& pnode : vNodes)
+            peerLogic->ProcessMessages(pnode.get(), interrupt);
+        for (int k = 0; k < 600; k++) {
+            if (std::all_of(vNodes.begin(), vNodes.end(), [](const std::unique_ptr<CNode>& pnode) {
+                    LOCK(pnode->cs_vProcessMsg);
+                    return pnode->nProcessQueueSize == 0;
+                })) break;
+            MilliSleep(10);
+        }
+        BOOST_CHECK_EQUAL(sporkManager.GetSporkValue(SPORK_14_REQUIRE_SENTINEL_FLAG), SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT + 2 * i + 1);
+    }
+
+    connman->Interrupt();
+    connman->Stop();
+    for (const auto& pnode : vNodes) {
+        BOOST_CHECK(!pnode->fDisconnect);
+        bool fUpdateConnectionTime = false;
+        peerLogic->FinalizeNode(pnode->GetId(), fUpdateConnectionTime);
+    }
+
+    // Leave the shared spork manager as the other tests expect it
+    CSporkMessage spork(SPORK_14_REQUIRE_SENTINEL_FLAG, SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT, nTimeSigned + 100);
+    BOOST_REQUIRE(spork.Sign(strRegtestSporkKey));
+    CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+    vRecv << spork;
+    sporkManager.ProcessSpork(vNodes[0].get(), NetMsgType::SPORK, vRecv, *connman);
+    BOOST_CHECK_EQUAL(sporkManager.GetSporkValue(SPORK_14_REQUIRE_SENTINEL_FLAG), SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+// Copyright (c) 2018-2019 The Veles Core developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stratum.h>
+
+#include <chain.h>
+#include <consensus/merkle.h>
+#include <hash.h>
+#include <key_io.h>
+#include <masternode-sync.h>
+#include <test/test_bitcoin.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+
+#include <univalue.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+
+#include <limits>
+
+#include <boost/test/unit_test.hpp>
+
+/** Messages the server has written to a miner connection, one per line */
+static std::vector<UniValue> ReadMessages(struct bufferevent* bev)
+{
+    std::vector<UniValue> vMessages;
+    size_t nLength;
+    char* line;
+    while ((line = evbuffer_readln(bufferevent_get_input(bev), &nLength, EVBUFFER_EOL_LF)) != nullptr) {
+        UniValue msg;
+        BOOST_CHECK(msg.read(std::string(line, nLength)));
+        free(line);
+        vMessages.push_back(msg);
+    }
+    return vMessages;
+}
+
+static std::string MakeRequest(int nId, const std::string& strMethod, const std::vector<std::string>& vParams)
+{
+    UniValue params(UniValue::VARR);
+    for (const std::string& strParam : vParams)
+        params.push_back(strParam);
+    UniValue request(UniValue::VOBJ);
+    request.pushKV("id", nId);
+    request.pushKV("method", strMethod);
+    request.pushKV("params", params);
+    return request.write();
+}
+
+/** The error code of a reply, 0 for none */
+static int ReplyError(const UniValue& reply)
+{
+    const UniValue& error = find_value(reply, "error");
+    return error.isNull() ? 0 : error[0].get_int();
+}
+
+BOOST_FIXTURE_TEST_SUITE(stratum_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(stratum_job_merkle_root)
+{
+    CScript scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x11) << OP_EQUALVERIFY << OP_CHECKSIG;
+    std::vector<unsigned char> vchExtraNonce1 = {0x01, 0x02, 0x03, 0x04};
+    std::vector<unsigned char> vchExtraNonce2 = {0xa1, 0xa2, 0xa3, 0xa4};
+
+    for (int nTxs = 0; nTxs < 12; nTxs++) {
+        CBlock block;
+        CMutableTransaction txCoinbase;
+        txCoinbase.vin.resize(1);
+        txCoinbase.vin[0].prevout.SetNull();
+        txCoinbase.vin[0].scriptSig = CScript() << 1000 << OP_0;
+        txCoinbase.vout.resize(2);
+        txCoinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        txCoinbase.vout[0].nValue = 50 * COIN;
+        txCoinbase.vout[1].scriptPubKey = CScript() << OP_RETURN;
+        block.vtx.push_back(MakeTransactionRef(txCoinbase));
+        for (int i = 0; i < nTxs; i++) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout = COutPoint(InsecureRand256(), i);
+            tx.vout.resize(1);
+            tx.vout[0].nValue = i;
+            block.vtx.push_back(MakeTransactionRef(tx));
+        }
+        CStratumJob job("1", block, 1000);
+
+        // Rebuild the merkle root the way a miner does from the notify message
+        std::vector<unsigned char> vchCoinb1, vchCoinb2;
+        job.GetCoinbase(scriptPubKey, vchCoinb1, vchCoinb2);
+        std::vector<unsigned char> vchCoinbase(vchCoinb1);
+        vchCoinbase.insert(vchCoinbase.end(), vchExtraNonce1.begin(), vchExtraNonce1.end());
+        vchCoinbase.insert(vchCoinbase.end(), vchExtraNonce2.begin(), vchExtraNonce2.end());
+        vchCoinbase.insert(vchCoinbase.end(), vchCoinb2.begin(), vchCoinb2.end());
+        uint256 hashRoot = Hash(vchCoinbase.begin(), vchCoinbase.end());
+        for (const uint256& hash : job.vMerkleBranch)
+            hashRoot = Hash(hashRoot.begin(), hashRoot.end(), hash.begin(), hash.end());
+
+        std::vector<unsigned char> vchExtraNonce(vchExtraNonce1);
+        vchExtraNonce.insert(vchExtraNonce.end(), vchExtraNonce2.begin(), vchExtraNonce2.end());
+        CBlock blockSolved = job.GetBlock(scriptPubKey, vchExtraNonce, 1538000000, 42);
+        BOOST_CHECK_EQUAL(hashRoot, blockSolved.hashMerkleRoot);
+        BOOST_CHECK_EQUAL(blockSolved.hashMerkleRoot, BlockMerkleRoot(blockSolved));
+        BOOST_CHECK_EQUAL(Hash(vchCoinbase.begin(), vchCoinbase.end()), blockSolved.vtx[0]->GetHash());
+        BOOST_CHECK(blockSolved.vtx[0]->vout[0].scriptPubKey == scriptPubKey);
+        BOOST_CHECK(blockSolved.vtx[0]->vin[0].scriptSig == (CScript() << 1000 << vchExtraNonce));
+        BOOST_CHECK_EQUAL(blockSolved.nTime, 1538000000U);
+        BOOST_CHECK_EQUAL(blockSolved.nNonce, 42U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stratum_share_target)
+{
+    arith_uint256 diff1;
+    diff1.SetCompact(0x1d00ffff);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SHA256D, 1) == diff1);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_X11, 4) == diff1 / 4);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_X11, 0.25) == diff1 * 4);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SCRYPT, 1) == diff1 << 16);
+
+    // Difficulties are clamped to what the target arithmetic can hold
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SCRYPT, 0) == (diff1 << 16) * 4096);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SCRYPT, std::numeric_limits<double>::quiet_NaN()) == (diff1 << 16) * 4096);
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SHA256D, 1e300) == GetStratumShareTarget(ALGO_SHA256D, MAX_STRATUM_DIFFICULTY));
+    BOOST_CHECK(GetStratumShareTarget(ALGO_SHA256D, MAX_STRATUM_DIFFICULTY) > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(stratum_session, TestChain100Setup)
+{
+    // Past the masternode winners list, so jobs can be built
+    masternodeSync.Reset();
+    for (int i = 0; i < 4; i++)
+        masternodeSync.SwitchToNextAsset(*connman);
+    BOOST_REQUIRE(masternodeSync.IsWinnersListSynced());
+
+    struct event_base* base = event_base_new();
+    struct bufferevent* pair[2];
+    BOOST_REQUIRE(bufferevent_pair_new(base, 0, pair) == 0);
+    bufferevent_enable(pair[0], EV_READ | EV_WRITE);
+    bufferevent_enable(pair[1], EV_READ | EV_WRITE);
+    StratumTest::AddClient(pair[0]);
+    auto request = [&](int nId, const std::string& strMethod, const std::vector<std::string>& vParams) {
+        BOOST_CHECK(StratumTest::HandleLine(pair[0], MakeRequest(nId, strMethod, vParams)));
+        std::vector<UniValue> vMessages = ReadMessages(pair[1]);
+        BOOST_REQUIRE(!vMessages.empty());
+        BOOST_CHECK_EQUAL(find_value(vMessages[0], "id").get_int(), nId);
+        return vMessages;
+    };
+    std::string strUser = EncodeDestination(coinbaseKey.GetPubKey().GetID()) + ".rig";
+
+    // Nothing before a subscription
+    BOOST_CHECK_EQUAL(ReplyError(request(1, "mining.authorize", {strUser, "algo=scrypt"})[0]), 25);
+    std::vector<UniValue> vMessages = request(2, "mining.subscribe", {});
+    const UniValue& subscription = find_value(vMessages[0], "result");
+    std::vector<unsigned char> vchExtraNonce1 = ParseHex(subscription[1].get_str());
+    BOOST_CHECK_EQUAL(vchExtraNonce1.size(), STRATUM_EXTRANONCE1_SIZE);
+    BOOST_CHECK_EQUAL(subscription[2].get_int(), (int)STRATUM_EXTRANONCE2_SIZE);
+
+    // Difficulties out of range are refused rather than overflowing the share target
+    BOOST_CHECK_EQUAL(ReplyError(request(3, "mining.authorize", {strUser, "algo=scrypt,d=1e13"})[0]), 24);
+    BOOST_CHECK_EQUAL(ReplyError(request(4, "mining.authorize", {strUser, "algo=scrypt,d=0.0001"})[0]), 24);
+    BOOST_CHECK_EQUAL(ReplyError(request(5, "mining.authorize", {"notanaddress", "algo=scrypt"})[0]), 24);
+
+    // A hard difficulty, so an arbitrary nonce makes a low difficulty share
+    vMessages = request(6, "mining.authorize", {strUser, "algo=scrypt,d=1000000"});
+    BOOST_REQUIRE_EQUAL(vMessages.size(), 3U);
+    BOOST_CHECK(find_value(vMessages[0], "result").get_bool());
+    BOOST_CHECK_EQUAL(find_value(vMessages[1], "method").get_str(), "mining.set_difficulty");
+    BOOST_CHECK_EQUAL(find_value(vMessages[1], "params")[0].get_real(), 1000000);
+    BOOST_CHECK_EQUAL(find_value(vMessages[2], "method").get_str(), "mining.notify");
+    UniValue notify = find_value(vMessages[2], "params");
+    std::string strJob = notify[0].get_str();
+    std::string strTime = notify[7].get_str();
+    BOOST_CHECK_EQUAL(ReplyError(request(7, "mining.submit", {strUser, strJob, "00000000", strTime, "00000000"})[0]), 23);
+    BOOST_CHECK_EQUAL(ReplyError(request(8, "mining.submit", {strUser, "ffffff", "00000000", strTime, "00000000"})[0]), 21);
+
+    // The easiest difficulty, for a share found in a few scrypt hashes; the same job is sent again
+    vMessages = request(9, "mining.authorize", {strUser, strprintf("algo=scrypt,d=%.12f", MIN_STRATUM_DIFFICULTY)});
+    BOOST_REQUIRE_EQUAL(vMessages.size(), 3U);
+    notify = find_value(vMessages[2], "params");
+    BOOST_CHECK_EQUAL(notify[0].get_str(), strJob);
+
+    // Solve the job the way a miner does, from the notify message alone
+    std::vector<unsigned char> vchExtraNonce2 = {0x00, 0x00, 0x00, 0x07};
+    std::vector<unsigned char> vchCoinbase = ParseHex(notify[2].get_str());
+    vchCoinbase.insert(vchCoinbase.end(), vchExtraNonce1.begin(), vchExtraNonce1.end());
+    vchCoinbase.insert(vchCoinbase.end(), vchExtraNonce2.begin(), vchExtraNonce2.end());
+    std::vector<unsigned char> vchCoinb2 = ParseHex(notify[3].get_str());
+    vchCoinbase.insert(vchCoinbase.end(), vchCoinb2.begin(), vchCoinb2.end());
+    uint256 hashRoot = Hash(vchCoinbase.begin(), vchCoinbase.end());
+    for (size_t i = 0; i < notify[4].size(); i++) {
+        uint256 hash(ParseHex(notify[4][i].get_str()));
+        hashRoot = Hash(hashRoot.begin(), hashRoot.end(), hash.begin(), hash.end());
+    }
+    std::vector<unsigned char> vchPrev = ParseHex(notify[1].get_str());
+    for (size_t i = 0; i < vchPrev.size(); i += 4)
+        std::reverse(vchPrev.begin() + i, vchPrev.begin() + i + 4);
+    CBlockHeader header;
+    header.nVersion = (int32_t)strtoul(notify[5].get_str().c_str(), nullptr, 16);
+    header.hashPrevBlock = uint256(vchPrev);
+    header.hashMerkleRoot = hashRoot;
+    header.nBits = strtoul(notify[6].get_str().c_str(), nullptr, 16);
+    header.nTime = strtoul(notify[7].get_str().c_str(), nullptr, 16);
+    BOOST_CHECK_EQUAL(header.hashPrevBlock, chainActive.Tip()->GetBlockHash());
+    arith_uint256 target = GetStratumShareTarget(ALGO_SCRYPT, MIN_STRATUM_DIFFICULTY);
+    for (header.nNonce = 0; UintToArith256(header.GetPoWHash()) > target; header.nNonce++) {}
+    std::string strNonce = strprintf("%08x", header.nNonce);
+
+    // Regtest blocks are easier than any share, so the share is the next block
+    int nHeight = chainActive.Height();
+    vMessages = request(10, "mining.submit", {strUser, strJob, HexStr(vchExtraNonce2), strTime, strNonce});
+    BOOST_CHECK_EQUAL(ReplyError(vMessages[0]), 0);
+    BOOST_CHECK(find_value(vMessages[0], "result").get_bool());
+    BOOST_CHECK_EQUAL(chainActive.Height(), nHeight + 1);
+    BOOST_CHECK_EQUAL(chainActive.Tip()->GetBlockHash(), header.GetHash());
+
+    BOOST_CHECK_EQUAL(ReplyError(request(11, "mining.submit", {strUser, strJob, HexStr(vchExtraNonce2), strTime, strNonce})[0]), 22);
+    BOOST_CHECK_EQUAL(ReplyError(request(12, "mining.fly", {})[0]), 20);
+    BOOST_CHECK(!StratumTest::HandleLine(pair[0], "not json"));
+
+    StopStratumServer();
+    bufferevent_free(pair[1]);
+    event_base_free(base);
+    masternodeSync.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,8 @@
 #include <chainparams.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <crypto/lyra2.h>
+#include <crypto/scrypt.h>
 #include <crypto/sha256.h>
 #include <validation.h>
 #include <miner.h>
@@ -33,6 +35,28 @@ void CConnmanTest::ClearNodes()
     g_connman->vNodes.clear();
 }
 
+// VELES BEGIN
+void CConnmanTest::StartMasternodeMessageThreads(CConnman& connman)
+{
+    connman.StartMasternodeMessageThreads();
+}
+
+void CConnmanTest::ReceiveMessage(CNode& node, CSerializedNetMsg&& msg)
+{
+    const CSharedNetMsg sharedMsg(msg.command, std::move(msg.data));
+    CNetMessage netMsg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    netMsg.readHeader((const char*)sharedMsg.header.data(), sharedMsg.header.size());
+    if (!sharedMsg.data.empty())
+        netMsg.readData((const char*)sharedMsg.data.data(), sharedMsg.data.size());
+    assert(netMsg.complete());
+    netMsg.nTime = GetTimeMicros();
+
+    LOCK(node.cs_vProcessMsg);
+    node.nProcessQueueSize += sharedMsg.data.size() + CMessageHeader::HEADER_SIZE;
+    node.vProcessMsg.push_back(std::move(netMsg));
+}
+// VELES END
+
 uint256 insecure_rand_seed = GetRandHash();
 FastRandomContext insecure_rand_ctx(insecure_rand_seed);
 
@@ -49,12 +73,17 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     : m_path_root(fs::temp_directory_path() / "test_bitcoin" / strprintf("%lu_%i", (unsigned long)GetTime(), (int)(InsecureRandRange(1 << 30))))
 {
     SHA256AutoDetect();
+    ScryptAutoDetect();
+    Lyra2AutoDetect();
     RandomInit();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    // VELES BEGIN
+    InitPoWCache();
+    // VELES END
     fCheckBlockIndex = true;
     SelectParams(chainName);
     noui_connect();
@@ -103,8 +132,10 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
             }
         }
         nScriptCheckThreads = 3;
-        for (int i=0; i < nScriptCheckThreads-1; i++)
+        for (int i=0; i < nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadPoWHashCheck);
+        }
         g_connman = std::unique_ptr<CConnman>(new CConnman(0x1337, 0x1337)); // Deterministic randomness for tests.
         connman = g_connman.get();
         peerLogic.reset(new PeerLogicValidation(connman, scheduler, /*enable_bip61=*/true));
@@ -57,9 +57,17 @@ private:
  */
 class CConnman;
 class CNode;
+// VELES BEGIN
+struct CSerializedNetMsg;
+// VELES END
 struct CConnmanTest {
     static void AddNode(CNode& node);
     static void ClearNodes();
+    // VELES BEGIN
+    static void StartMasternodeMessageThreads(CConnman& connman);
+    /** Queue a message for processing as if the node had sent it */
+    static void ReceiveMessage(CNode& node, CSerializedNetMsg&& msg);
+    // VELES END
 };
 
 class PeerLogicValidation;
@@ -181,4 +181,36 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());*/
 }
 
+// VELES BEGIN
+BOOST_AUTO_TEST_CASE(check_headers_pow)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    std::vector<CBlockHeader> headers(40);
+    for (size_t i = 0; i < headers.size(); i++) {
+        CBlockHeader& header = headers[i];
+        header.nVersion = VERSIONBITS_TOP_BITS | ((i % 6) << 8);
+        header.hashPrevBlock = InsecureRand256();
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = 1538000000 + i;
+        header.nBits = UintToArith256(consensusParams.powLimit).GetCompact();
+        while (!CheckProofOfWork(header.GetPoWHash(), header.nBits, consensusParams))
+            header.nNonce++;
+    }
+
+    std::vector<uint256> vHashes(headers.size());
+    BOOST_CHECK(CheckHeadersPoW(headers.data(), headers.size(), consensusParams, vHashes.data()));
+    for (size_t i = 0; i < headers.size(); i++)
+        BOOST_CHECK_EQUAL(vHashes[i], headers[i].GetPoWHash());
+
+    // A header missing its target fails the batch; the hashes computed are still right
+    arith_uint256 bnHardTarget = UintToArith256(consensusParams.powLimit) >> 64;
+    headers[21].nBits = bnHardTarget.GetCompact();
+    BOOST_CHECK(!CheckHeadersPoW(headers.data(), headers.size(), consensusParams, vHashes.data()));
+    for (size_t i = 0; i < headers.size(); i++)
+        BOOST_CHECK(vHashes[i].IsNull() || vHashes[i] == headers[i].GetPoWHash());
+
+    BOOST_CHECK(CheckHeadersPoW(headers.data(), 21, consensusParams, vHashes.data()));
+}
+// VELES END
+
 BOOST_AUTO_TEST_SUITE_END()
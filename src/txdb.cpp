@@ -16,6 +16,11 @@
 
 #include <stdint.h>
 
+// VELES BEGIN
+#include <atomic>
+#include <thread>
+// VELES END
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -246,12 +251,63 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+// VELES BEGIN
+/** Check the proof of work of the given block index entries, spread over all available cores */
+static bool CheckBlockIndexPoW(const std::vector<CBlockIndex*>& vIndex, const Consensus::Params& consensusParams)
+{
+    if (vIndex.empty())
+        return true;
+
+    const size_t nThreads = std::min<size_t>(std::max(GetNumCores(), 1), vIndex.size());
+    LogPrintf("Checking proof of work of %u block index entries using %u threads\n", vIndex.size(), nThreads);
+
+    std::atomic<size_t> nNext(0);
+    std::atomic<bool> fStop(false);
+    std::atomic<const CBlockIndex*> pindexFailed(nullptr);
+    auto worker = [&]() {
+        while (!fStop) {
+            const size_t i = nNext++;
+            if (i >= vIndex.size())
+                break;
+            if (!CheckBlockHeaderProofOfWork(vIndex[i]->GetBlockHeader(), consensusParams)) {
+                pindexFailed = vIndex[i];
+                fStop = true;
+            } else if (ShutdownRequested()) {
+                fStop = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t n = 1; n < nThreads; n++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    boost::this_thread::interruption_point();
+
+    if (pindexFailed)
+        return error("%s: CheckProofOfWork failed: %s", __func__, pindexFailed.load()->ToString());
+    return !ShutdownRequested();
+}
+// VELES END
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // VELES BEGIN
+    // Entries flagged BLOCK_POW_VERIFIED were checked when their header was
+    // accepted; only entries without the flag and an optional random sample
+    // (-checkpowonload=<percent>) are hashed again here.
+    const int nSamplePercent = std::max(0, std::min(100, (int)gArgs.GetArg("-checkpowonload", DEFAULT_CHECKPOWONLOAD)));
+    FastRandomContext rng;
+    std::vector<CBlockIndex*> vCheckPoW;
+    // VELES END
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -273,12 +329,18 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
+                // VELES BEGIN
+                // the chain subsidy which older versions stored after the header is not read
+                pindexNew->nStatus       &= ~BLOCK_OLD_SUBSIDY;
+                // VELES END
 
                 // FxTC BEGIN
                 if (pindexNew->nHeight > consensusParams.nlastValidPowHashHeight)
                 // FXTC END
-                if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                // VELES BEGIN
+                if (!(pindexNew->nStatus & BLOCK_POW_VERIFIED) || (nSamplePercent > 0 && (int)rng.randrange(100) < nSamplePercent))
+                    vCheckPoW.push_back(pindexNew);
+                // VELES END
 
                 pcursor->Next();
             } else {
@@ -289,6 +351,30 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         }
     }
 
+    // VELES BEGIN
+    pcursor.reset();
+
+    if (!CheckBlockIndexPoW(vCheckPoW, consensusParams))
+        return false;
+
+    // Flag entries written before BLOCK_POW_VERIFIED existed, so that they
+    // are not hashed again on the next startup
+    CDBBatch batch(*this);
+    size_t nUpgraded = 0;
+    for (CBlockIndex* pindex : vCheckPoW) {
+        if (pindex->nStatus & BLOCK_POW_VERIFIED)
+            continue;
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, pindex->GetBlockHash()), CDiskBlockIndex(pindex));
+        nUpgraded++;
+    }
+    if (nUpgraded > 0) {
+        LogPrintf("Marking %u block index entries as proof of work verified\n", nUpgraded);
+        if (!WriteBatch(batch, true))
+            return error("%s: failed to write upgraded block index entries", __func__);
+    }
+    // VELES END
+
     return true;
 }
 
@@ -39,6 +39,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+// VELES BEGIN
+//! -checkpowonload default (percentage of already verified headers to hash again at startup)
+static const int DEFAULT_CHECKPOWONLOAD = 0;
+// VELES END
 
 /** CCoinsView backed by the coin database (chainstate/) */
 class CCoinsViewDB final : public CCoinsView
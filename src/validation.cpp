@@ -53,6 +53,7 @@
 #include <future>
 #include <sstream>
 // VELES BEGIN
+#include <limits>
 #include <vector>
 // VELES END
 
@@ -176,7 +177,7 @@ public:
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to mapBlockIndex.
      */
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pPoWHash = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
@@ -1149,7 +1150,7 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     }
 
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (!CheckBlockHeaderProofOfWork(block, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
     return true;
@@ -1242,11 +1243,35 @@ double ConvertBitsToDouble(unsigned int nBits)
 // VELES BEGIN
 // Note that this method will return the correct results only if nStartVlock and nEndBlock are
 // within the same halving epoch.
-CAmount CountBlockRewards(int nStartBlock, int nEndBlock, HalvingParameters *halvingParams)
+static bool GetChainSubsidy(const CBlockIndex *pindex, CAmount& nChainSubsidy)
+{
+    // genesis block pays no subsidy
+    if (pindex->pprev == nullptr) {
+        nChainSubsidy = 0;
+        return true;
+    }
+    if (pindex->nChainSubsidy < 0)
+        return false;
+
+    nChainSubsidy = pindex->nChainSubsidy;
+    return true;
+}
+
+CAmount CountBlockRewards(int nStartBlock, int nEndBlock, const HalvingParameters *halvingParams)
 {
     CBlockIndex *pb = chainActive.Tip();
     CAmount nRewards = 0;
 
+    // the current tip is not counted
+    int nLastBlock = std::min(nEndBlock, pb->nHeight - 1);
+    if (nStartBlock > nLastBlock)
+        return 0;
+
+    // use the cumulative subsidy of the block index if available
+    CAmount nEndSubsidy, nStartSubsidy;
+    if (nStartBlock > 0 && GetChainSubsidy(chainActive[nLastBlock], nEndSubsidy) && GetChainSubsidy(chainActive[nStartBlock - 1], nStartSubsidy))
+        return nEndSubsidy - nStartSubsidy;
+
     // use indexed value if exists
     if (totalSupplyIndex.count(nStartBlock) && totalSupplyIndex[nStartBlock].count(nEndBlock))
         return totalSupplyIndex[nStartBlock][nEndBlock];
@@ -1263,15 +1288,10 @@ CAmount CountBlockRewards(int nStartBlock, int nEndBlock, HalvingParameters *hal
     return nRewards;
 }
 
-HalvingParameters *GetSubsidyHalvingParameters(int nHeight, const Consensus::Params& consensusParams)
+std::shared_ptr<const HalvingParameters> CHalvingEpochTable::GetBootstrapSnapshot(int nHeightOffset, const Consensus::Params& consensusParams)
 {
-    int nHeightOffset = (int)sporkManager.GetSporkValue(SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START);
     int nCurrentEpoch = 0;
-    HalvingParameters *params = new HalvingParameters();
-    CAmount nCurrentMaxSupply = 0;
-    CAmount nCurrentHalvingRealSupply = 0;
-    CAmount nCurrentEpochRealSupply = 0;
-    CAmount nBlocksToProccess = nHeight - nHeightOffset;
+    std::shared_ptr<HalvingParameters> params = std::make_shared<HalvingParameters>();
 
     // default halving settings for first epoch
     params->nHalvingInterval = consensusParams.nSubsidyHalvingInterval;
@@ -1292,96 +1312,169 @@ HalvingParameters *GetSubsidyHalvingParameters(int nHeight, const Consensus::Par
     params->epochs[nCurrentEpoch].nStartSupply = 50000 * COIN;
     params->epochs[nCurrentEpoch].nEndBlock = nHeightOffset - 1;
 
-    // we're still in the bootstrap epoch
-    if (nHeight < nHeightOffset) {
+    return params;
+}
 
-        return params; 
+std::shared_ptr<const HalvingParameters> CHalvingEpochTable::GetNextSnapshot(const HalvingParameters& prevParams, int nHeightOffset, const Consensus::Params& consensusParams, const RewardCounter& countRewards)
+{
+    std::shared_ptr<HalvingParameters> params = std::make_shared<HalvingParameters>(prevParams);
+    int nCurrentEpoch = params->epochs.size() - 1;
+
+    // the bootstrap epoch has ended, first VCIP01 epoch before first halving
+    if (nCurrentEpoch == 1) {
+        params->epochs[nCurrentEpoch].fHasEnded = true;
+        params->epochs[nCurrentEpoch].nEndSupply = params->epochs[nCurrentEpoch].nStartSupply
+            + countRewards(params->epochs[nCurrentEpoch].nStartBlock, params->epochs[nCurrentEpoch].nEndBlock - 1, params.get());
+        nCurrentEpoch++;
+        params->epochs.push_back (HalvingEpoch{});
+        params->epochs[nCurrentEpoch].nMaxBlockSubsidy = 8 * COIN * consensusParams.nVlsRewardsAlphaMultiplier;
+        params->epochs[nCurrentEpoch].nStartBlock = nHeightOffset;
+        params->epochs[nCurrentEpoch].nStartSupply = params->epochs[nCurrentEpoch - 1].nEndSupply;
+        params->epochs[nCurrentEpoch].nEndBlock = nHeightOffset + params->nHalvingInterval - 1;
+
+        return params;
     }
-    params->epochs[nCurrentEpoch].fHasEnded = true;
-    params->epochs[nCurrentEpoch].nEndSupply = params->epochs[nCurrentEpoch].nStartSupply
-        + CountBlockRewards(params->epochs[nCurrentEpoch].nStartBlock, params->epochs[nCurrentEpoch].nEndBlock - 1, params);
+
     nCurrentEpoch++;
-    // first VCIP01 epoch before first halving
+    // let's finish the old epoch
+    params->epochs[nCurrentEpoch - 1].fHasEnded = true;
+    params->epochs[nCurrentEpoch - 1].nEndSupply = params->epochs[nCurrentEpoch - 1].nStartSupply
+        + countRewards(params->epochs[nCurrentEpoch - 1].nStartBlock, params->epochs[nCurrentEpoch - 1].nEndBlock - 1, params.get());
+    // initialize new epoch struct
     params->epochs.push_back (HalvingEpoch{});
-    params->epochs[nCurrentEpoch].nMaxBlockSubsidy = 8 * COIN * consensusParams.nVlsRewardsAlphaMultiplier;
-    params->epochs[nCurrentEpoch].nStartBlock = nHeightOffset;
+    params->epochs[nCurrentEpoch].nStartBlock = params->epochs[nCurrentEpoch - 1].nEndBlock + 1;
     params->epochs[nCurrentEpoch].nStartSupply = params->epochs[nCurrentEpoch - 1].nEndSupply;
-    params->epochs[nCurrentEpoch].nEndBlock = nHeightOffset + params->nHalvingInterval - 1;
+    params->epochs[nCurrentEpoch].nMaxBlockSubsidy = params->epochs[nCurrentEpoch - 1].nMaxBlockSubsidy;
+    params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = params->epochs[nCurrentEpoch - 1].nDynamicRewardsBoostFactor;
 
-    // we're still before the first halving is supposed to occur
-    if (nHeight <= params->epochs[nCurrentEpoch].nEndBlock)
-        return params; 
+    // supply released since the last halving, or since the first VCIP01 epoch
+    CAmount nCurrentHalvingRealSupply = 0;
+    for (int i = nCurrentEpoch - 1; i >= 2; i--) {
+        nCurrentHalvingRealSupply += params->epochs[i].nEndSupply - params->epochs[i].nStartSupply;
+        if (params->epochs[i].fIsSubsidyHalved)
+            break;
+    }
+    CAmount nCurrentMaxSupply = params->epochs[nCurrentEpoch - 1].nMaxBlockSubsidy * params->nHalvingInterval;
+    CAmount nCurrentEpochRealSupply = params->epochs[nCurrentEpoch - 1].nEndSupply - params->epochs[nCurrentEpoch - 1].nStartSupply;
+
+    // let's check whether we have released enough coins to the circulation,
+    // then halve the subsidy and double the halving interval
+    if (nCurrentHalvingRealSupply >= nCurrentMaxSupply * HALVING_MIN_SUPPLY_TARGET) {
+        params->nHalvingInterval *= 2;
+        params->nHalvingCount++;
+        params->epochs[nCurrentEpoch].nMaxBlockSubsidy >>= 1;
+        params->epochs[nCurrentEpoch].fIsSubsidyHalved = true;
+        // slow down the dynamic reward boost
+        if (params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor > HALVING_MAX_BOOST_STEP)
+            params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor /= 2;
+        else
+            params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = 0;
 
-    // at least one epoch has already ended
-    while(nBlocksToProccess >= params->nHalvingInterval) {
-        nBlocksToProccess -= params->nHalvingInterval;
-        nCurrentEpoch++;
-        // let's finish the old epoch
-        params->epochs[nCurrentEpoch - 1].fHasEnded = true;
-        //params->epochs[nCurrentEpoch - 1].nEndSupply = GetTotalSupply(params->epochs[nCurrentEpoch - 1].nEndBlock);
-        params->epochs[nCurrentEpoch - 1].nEndSupply = params->epochs[nCurrentEpoch - 1].nStartSupply
-            + CountBlockRewards(params->epochs[nCurrentEpoch - 1].nStartBlock, params->epochs[nCurrentEpoch - 1].nEndBlock - 1, params);
-        // initialize new epoch struct
-        //params->epochs[nCurrentEpoch] = HalvingEpoch;   //*(new HalvingEpoch());
-        params->epochs.push_back (HalvingEpoch{});
-        params->epochs[nCurrentEpoch].nStartBlock = params->epochs[nCurrentEpoch - 1].nEndBlock + 1;
-        params->epochs[nCurrentEpoch].nStartSupply = params->epochs[nCurrentEpoch - 1].nEndSupply;
-        params->epochs[nCurrentEpoch].nMaxBlockSubsidy = params->epochs[nCurrentEpoch - 1].nMaxBlockSubsidy;
-        params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = params->epochs[nCurrentEpoch - 1].nDynamicRewardsBoostFactor;
-
-        nCurrentMaxSupply = params->epochs[nCurrentEpoch - 1].nMaxBlockSubsidy * params->nHalvingInterval;
-        nCurrentEpochRealSupply = params->epochs[nCurrentEpoch - 1].nEndSupply - params->epochs[nCurrentEpoch - 1].nStartSupply;
-        nCurrentHalvingRealSupply += nCurrentEpochRealSupply;
-
-        // let's check whether we have released enough coins to the circulation,
-        // then halve the subsidy and double the halving interval
-        if (nCurrentHalvingRealSupply >= nCurrentMaxSupply * HALVING_MIN_SUPPLY_TARGET) {
-            params->nHalvingInterval *= 2;
-            params->nHalvingCount++;
-            params->epochs[nCurrentEpoch].nMaxBlockSubsidy >>= 1;
-            params->epochs[nCurrentEpoch].fIsSubsidyHalved = true;
-            nCurrentHalvingRealSupply = 0;
-            // slow down the dynamic reward boost
-            if (params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor > HALVING_MAX_BOOST_STEP)
-                params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor /= 2;
+    } else {
+        // boost dynamic rewards if we're far from target supply
+        if (nCurrentEpochRealSupply < nCurrentMaxSupply * HALVING_MIN_BOOST_SUPPLY_TARGET) {
+            if (params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor)
+                params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor *= 2;
             else
-                params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = 0;
-
-        } else {
-            // boost dynamic rewards if we're far from target supply
-            if (nCurrentEpochRealSupply < nCurrentMaxSupply * HALVING_MIN_BOOST_SUPPLY_TARGET) {
-                if (params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor)
-                    params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor *= 2;
-                else
-                    params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = HALVING_MAX_BOOST_STEP;
-            }
+                params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor = HALVING_MAX_BOOST_STEP;
         }
-        // complete the next epoch struct
-        params->epochs[nCurrentEpoch].nEndBlock = params->epochs[nCurrentEpoch - 1].nEndBlock + params->nHalvingInterval;
-        // update halving params
-        params->nDynamicRewardsBoostFactor = params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor;
+    }
+    // complete the next epoch struct
+    params->epochs[nCurrentEpoch].nEndBlock = params->epochs[nCurrentEpoch - 1].nEndBlock + params->nHalvingInterval;
+    // update halving params
+    params->nDynamicRewardsBoostFactor = params->epochs[nCurrentEpoch].nDynamicRewardsBoostFactor;
+
+    return params;
+}
+
+int CHalvingEpochTable::GetLastCountedBlock(const HalvingParameters& params)
+{
+    // the premine epoch is not counted, the other ended epochs are counted
+    // up to the block before their last one
+    if (params.epochs.size() <= 2)
+        return -1;
+
+    return params.epochs[params.epochs.size() - 2].nEndBlock - 1;
+}
+
+std::shared_ptr<const HalvingParameters> CHalvingEpochTable::Get(int nHeight, int nChainHeight, int nHeightOffset, const Consensus::Params& consensusParams, const RewardCounter& countRewards)
+{
+    LOCK(cs);
+
+    if (nHeightOffset != nSnapshotsHeightOffset || &consensusParams != pSnapshotsConsensusParams) {
+        vSnapshots.clear();
+        nSnapshotsHeightOffset = nHeightOffset;
+        pSnapshotsConsensusParams = &consensusParams;
+    }
+    if (vSnapshots.empty())
+        vSnapshots.push_back(GetBootstrapSnapshot(nHeightOffset, consensusParams));
+
+    // look up the epoch of nHeight
+    if (nHeight <= vSnapshots.back()->epochs.back().nEndBlock) {
+        return *std::lower_bound(vSnapshots.begin(), vSnapshots.end(), nHeight,
+            [](const std::shared_ptr<const HalvingParameters>& params, int nHeight) {
+                return params->epochs.back().nEndBlock < nHeight;
+            });
+    }
+
+    // or extend the table by the epochs that have ended since
+    std::shared_ptr<const HalvingParameters> params = vSnapshots.back();
+    bool fKeep = true;
+    while (nHeight > params->epochs.back().nEndBlock) {
+        params = GetNextSnapshot(*params, nHeightOffset, consensusParams, countRewards);
+        // the rewards of blocks above the tip could not be counted yet
+        fKeep = fKeep && GetLastCountedBlock(*params) < nChainHeight;
+        if (fKeep)
+            vSnapshots.push_back(params);
     }
 
     return params;
 }
 
-HalvingParameters *GetSubsidyHalvingParameters(int nHeight)
+void CHalvingEpochTable::Invalidate(int nHeight)
+{
+    LOCK(cs);
+
+    while (vSnapshots.size() > 1 && GetLastCountedBlock(*vSnapshots.back()) >= nHeight)
+        vSnapshots.pop_back();
+}
+
+void CHalvingEpochTable::Clear()
+{
+    LOCK(cs);
+
+    vSnapshots.clear();
+}
+
+CHalvingEpochTable halvingEpochTable;
+
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters(int nHeight, const Consensus::Params& consensusParams)
+{
+    int nHeightOffset = (int)sporkManager.GetSporkValue(SPORK_VELES_04_REWARD_UPGRADE_ALPHA_START);
+
+    return halvingEpochTable.Get(nHeight, chainActive.Height(), nHeightOffset, consensusParams, CountBlockRewards);
+}
+
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters(int nHeight)
 {
     return GetSubsidyHalvingParameters(nHeight, Params().GetConsensus());
 }
 
-HalvingParameters *GetSubsidyHalvingParameters()
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters()
 {
     return GetSubsidyHalvingParameters((int)chainActive.Height());
 }
 
-double GetAlgoCostFactor(int32_t nAlgo, int nHeight)
+// Nist5 bootstraping and reward discovery
+static const int NIST5_ALPHA_BUMP_UP_FACTOR = 10;
+static const int NIST5_ALPHA_BUMP_UP_HEIGHT = 51000;
+
+double CAlgoCostFactorTable::Compute(int32_t nAlgo, int64_t nHeight)
 {
     double factor = 100;
     CAmount totalAdjustements = 0;
-    // Nist5 bootstraping and reward discovery
-    int nNistAlphaBumpUpFactor = 10;
-    int nNistAlphaBumpUpHeight = 51000;
+    int nNistAlphaBumpUpFactor = NIST5_ALPHA_BUMP_UP_FACTOR;
+    int nNistAlphaBumpUpHeight = NIST5_ALPHA_BUMP_UP_HEIGHT;
 
     // We have a possibility to perform 2 more cost factor adjustements, taking 
     // advantage of spork protocol.
@@ -1486,6 +1579,66 @@ double GetAlgoCostFactor(int32_t nAlgo, int nHeight)
     return factor / (totalAdjustements / 6);
 }
 
+int CAlgoCostFactorTable::GetSlot(int32_t nAlgo)
+{
+    uint32_t nSlot = (nAlgo & ~ALGO_VERSION_MASK) ? SLOT_OTHER : (uint32_t)nAlgo >> 8;
+    return std::min<uint32_t>(nSlot, SLOT_OTHER);
+}
+
+std::shared_ptr<const CAlgoCostFactorTable::Ranges> CAlgoCostFactorTable::Build()
+{
+    // The cost factors only change at these heights
+    std::array<int64_t, RANGES> vStartHeights = {{
+        std::numeric_limits<int64_t>::min(),
+        NIST5_ALPHA_BUMP_UP_HEIGHT,
+        sporkManager.GetSporkValue(SPORK_VELES_05A_ADJUST_COST_FACTOR_START),
+        sporkManager.GetSporkValue(SPORK_VELES_05B_ADJUST_COST_FACTOR_START)
+    }};
+    std::sort(vStartHeights.begin(), vStartHeights.end());
+
+    std::shared_ptr<Ranges> ranges = std::make_shared<Ranges>();
+    for (int i = 0; i < RANGES; i++) {
+        (*ranges)[i].nStartHeight = vStartHeights[i];
+        for (int nSlot = 0; nSlot < SLOT_OTHER; nSlot++)
+            (*ranges)[i].factors[nSlot] = Compute(nSlot << 8, vStartHeights[i]);
+        (*ranges)[i].factors[SLOT_OTHER] = Compute(ALGO_NULL, vStartHeights[i]);
+    }
+    return ranges;
+}
+
+double CAlgoCostFactorTable::Get(int32_t nAlgo, int nHeight)
+{
+    std::shared_ptr<const Ranges> ranges = std::atomic_load(&pRanges);
+    if (!ranges) {
+        LOCK(cs);
+        ranges = std::atomic_load(&pRanges);
+        if (!ranges) {
+            ranges = Build();
+            std::atomic_store(&pRanges, ranges);
+        }
+    }
+
+    // ranges are sorted by start height, the first one starts below any height
+    int nRange = 0;
+    for (int i = 1; i < RANGES; i++)
+        nRange += nHeight >= (*ranges)[i].nStartHeight;
+    return (*ranges)[nRange].factors[GetSlot(nAlgo)];
+}
+
+void CAlgoCostFactorTable::Rebuild()
+{
+    LOCK(cs);
+
+    std::atomic_store(&pRanges, Build());
+}
+
+CAlgoCostFactorTable algoCostFactorTable;
+
+double GetAlgoCostFactor(int32_t nAlgo, int nHeight)
+{
+    return algoCostFactorTable.Get(nAlgo, nHeight);
+}
+
 double GetAlgoCostFactor(int32_t nAlgo)
 {
     return GetAlgoCostFactor(nAlgo, (int)chainActive.Height());
@@ -1497,13 +1650,15 @@ double GetBlockAlgoCostFactor(CBlockHeader *pblock, int nHeight)
     return GetAlgoCostFactor(pblock->nVersion & ALGO_VERSION_MASK, nHeight);
 }
 
-CAmount GetBlockSubsidy(int nHeight, CBlockHeader pblock, const Consensus::Params& consensusParams, bool fSuperblockPartOnly, HalvingParameters *halvingParams)
+CAmount GetBlockSubsidy(int nHeight, CBlockHeader pblock, const Consensus::Params& consensusParams, bool fSuperblockPartOnly, const HalvingParameters *halvingParams)
 {
     CAmount nSubsidy = 0;
 
-    //HalvingParameters *halvingParams = GetSubsidyHalvingParameters(nHeight, consensusParams);
-    if (halvingParams == nullptr)
-        halvingParams = GetSubsidyHalvingParameters(nHeight, consensusParams);
+    std::shared_ptr<const HalvingParameters> halvingParamsHeight;
+    if (halvingParams == nullptr) {
+        halvingParamsHeight = GetSubsidyHalvingParameters(nHeight, consensusParams);
+        halvingParams = halvingParamsHeight.get();
+    }
 
     // Force block reward to zero when right shift is undefined.
     if (halvingParams->nHalvingCount >= 64)
@@ -2178,11 +2333,124 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
+// VELES BEGIN
+/** The coinbase checks of ConnectBlock: the reward it may claim and the masternode and superblock payments */
+static bool CheckBlockRewards(const CBlock& block, CValidationState& state, int nHeight, CAmount blockReward)
+{
+    if (block.vtx[0]->GetValueOut() > blockReward * (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE) ? 1 : 2))
+        return state.DoS(100,
+                         error("ConnectBlock(): coinbase pays too much (actual=%d vs limit=%d)",
+                               block.vtx[0]->GetValueOut(), blockReward),
+                               REJECT_INVALID, "bad-cb-amount");
+
+    // DASH : MODIFIED TO CHECK MASTERNODE PAYMENTS AND SUPERBLOCKS
+
+    // It's possible that we simply don't have enough data and this could fail
+    // (i.e. block itself could be a correct one and we need to store it),
+    // that's why this is in ConnectBlock. Could be the other way around however -
+    // the peer who sent us this block is missing some data and wasn't able
+    // to recognize that block is actually invalid.
+    // TODO: resync data (both ways?) and try to reprocess this block later.
+    std::string strError = "";
+    if (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE) && !IsBlockValueValid(block, nHeight, block.vtx[0]->GetValueOut(), strError)) {
+        return state.DoS(0, error("ConnectBlock(DASH): %s", strError), REJECT_INVALID, "bad-cb-amount");
+    }
+
+    if (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE) && !IsBlockPayeeValid(block.vtx[0], nHeight, block.vtx[0]->GetValueOut(), block.GetBlockHeader())) {
+        mapRejectedBlocks.insert(make_pair(block.GetHash(), GetTime()));
+        return state.DoS(0, error("ConnectBlock(DASH): couldn't find masternode or superblock payments"),
+                                REJECT_INVALID, "bad-cb-payee");
+    }
+    // END DASH
+
+    return true;
+}
+// VELES END
+
 void ThreadScriptCheck() {
     RenameThread("veles-scriptch");
     scriptcheckqueue.Thread();
 }
 
+// VELES BEGIN
+/** Closure computing the proof of work hashes of a run of headers of a batch,
+ *  and checking them against the headers' targets when given the consensus params */
+class CPoWHashCheck
+{
+private:
+    const CBlockHeader *pheaders;
+    size_t nCount;
+    uint256 *phashes;
+    const Consensus::Params *pparams;
+
+public:
+    CPoWHashCheck(): pheaders(nullptr), nCount(0), phashes(nullptr), pparams(nullptr) {}
+    CPoWHashCheck(const CBlockHeader* pheadersIn, size_t nCountIn, uint256* phashesIn, const Consensus::Params* pparamsIn) : pheaders(pheadersIn), nCount(nCountIn), phashes(phashesIn), pparams(pparamsIn) {}
+
+    bool operator()() {
+        GetBlockHeaderPoWHashes(pheaders, nCount, phashes);
+        if (pparams) {
+            for (size_t i = 0; i < nCount; i++) {
+                if (!CheckProofOfWork(phashes[i], pheaders[i].nBits, *pparams))
+                    return false;
+                CacheBlockHeaderProofOfWork(pheaders[i], *pparams);
+            }
+        }
+        return true;
+    }
+
+    void swap(CPoWHashCheck &check) {
+        std::swap(pheaders, check.pheaders);
+        std::swap(nCount, check.nCount);
+        std::swap(phashes, check.phashes);
+        std::swap(pparams, check.pparams);
+    }
+};
+
+/** Headers per CPoWHashCheck, a multiple of the widest multi-lane scrypt core */
+static const size_t POW_HASH_CHECK_SIZE = 8;
+
+static CCheckQueue<CPoWHashCheck> powhashqueue(2);
+
+void ThreadPoWHashCheck() {
+    RenameThread("veles-powhash");
+    powhashqueue.Thread();
+}
+
+static bool RunPoWHashChecks(const CBlockHeader* pheaders, size_t nCount, uint256* phashes, const Consensus::Params* pparams)
+{
+    std::fill(phashes, phashes + nCount, uint256());
+
+    std::vector<CPoWHashCheck> vChecks;
+    vChecks.reserve((nCount + POW_HASH_CHECK_SIZE - 1) / POW_HASH_CHECK_SIZE);
+    for (size_t i = 0; i < nCount; i += POW_HASH_CHECK_SIZE)
+        vChecks.emplace_back(&pheaders[i], std::min(POW_HASH_CHECK_SIZE, nCount - i), &phashes[i], pparams);
+
+    if (vChecks.size() < 2 || !nScriptCheckThreads) {
+        for (CPoWHashCheck& check : vChecks) {
+            if (!check())
+                return false;
+        }
+        return true;
+    }
+
+    CCheckQueueControl<CPoWHashCheck> control(&powhashqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+void GetPoWHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& vHashesRet)
+{
+    vHashesRet.resize(headers.size());
+    RunPoWHashChecks(headers.data(), headers.size(), vHashesRet.data(), nullptr);
+}
+
+bool CheckHeadersPoW(const CBlockHeader* pheaders, size_t nCount, const Consensus::Params& consensusParams, uint256* phashes)
+{
+    return RunPoWHashChecks(pheaders, nCount, phashes, &consensusParams);
+}
+// VELES END
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2559,12 +2827,11 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
-    CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, pindex->GetBlockHeader(), chainparams.GetConsensus());
-    if (block.vtx[0]->GetValueOut() > blockReward * (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_SLIGHTLY_HIGHER_COINBASE) ? 1 : 2))
-        return state.DoS(100,
-                         error("ConnectBlock(): coinbase pays too much (actual=%d vs limit=%d)",
-                               block.vtx[0]->GetValueOut(), blockReward),
-                               REJECT_INVALID, "bad-cb-amount");
+    // VELES BEGIN
+    CAmount nBlockSubsidy = GetBlockSubsidy(pindex->nHeight, pindex->GetBlockHeader(), chainparams.GetConsensus());
+    if (!CheckBlockRewards(block, state, pindex->nHeight, nFees + nBlockSubsidy))
+        return false;
+    // VELES END
 
     // FXTC BEGIN
     // VELES EDIT: Check disabled, made optional
@@ -2593,27 +2860,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     */
     // FXTC END
 
-    // DASH : MODIFIED TO CHECK MASTERNODE PAYMENTS AND SUPERBLOCKS
-
-    // It's possible that we simply don't have enough data and this could fail
-    // (i.e. block itself could be a correct one and we need to store it),
-    // that's why this is in ConnectBlock. Could be the other way around however -
-    // the peer who sent us this block is missing some data and wasn't able
-    // to recognize that block is actually invalid.
-    // TODO: resync data (both ways?) and try to reprocess this block later.
-    //CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, pindex->GetBlockHeader(), chainparams.GetConsensus());
-    std::string strError = "";
-    if (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_VALUE) && !IsBlockValueValid(block, pindex->nHeight, block.vtx[0]->GetValueOut(), strError)) {
-        return state.DoS(0, error("ConnectBlock(DASH): %s", strError), REJECT_INVALID, "bad-cb-amount");
-    }
-
-    if (!sporkManager.IsSporkActive(SPORK_FXTC_02_IGNORE_MASTERNODE_REWARD_PAYEE) && !IsBlockPayeeValid(block.vtx[0], pindex->nHeight, block.vtx[0]->GetValueOut(), pindex->GetBlockHeader())) {
-        mapRejectedBlocks.insert(make_pair(block.GetHash(), GetTime()));
-        return state.DoS(0, error("ConnectBlock(DASH): couldn't find masternode or superblock payments"),
-                                REJECT_INVALID, "bad-cb-payee");
-    }
-    // END DASH
-
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
@@ -2630,6 +2876,14 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         setDirtyBlockIndex.insert(pindex);
     }
 
+    // VELES BEGIN
+    CAmount nPrevChainSubsidy;
+    if (pindex->nChainSubsidy < 0 && GetChainSubsidy(pindex->pprev, nPrevChainSubsidy))
+        pindex->nChainSubsidy = nPrevChainSubsidy + nBlockSubsidy;
+
+    mnpayments.AddPaidBlock(pindex->nHeight, pindex->GetBlockHash(), *block.vtx[0]);
+    // VELES END
+
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -2883,6 +3137,10 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
         return false;
 
+    // VELES BEGIN
+    halvingEpochTable.Invalidate(pindexDelete->nHeight);
+    // VELES END
+
     if (disconnectpool) {
         // Save transactions to re-add to mempool at end of reorg
         for (auto it = block.vtx.rbegin(); it != block.vtx.rend(); ++it) {
@@ -3540,6 +3798,9 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
         pindexNew->BuildSkip();
     }
+    // VELES BEGIN
+    pindexNew->BuildAlgoChain();
+    // VELES END
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
     // FXTC BEGIN
@@ -3694,10 +3955,10 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* pPoWHash = nullptr)
 {
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckBlockHeaderProofOfWork(block, consensusParams, pPoWHash))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
@@ -3969,7 +4230,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pPoWHash)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3987,7 +4248,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, pPoWHash))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -4023,8 +4284,14 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             }
         }
     }
-    if (pindex == nullptr)
+    if (pindex == nullptr) {
         pindex = AddToBlockIndex(block);
+        // VELES BEGIN
+        // CheckBlockHeader() above has already verified the proof of work,
+        // remember it so that it is not hashed again when loading the index
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        // VELES END
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -4038,11 +4305,26 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    // VELES BEGIN
+    // Check the proof of work of the whole batch up front, without holding
+    // cs_main. Headers we have already are accepted without it, so only the
+    // ones from the first new header on are hashed. Headers left unhashed
+    // after a failure are hashed by AcceptBlockHeader if it gets to them.
+    size_t nFirstNew = 0;
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        while (nFirstNew < headers.size() && mapBlockIndex.count(headers[nFirstNew].GetHash()))
+            nFirstNew++;
+    }
+    std::vector<uint256> vPoWHashes(headers.size());
+    CheckHeadersPoW(headers.data() + nFirstNew, headers.size() - nFirstNew, chainparams.GetConsensus(), vPoWHashes.data() + nFirstNew);
+    // VELES END
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, vPoWHashes[i].IsNull() ? nullptr : &vPoWHashes[i])) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -4212,6 +4494,26 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
     return true;
 }
 
+// VELES BEGIN
+bool TestBlockTemplateValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, CAmount nFees)
+{
+    AssertLockHeld(cs_main);
+    assert(pindexPrev && pindexPrev == chainActive.Tip());
+
+    if (!ContextualCheckBlockHeader(block, state, chainparams, pindexPrev, GetAdjustedTime()))
+        return error("%s: Consensus::ContextualCheckBlockHeader: %s", __func__, FormatStateMessage(state));
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), false, false))
+        return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
+    if (!ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindexPrev))
+        return error("%s: Consensus::ContextualCheckBlock: %s", __func__, FormatStateMessage(state));
+    int nHeight = pindexPrev->nHeight + 1;
+    if (!CheckBlockRewards(block, state, nHeight, nFees + GetBlockSubsidy(nHeight, block.GetBlockHeader(), chainparams.GetConsensus())))
+        return false;
+
+    return true;
+}
+// VELES END
+
 /**
  * BLOCK PRUNING CODE
  */
@@ -4497,6 +4799,9 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
             pindexBestInvalid = pindex;
         if (pindex->pprev)
             pindex->BuildSkip();
+        // VELES BEGIN
+        pindex->BuildAlgoChain();
+        // VELES END
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
     }
@@ -4583,6 +4888,10 @@ bool LoadChainTip(const CChainParams& chainparams)
 
     g_chainstate.PruneBlockIndexCandidates();
 
+    // VELES BEGIN
+    IndexChainSubsidy(chainparams);
+    // VELES END
+
     LogPrintf("Loaded best chain: hashBestChain=%s height=%d date=%s progress=%f\n",
         chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
         FormatISO8601DateTime(chainActive.Tip()->GetBlockTime()),
@@ -4590,6 +4899,55 @@ bool LoadChainTip(const CChainParams& chainparams)
     return true;
 }
 
+// VELES BEGIN
+void IndexChainSubsidy(const CChainParams& chainparams)
+{
+    AssertLockHeld(cs_main);
+
+    // Blocks are indexed in height order, so that the halving parameters of
+    // each block are computed from the already indexed supply of its ancestors
+    int nIndexed = 0;
+    for (CBlockIndex *pindex = chainActive.Genesis(); pindex; pindex = chainActive.Next(pindex)) {
+        if (pindex->pprev == nullptr || pindex->nChainSubsidy >= 0)
+            continue;
+
+        CAmount nPrevChainSubsidy;
+        if (!GetChainSubsidy(pindex->pprev, nPrevChainSubsidy))
+            break;
+        pindex->nChainSubsidy = nPrevChainSubsidy + GetBlockSubsidy(pindex->nHeight, pindex->GetBlockHeader(), chainparams.GetConsensus());
+        nIndexed++;
+    }
+
+    if (nIndexed > 0)
+        LogPrintf("%s: indexed the block subsidy of %d blocks\n", __func__, nIndexed);
+}
+
+void ReindexChainSubsidy(const CChainParams& chainparams)
+{
+    AssertLockHeld(cs_main);
+
+    for (BlockMap::value_type& entry : mapBlockIndex)
+        entry.second->nChainSubsidy = -1;
+    totalSupplyIndex.clear();
+    halvingEpochTable.Clear();
+
+    IndexChainSubsidy(chainparams);
+}
+
+void RewardSporkChanged(int nSporkID, int64_t nValue)
+{
+    // Dash sporks do not take part in block rewards
+    if (nSporkID < SPORK_FXTC_START)
+        return;
+
+    // the chain subsidy is computed from the cost factors
+    algoCostFactorTable.Rebuild();
+
+    LOCK(cs_main);
+    ReindexChainSubsidy(Params());
+}
+// VELES END
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0, false);
@@ -4925,6 +5283,10 @@ void UnloadBlockIndex()
     }
     mapBlockIndex.clear();
     fHavePruned = false;
+    // VELES BEGIN
+    totalSupplyIndex.clear();
+    halvingEpochTable.Clear();
+    // VELES END
 
     g_chainstate.UnloadBlockIndex();
 }
@@ -23,7 +23,9 @@
 #include <versionbits.h>
 
 #include <algorithm>
+#include <array>
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
@@ -280,10 +282,31 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Update the chain tip based on database information. */
 bool LoadChainTip(const CChainParams& chainparams);
+// VELES BEGIN
+/** Set the cumulative subsidy of active chain blocks which do not have it yet */
+void IndexChainSubsidy(const CChainParams& chainparams);
+/** Drop the cumulative subsidy and cached supply of all blocks and index the active chain again */
+void ReindexChainSubsidy(const CChainParams& chainparams);
+/** Rebuild the cost factors and reindex the chain subsidy after a spork which affects block rewards changed */
+void RewardSporkChanged(int nSporkID, int64_t nValue);
+// VELES END
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+// VELES BEGIN
+/** Run an instance of the proof of work hashing thread */
+void ThreadPoWHashCheck();
+/** Compute the proof of work hashes of a batch of headers, spread over the hashing threads when they run */
+void GetPoWHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& vHashesRet);
+/**
+ * Compute the proof of work hashes of nCount headers into phashes and check
+ * them against the headers' targets, spread over the hashing threads when
+ * they run. Returns false when a header fails, and stops hashing then: the
+ * hashes not computed are left null.
+ */
+bool CheckHeadersPoW(const CBlockHeader* pheaders, size_t nCount, const Consensus::Params& consensusParams, uint256* phashes);
+// VELES END
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -318,16 +341,95 @@ struct HalvingParameters
 //    int nLastHalvingBlockHeight = 0;
     std::vector<HalvingEpoch> epochs;
 };
-CAmount CountBlockRewards(int nStartBlock, int nEndBlock, HalvingParameters *halvingParams);
+
+/**
+ * Halving parameters of the active chain, one immutable snapshot per epoch.
+ * The table is extended as epochs end; snapshots of epochs whose supply
+ * depends on disconnected blocks are dropped, and the whole table is
+ * rebuilt when the reward sporks change.
+ */
+class CHalvingEpochTable
+{
+public:
+    //! Sums the rewards of blocks nStartBlock..nEndBlock, see CountBlockRewards
+    typedef std::function<CAmount(int nStartBlock, int nEndBlock, const HalvingParameters *halvingParams)> RewardCounter;
+
+private:
+    mutable CCriticalSection cs;
+    //! Each snapshot is valid for the heights of its last epoch, in height order
+    std::vector<std::shared_ptr<const HalvingParameters>> vSnapshots;
+    int nSnapshotsHeightOffset;
+    const Consensus::Params *pSnapshotsConsensusParams;
+
+    static std::shared_ptr<const HalvingParameters> GetBootstrapSnapshot(int nHeightOffset, const Consensus::Params& consensusParams);
+    static std::shared_ptr<const HalvingParameters> GetNextSnapshot(const HalvingParameters& prevParams, int nHeightOffset, const Consensus::Params& consensusParams, const RewardCounter& countRewards);
+    static int GetLastCountedBlock(const HalvingParameters& params);
+
+public:
+    CHalvingEpochTable() : nSnapshotsHeightOffset(0), pSnapshotsConsensusParams(nullptr) {}
+
+    /**
+     * Halving parameters in effect at nHeight. Epochs are only kept in the
+     * table once all the blocks they count are below the tip at nChainHeight.
+     */
+    std::shared_ptr<const HalvingParameters> Get(int nHeight, int nChainHeight, int nHeightOffset, const Consensus::Params& consensusParams, const RewardCounter& countRewards);
+    //! Drop the epochs that count the block at nHeight or above
+    void Invalidate(int nHeight);
+    void Clear();
+};
+
+extern CHalvingEpochTable halvingEpochTable;
+
+/**
+ * Cost factors of every algo for the ranges of heights between the
+ * activation heights of the cost factor sporks. The table is rebuilt after
+ * a reward spork changed and published as an immutable snapshot, so a
+ * lookup only loads the snapshot and picks a range and an algo slot.
+ */
+class CAlgoCostFactorTable
+{
+private:
+    //! Slots for the algos by their id (nAlgo >> 8), then one for unknown algos
+    static const int SLOT_OTHER = 6;
+    //! Defaults, defaults after the Nist5 bump-up, 05A and 05B, in height order
+    static const int RANGES = 4;
+
+    struct Range
+    {
+        int64_t nStartHeight;
+        std::array<double, SLOT_OTHER + 1> factors;
+    };
+
+    typedef std::array<Range, RANGES> Ranges;
+
+    //! Serializes the builds, lookups read pRanges without locking
+    CCriticalSection cs;
+    std::shared_ptr<const Ranges> pRanges;
+
+    static int GetSlot(int32_t nAlgo);
+    static std::shared_ptr<const Ranges> Build();
+
+public:
+    //! Cost factor of nAlgo at nHeight evaluated from the spork values, without the table
+    static double Compute(int32_t nAlgo, int64_t nHeight);
+    //! Cost factor of nAlgo at nHeight
+    double Get(int32_t nAlgo, int nHeight);
+    //! Rebuild the table from the current spork values
+    void Rebuild();
+};
+
+extern CAlgoCostFactorTable algoCostFactorTable;
+
+CAmount CountBlockRewards(int nStartBlock, int nEndBlock, const HalvingParameters *halvingParams);
 CAmount GetTotalSupply(int nHeight = 0);
-HalvingParameters *GetSubsidyHalvingParameters(int nHeight, const Consensus::Params& consensusParams);
-HalvingParameters *GetSubsidyHalvingParameters(int nHeight);
-HalvingParameters *GetSubsidyHalvingParameters();
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters(int nHeight, const Consensus::Params& consensusParams);
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters(int nHeight);
+std::shared_ptr<const HalvingParameters> GetSubsidyHalvingParameters();
 double GetAlgoCostFactor(int32_t nAlgo, int nHeight);
 double GetAlgoCostFactor(int32_t nAlgo);
 double GetBlockAlgoCostFactor(CBlockHeader *pblock, int nHeight);
 // VELES END
-CAmount GetBlockSubsidy(int nHeight, CBlockHeader pblock, const Consensus::Params& consensusParams, bool fSuperblockPartOnly = false, HalvingParameters *halvingParams = nullptr);
+CAmount GetBlockSubsidy(int nHeight, CBlockHeader pblock, const Consensus::Params& consensusParams, bool fSuperblockPartOnly = false, const HalvingParameters *halvingParams = nullptr);
 CAmount GetMasternodePayment(int nHeight, CAmount blockValue);
 CAmount GetFounderReward(int nHeight, CAmount blockValue);
 
@@ -472,6 +574,14 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+// VELES BEGIN
+/**
+ * Check a template whose transactions already passed TestBlockValidity on this tip, with another
+ * coinbase and header: everything but connecting the transactions, given the fees they pay
+ */
+bool TestBlockTemplateValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, CAmount nFees) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+// VELES END
+
 /** Check whether witness commitments are required for block. */
 bool IsWitnessEnabled(const CBlockIndex* pindexPrev, const Consensus::Params& params);
 